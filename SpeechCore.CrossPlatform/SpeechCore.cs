@@ -1,9 +1,13 @@
 using System;
+using System.Runtime.CompilerServices;
 using System.Runtime.InteropServices;
 using System.Text;
+using System.Threading;
+using System.Threading.Tasks;
+using System.Collections.Concurrent;
 using System.Collections.Generic;
 
-public class SpeechCore : IDisposable
+public partial class SpeechCore : IDisposable
 {
     private bool disposed = false;
     private const string DllName = "SpeechCore";
@@ -16,6 +20,15 @@ public class SpeechCore : IDisposable
     public const uint SC_HAS_BRAILLE = 1 << 5;
     public const uint SC_HAS_SPEECH_STATE = 1 << 6;
 
+    public const uint SC_OUTPUT_INTERRUPT = 1 << 0;
+
+    public const uint SC_UTTERANCE_UNKNOWN = 0;
+    public const uint SC_UTTERANCE_QUEUED = 1;
+    public const uint SC_UTTERANCE_SPEAKING = 2;
+    public const uint SC_UTTERANCE_DONE = 3;
+    public const uint SC_UTTERANCE_CANCELLED = 4;
+    public const uint SC_UTTERANCE_FAILED = 5;
+
     private static readonly bool IsWindows = RuntimeInformation.IsOSPlatform(OSPlatform.Windows);
 
     [DllImport(DllName)]
@@ -50,21 +63,69 @@ public class SpeechCore : IDisposable
     [return: MarshalAs(UnmanagedType.Bool)]
     private static extern bool Speech_Is_Speaking();
 
-    [DllImport(DllName, EntryPoint = "Speech_Output")]
-    [return: MarshalAs(UnmanagedType.Bool)]
-    private static extern bool Speech_Output_Windows([MarshalAs(UnmanagedType.LPWStr)] string text, [MarshalAs(UnmanagedType.Bool)] bool interrupt);
+    // Text goes through the UTF-16 and UTF-8 entry points, which take a pointer and a length on every platform.
+    // All parameters are blittable (C++ bool is passed as a byte), so a call pins the span and marshals nothing.
+#if NET7_0_OR_GREATER
+    [LibraryImport(DllName)]
+    [UnmanagedCallConv(CallConvs = new[] { typeof(CallConvCdecl) })]
+    private static unsafe partial byte Speech_Output_Utf16(char* text, nuint length, byte interrupt);
 
-    [DllImport(DllName, EntryPoint = "Speech_Output")]
-    [return: MarshalAs(UnmanagedType.Bool)]
-    private static extern bool Speech_Output_Unix(IntPtr textPtr, [MarshalAs(UnmanagedType.Bool)] bool interrupt);
+    [LibraryImport(DllName)]
+    [UnmanagedCallConv(CallConvs = new[] { typeof(CallConvCdecl) })]
+    private static unsafe partial byte Speech_Output_Utf8(byte* text, nuint length, byte interrupt);
 
-    [DllImport(DllName, EntryPoint = "Speech_Braille")]
-    [return: MarshalAs(UnmanagedType.Bool)]
-    private static extern bool Speech_Braille_Windows([MarshalAs(UnmanagedType.LPWStr)] string text);
+    [LibraryImport(DllName)]
+    [UnmanagedCallConv(CallConvs = new[] { typeof(CallConvCdecl) })]
+    private static unsafe partial byte Speech_Braille_Utf16(char* text, nuint length);
+
+    [LibraryImport(DllName)]
+    [UnmanagedCallConv(CallConvs = new[] { typeof(CallConvCdecl) })]
+    private static unsafe partial byte Speech_Braille_Utf8(byte* text, nuint length);
+
+    [LibraryImport(DllName)]
+    [UnmanagedCallConv(CallConvs = new[] { typeof(CallConvCdecl) })]
+    private static unsafe partial ulong Speech_Output_Ex_Utf16(char* text, nuint length, uint flags);
+
+    [LibraryImport(DllName)]
+    [UnmanagedCallConv(CallConvs = new[] { typeof(CallConvCdecl) })]
+    private static partial uint Speech_Get_Utterance_State(ulong id);
+
+    [LibraryImport(DllName)]
+    [UnmanagedCallConv(CallConvs = new[] { typeof(CallConvCdecl) })]
+    private static partial byte Speech_Cancel(ulong id);
+
+    [LibraryImport(DllName)]
+    [UnmanagedCallConv(CallConvs = new[] { typeof(CallConvCdecl) })]
+    private static unsafe partial void Speech_Set_Utterance_Callback(delegate* unmanaged[Cdecl]<ulong, uint, void*, void> callback, void* userData);
+#else
+    [DllImport(DllName, CallingConvention = CallingConvention.Cdecl)]
+    private static extern unsafe byte Speech_Output_Utf16(char* text, nuint length, byte interrupt);
+
+    [DllImport(DllName, CallingConvention = CallingConvention.Cdecl)]
+    private static extern unsafe byte Speech_Output_Utf8(byte* text, nuint length, byte interrupt);
 
-    [DllImport(DllName, EntryPoint = "Speech_Braille")]
+    [DllImport(DllName, CallingConvention = CallingConvention.Cdecl)]
+    private static extern unsafe byte Speech_Braille_Utf16(char* text, nuint length);
+
+    [DllImport(DllName, CallingConvention = CallingConvention.Cdecl)]
+    private static extern unsafe byte Speech_Braille_Utf8(byte* text, nuint length);
+
+    [DllImport(DllName, CallingConvention = CallingConvention.Cdecl)]
+    private static extern unsafe ulong Speech_Output_Ex_Utf16(char* text, nuint length, uint flags);
+
+    [DllImport(DllName, CallingConvention = CallingConvention.Cdecl)]
+    private static extern uint Speech_Get_Utterance_State(ulong id);
+
+    [DllImport(DllName, CallingConvention = CallingConvention.Cdecl)]
+    private static extern byte Speech_Cancel(ulong id);
+
+    [DllImport(DllName, CallingConvention = CallingConvention.Cdecl)]
+    private static extern unsafe void Speech_Set_Utterance_Callback(delegate* unmanaged[Cdecl]<ulong, uint, void*, void> callback, void* userData);
+#endif
+
+    [DllImport(DllName)]
     [return: MarshalAs(UnmanagedType.Bool)]
-    private static extern bool Speech_Braille_Unix(IntPtr textPtr);
+    private static extern bool Speech_Output_Batch(IntPtr[] texts, UIntPtr count, uint flags);
 
     [DllImport(DllName)]
     [return: MarshalAs(UnmanagedType.Bool)]
@@ -109,6 +170,17 @@ public class SpeechCore : IDisposable
     [DllImport(DllName)]
     private static extern void Speech_Prefer_Sapi([MarshalAs(UnmanagedType.Bool)] bool prefer_sapi);
 
+    // Tasks of SpeakAsync still waiting for their utterance, completed from the utterance callback.
+    private static readonly ConcurrentDictionary<ulong, TaskCompletionSource<uint>> pendingUtterances = new ConcurrentDictionary<ulong, TaskCompletionSource<uint>>();
+    private static int callbackInstalled;
+    private static CallbackTarget? callbackTarget;
+
+    private sealed unsafe class CallbackTarget
+    {
+        public delegate* unmanaged[Cdecl]<ulong, uint, void*, void> Callback;
+        public void* UserData;
+    }
+
     public SpeechCore()
     {
         Speech_Init();
@@ -210,18 +282,116 @@ public class SpeechCore : IDisposable
         if (string.IsNullOrEmpty(text))
             return false;
 
-        if (IsWindows)
+        return Speak(text.AsSpan(), interrupt);
+    }
+
+    public unsafe bool Speak(ReadOnlySpan<char> text, bool interrupt = false)
+    {
+        fixed (char* chars = text)
         {
-            return Speech_Output_Windows(text, interrupt);
+            return Speech_Output_Utf16(chars, (nuint)text.Length, interrupt ? (byte)1 : (byte)0) != 0;
         }
-        else
+    }
+
+    public unsafe bool SpeakUtf8(ReadOnlySpan<byte> text, bool interrupt = false)
+    {
+        fixed (byte* bytes = text)
         {
-            IntPtr textPtr = StringToWChar(text);
-            try
-            {
-                return Speech_Output_Unix(textPtr, interrupt);
-            }
-            finally
+            return Speech_Output_Utf8(bytes, (nuint)text.Length, interrupt ? (byte)1 : (byte)0) != 0;
+        }
+    }
+
+    // Completes with the final SC_UTTERANCE_* state once the utterance finished. The screen reader reports the end of
+    // speech where it can, otherwise an utterance is done once accepted. Cancelling the token cancels the utterance,
+    // and the task then completes with SC_UTTERANCE_CANCELLED.
+    public unsafe Task<uint> SpeakAsync(ReadOnlySpan<char> text, bool interrupt = false, CancellationToken cancellationToken = default)
+    {
+        InstallUtteranceCallback();
+        ulong id;
+        fixed (char* chars = text)
+        {
+            id = Speech_Output_Ex_Utf16(chars, (nuint)text.Length, interrupt ? SC_OUTPUT_INTERRUPT : 0);
+        }
+        if (id == 0)
+            return Task.FromResult(SC_UTTERANCE_FAILED);
+
+        var completion = new TaskCompletionSource<uint>(TaskCreationOptions.RunContinuationsAsynchronously);
+        pendingUtterances[id] = completion;
+        // Synchronous output finishes the utterance before it could be registered above, and the callback found nothing.
+        uint state = Speech_Get_Utterance_State(id);
+        if (state >= SC_UTTERANCE_DONE && pendingUtterances.TryRemove(id, out _))
+            completion.TrySetResult(state);
+
+        if (!cancellationToken.CanBeCanceled)
+            return completion.Task;
+        return CancelWith(completion.Task, id, cancellationToken);
+    }
+
+    private static async Task<uint> CancelWith(Task<uint> utterance, ulong id, CancellationToken cancellationToken)
+    {
+        using (cancellationToken.Register(() => Speech_Cancel(id)))
+        {
+            return await utterance.ConfigureAwait(false);
+        }
+    }
+
+    // Sets a native callback for every finished utterance of Speech_Output_Ex and SpeakAsync, null removes it.
+    // It runs on the thread that finished the utterance. SpeakAsync keeps working either way.
+    public static unsafe void SetUtteranceCallback(delegate* unmanaged[Cdecl]<ulong, uint, void*, void> callback, void* userData)
+    {
+        Volatile.Write(ref callbackTarget, callback == null ? null : new CallbackTarget { Callback = callback, UserData = userData });
+        InstallUtteranceCallback();
+    }
+
+    private static unsafe void InstallUtteranceCallback()
+    {
+        if (Interlocked.Exchange(ref callbackInstalled, 1) == 1)
+            return;
+#if NET5_0_OR_GREATER
+        Speech_Set_Utterance_Callback(&OnUtterance, null);
+#else
+        Speech_Set_Utterance_Callback((delegate* unmanaged[Cdecl]<ulong, uint, void*, void>)Marshal.GetFunctionPointerForDelegate(onUtterance), null);
+#endif
+    }
+
+#if NET5_0_OR_GREATER
+    [UnmanagedCallersOnly(CallConvs = new[] { typeof(CallConvCdecl) })]
+    private static unsafe void OnUtterance(ulong id, uint state, void* userData) => CompleteUtterance(id, state);
+#else
+    [UnmanagedFunctionPointer(CallingConvention.Cdecl)]
+    private unsafe delegate void UtteranceCallback(ulong id, uint state, void* userData);
+
+    // Kept in a static field, the delegate must outlive the native pointer to it.
+    private static readonly unsafe UtteranceCallback onUtterance = OnUtterance;
+
+    private static unsafe void OnUtterance(ulong id, uint state, void* userData) => CompleteUtterance(id, state);
+#endif
+
+    private static unsafe void CompleteUtterance(ulong id, uint state)
+    {
+        if (pendingUtterances.TryRemove(id, out TaskCompletionSource<uint>? completion))
+            completion.TrySetResult(state);
+
+        CallbackTarget? target = Volatile.Read(ref callbackTarget);
+        if (target != null)
+            target.Callback(id, state, target.UserData);
+    }
+
+    public bool SpeakBatch(string[] texts, bool interrupt = false)
+    {
+        if (texts == null || texts.Length == 0)
+            return false;
+
+        IntPtr[] textPtrs = new IntPtr[texts.Length];
+        try
+        {
+            for (int i = 0; i < texts.Length; i++)
+                textPtrs[i] = StringToWChar(texts[i]);
+            return Speech_Output_Batch(textPtrs, (UIntPtr)textPtrs.Length, interrupt ? SC_OUTPUT_INTERRUPT : 0);
+        }
+        finally
+        {
+            foreach (IntPtr textPtr in textPtrs)
             {
                 if (textPtr != IntPtr.Zero)
                     Marshal.FreeHGlobal(textPtr);
@@ -234,22 +404,22 @@ public class SpeechCore : IDisposable
         if (string.IsNullOrEmpty(text))
             return false;
 
-        if (IsWindows)
+        return Braille(text.AsSpan());
+    }
+
+    public unsafe bool Braille(ReadOnlySpan<char> text)
+    {
+        fixed (char* chars = text)
         {
-            return Speech_Braille_Windows(text);
+            return Speech_Braille_Utf16(chars, (nuint)text.Length) != 0;
         }
-        else
+    }
+
+    public unsafe bool BrailleUtf8(ReadOnlySpan<byte> text)
+    {
+        fixed (byte* bytes = text)
         {
-            IntPtr textPtr = StringToWChar(text);
-            try
-            {
-                return Speech_Braille_Unix(textPtr);
-            }
-            finally
-            {
-                if (textPtr != IntPtr.Zero)
-                    Marshal.FreeHGlobal(textPtr);
-            }
+            return Speech_Braille_Utf8(bytes, (nuint)text.Length) != 0;
         }
     }
 
@@ -0,0 +1,182 @@
+// coalesce_bench: bursts of asynchronous output through the coalescing window.
+// Each case queues a few utterances with Speech_Output_Ex faster than the window, then checks what the loopback driver
+// was asked to speak and how every utterance finished. An interrupting message has to drop whatever is held, whatever
+// its class, and start its own window; the latency of the last utterance against the window is reported.
+// Exits with 1 if a check fails, the results are written as JSON either way.
+//
+// Usage: coalesce_bench [--window MS] [--output FILE]
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cwchar>
+#include <vector>
+#include "SpeechCore.h"
+
+using namespace std;
+using bench_clock = chrono::steady_clock;
+
+struct bench_options {
+	uint32_t window_ms = 100;
+	const char* output = nullptr;
+};
+
+struct output {
+	const wchar_t* text;
+	bool interrupt;
+	uint32_t state; // The SC_UTTERANCE_* state it has to end in.
+};
+
+struct spoken {
+	const wchar_t* text;
+	bool interrupt;
+};
+
+struct coalesce_case {
+	const char* name;
+	vector<output> outputs;
+	vector<spoken> expected; // Speak calls the driver has to get, in order.
+};
+
+static const coalesce_case cases[] = {
+	{ "interrupt_drops_held", {
+		{ L"normal A", false, SC_UTTERANCE_CANCELLED },
+		{ L"normal B", false, SC_UTTERANCE_CANCELLED },
+		{ L"interrupt C", true, SC_UTTERANCE_CANCELLED },
+		{ L"interrupt D", true, SC_UTTERANCE_DONE },
+	}, {
+		{ L"interrupt D", true },
+	} },
+	{ "normal_merges", {
+		{ L"normal A", false, SC_UTTERANCE_DONE },
+		{ L"normal B", false, SC_UTTERANCE_DONE },
+	}, {
+		{ L"normal A normal B", false },
+	} },
+	{ "normal_after_interrupt", {
+		{ L"interrupt C", true, SC_UTTERANCE_DONE },
+		{ L"normal A", false, SC_UTTERANCE_DONE },
+	}, {
+		{ L"interrupt C", true },
+		{ L"normal A", false },
+	} },
+};
+
+struct case_result {
+	size_t speaks = 0;
+	size_t mismatched = 0; // Speak calls or utterance states that differ from the expected ones.
+	double last_ms = 0; // From queueing the last utterance until the driver got the last speak call.
+	uint64_t dropped = 0;
+	uint64_t merged = 0;
+};
+
+static case_result run_case(const coalesce_case& test, uint32_t window_ms) {
+	case_result result;
+	Loopback_Reset();
+	Speech_Reset_Coalesce_Stats();
+	vector<uint64_t> ids;
+	bench_clock::time_point last;
+	for (const output& item : test.outputs) {
+		last = bench_clock::now();
+		ids.push_back(Speech_Output_Ex(item.text, item.interrupt ? SC_OUTPUT_INTERRUPT : 0));
+	}
+	for (size_t i = 0; i < ids.size(); i++) {
+		uint32_t state = Speech_Wait(ids[i], window_ms * 10);
+		result.mismatched += (state == test.outputs[i].state) ? 0 : 1;
+	}
+	Speech_Get_Coalesce_Stats(&result.dropped, &result.merged);
+
+	sc_loopback_record record;
+	for (size_t i = 0; Loopback_Get_Record(i, &record); i++) {
+		if (record.call != SC_LOOPBACK_SPEAK) {
+			continue;
+		}
+		size_t index = result.speaks++;
+		if (index >= test.expected.size() || wcscmp(record.text, test.expected[index].text) || record.interrupt != test.expected[index].interrupt) {
+			result.mismatched++;
+			continue;
+		}
+		if (index + 1 == test.expected.size()) {
+			uint64_t queued_ns = static_cast<uint64_t>(chrono::duration_cast<chrono::nanoseconds>(last.time_since_epoch()).count());
+			result.last_ms = static_cast<double>(record.start_ns - queued_ns) / 1e6;
+		}
+	}
+	return result;
+}
+
+static bool parse_options(int argc, char** argv, bench_options& options) {
+	for (int i = 1; i < argc; i++) {
+		const char* arg = argv[i];
+		const char* value = (i + 1 < argc) ? argv[i + 1] : nullptr;
+		if (value == nullptr) {
+			return false;
+		}
+		if (!strcmp(arg, "--window")) {
+			options.window_ms = static_cast<uint32_t>(strtoul(value, nullptr, 10));
+		}
+		else if (!strcmp(arg, "--output")) {
+			options.output = value;
+		}
+		else {
+			return false;
+		}
+		i++;
+	}
+	return options.window_ms > 0;
+}
+
+int main(int argc, char** argv) {
+	bench_options options;
+	if (!parse_options(argc, argv, options)) {
+		fprintf(stderr, "usage: %s [--window MS] [--output FILE]\n", argv[0]);
+		return 2;
+	}
+	Speech_Init();
+	int loopback_index = -1;
+	for (int i = 0; i < Speech_Get_Drivers(); i++) {
+		if (!wcscmp(Speech_Get_Driver(i), L"Loopback")) {
+			loopback_index = i;
+		}
+	}
+	if (loopback_index < 0) {
+		fprintf(stderr, "loopback driver not available\n");
+		Speech_Free();
+		return 1;
+	}
+	Speech_Set_Driver(loopback_index);
+	Speech_Set_Async(true);
+	Speech_Set_Coalesce_Window(options.window_ms);
+
+	size_t case_count = sizeof(cases) / sizeof(cases[0]);
+	vector<case_result> results;
+	bool passed = true;
+	for (size_t i = 0; i < case_count; i++) {
+		case_result result = run_case(cases[i], options.window_ms);
+		bool ok = result.mismatched == 0 && result.speaks == cases[i].expected.size();
+		passed = passed && ok;
+		fprintf(stderr, "%-24s speaks=%zu mismatched=%zu dropped=%llu merged=%llu last=%.1fms%s\n", cases[i].name, result.speaks,
+			result.mismatched, static_cast<unsigned long long>(result.dropped), static_cast<unsigned long long>(result.merged),
+			result.last_ms, ok ? "" : " FAILED");
+		results.push_back(result);
+	}
+	Speech_Free();
+
+	FILE* out = options.output ? fopen(options.output, "w") : stdout;
+	if (out == nullptr) {
+		fprintf(stderr, "can't open %s\n", options.output);
+		return 1;
+	}
+	fprintf(out, "{\n  \"benchmark\": \"coalesce_bench\",\n  \"window_ms\": %u,\n  \"cases\": {\n", options.window_ms);
+	for (size_t i = 0; i < case_count; i++) {
+		const case_result& result = results[i];
+		fprintf(out, "    \"%s\": {\"speaks\": %zu, \"mismatched\": %zu, \"dropped\": %llu, \"merged\": %llu, \"last_ms\": %.3f}%s\n",
+			cases[i].name, result.speaks, result.mismatched, static_cast<unsigned long long>(result.dropped),
+			static_cast<unsigned long long>(result.merged), result.last_ms, (i + 1 < case_count) ? "," : "");
+	}
+	fprintf(out, "  },\n  \"passed\": %s\n}\n", passed ? "true" : "false");
+	if (out != stdout) {
+		fclose(out);
+	}
+	return passed ? 0 : 1;
+}
@@ -0,0 +1,84 @@
+// BenchmarkDotNet run of the .NET binding against the loopback driver, which does no work of its own,
+// so the numbers are the cost of crossing into SpeechCore. MemoryDiagnoser shows the managed allocations per call:
+// the span, string and UTF-8 overloads pin and allocate nothing, Marshalled is how Speak converted text before.
+//
+// Put the shared library (libSpeechCore.so, .dylib or SpeechCore.dll) next to the build output or on the library path, then:
+//     dotnet run -c Release --project bench/dotnet
+
+using System;
+using System.Runtime.InteropServices;
+using System.Text;
+using System.Threading.Tasks;
+using BenchmarkDotNet.Attributes;
+using BenchmarkDotNet.Running;
+
+[MemoryDiagnoser]
+public class OutputBenchmarks
+{
+    private SpeechCore speech = null!;
+    private string text = "";
+    private byte[] utf8 = Array.Empty<byte>();
+
+    [Params("ascii", "cjk")]
+    public string Corpus { get; set; } = "ascii";
+
+    [DllImport("SpeechCore", EntryPoint = "Speech_Output")]
+    [return: MarshalAs(UnmanagedType.U1)]
+    private static extern bool Speech_Output(IntPtr text, [MarshalAs(UnmanagedType.U1)] bool interrupt);
+
+    [GlobalSetup]
+    public void Setup()
+    {
+        speech = new SpeechCore();
+        for (int i = 0; i < speech.GetDrivers(); i++)
+        {
+            if (speech.GetDriver(i) == "Loopback")
+                speech.SetDriver(i);
+        }
+        if (speech.CurrentDriver() != "Loopback")
+            throw new InvalidOperationException("the loopback driver is not built in");
+
+        text = Corpus == "ascii"
+            ? "Press Enter to activate, Tab to move to the next control."
+            : "日本語のテキスト読み上げ、中文语音合成。";
+        utf8 = Encoding.UTF8.GetBytes(text);
+    }
+
+    [GlobalCleanup]
+    public void Cleanup() => speech.Dispose();
+
+    [Benchmark(Baseline = true)]
+    public bool Marshalled()
+    {
+        byte[] bytes = RuntimeInformation.IsOSPlatform(OSPlatform.Windows)
+            ? Encoding.Unicode.GetBytes(text + "\0")
+            : Encoding.UTF32.GetBytes(text + "\0");
+        IntPtr native = Marshal.AllocHGlobal(bytes.Length);
+        try
+        {
+            Marshal.Copy(bytes, 0, native, bytes.Length);
+            return Speech_Output(native, false);
+        }
+        finally
+        {
+            Marshal.FreeHGlobal(native);
+        }
+    }
+
+    [Benchmark]
+    public bool SpeakString() => speech.Speak(text);
+
+    [Benchmark]
+    public bool SpeakSpan() => speech.Speak(text.AsSpan());
+
+    [Benchmark]
+    public bool SpeakUtf8() => speech.SpeakUtf8(utf8);
+
+    [Benchmark]
+    public Task<uint> SpeakAsync() => speech.SpeakAsync(text);
+}
+
+public static class Program
+{
+    public static void Main(string[] args) => BenchmarkSwitcher.FromAssembly(typeof(Program).Assembly).Run(args);
+}
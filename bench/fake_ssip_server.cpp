@@ -0,0 +1,184 @@
+#include "fake_ssip_server.h"
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+using namespace std;
+
+static bool starts_with(const string& line, const char* prefix) {
+	size_t length = strlen(prefix);
+	if (line.size() < length) {
+		return false;
+	}
+	for (size_t i = 0; i < length; i++) {
+		if (toupper(static_cast<unsigned char>(line[i])) != prefix[i]) {
+			return false;
+		}
+	}
+	return true;
+}
+
+static bool send_all(int fd, const string& data) {
+	size_t sent = 0;
+	while (sent < data.size()) {
+		ssize_t result = send(fd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+		if (result <= 0) {
+			return false;
+		}
+		sent += static_cast<size_t>(result);
+	}
+	return true;
+}
+
+FakeSsipServer::~FakeSsipServer() {
+	stop();
+}
+
+bool FakeSsipServer::start(const string& _path) {
+	sockaddr_un address{};
+	if (_path.size() >= sizeof(address.sun_path)) {
+		return false;
+	}
+	path = _path;
+	address.sun_family = AF_UNIX;
+	memcpy(address.sun_path, path.c_str(), path.size() + 1);
+	unlink(path.c_str());
+	listen_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+	if (listen_fd < 0) {
+		return false;
+	}
+	if (::bind(listen_fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 || listen(listen_fd, 16) != 0) {
+		close(listen_fd);
+		listen_fd = -1;
+		return false;
+	}
+	acceptor = thread(&FakeSsipServer::accept_loop, this);
+	return true;
+}
+
+void FakeSsipServer::stop() {
+	if (listen_fd < 0) {
+		return;
+	}
+	// Shutting the sockets down wakes the threads blocked in accept and recv.
+	shutdown(listen_fd, SHUT_RDWR);
+	acceptor.join();
+	{
+		lock_guard<mutex> lock(clients_mutex);
+		for (int fd : clients) {
+			shutdown(fd, SHUT_RDWR);
+		}
+	}
+	for (thread& session : sessions) {
+		session.join();
+	}
+	for (int fd : clients) {
+		close(fd);
+	}
+	sessions.clear();
+	clients.clear();
+	close(listen_fd);
+	listen_fd = -1;
+	unlink(path.c_str());
+}
+
+void FakeSsipServer::accept_loop() {
+	uint64_t client_id = 0;
+	while (true) {
+		int fd = accept4(listen_fd, nullptr, nullptr, SOCK_CLOEXEC);
+		if (fd < 0) {
+			return;
+		}
+		lock_guard<mutex> lock(clients_mutex);
+		clients.push_back(fd);
+		sessions.emplace_back(&FakeSsipServer::serve, this, fd, ++client_id);
+	}
+}
+
+void FakeSsipServer::serve(int fd, uint64_t client_id) {
+	string inbox, reply;
+	bool receiving = false; // Between SPEAK and the terminating dot.
+	bool notify = false;
+	int volume = 0, rate = 0;
+	char chunk[4096];
+	while (true) {
+		ssize_t count = recv(fd, chunk, sizeof(chunk), 0);
+		if (count <= 0) {
+			return;
+		}
+		inbox.append(chunk, static_cast<size_t>(count));
+		reply.clear();
+		bool quit = false;
+		size_t start = 0;
+		for (size_t end; (end = inbox.find("\r\n", start)) != string::npos; start = end + 2) {
+			string line = inbox.substr(start, end - start);
+			if (receiving) {
+				if (line == ".") {
+					receiving = false;
+					string id = to_string(next_message.fetch_add(1, memory_order_relaxed) + 1);
+					string client = to_string(client_id);
+					received.fetch_add(1, memory_order_relaxed);
+					reply += "225-" + id + "\r\n225 OK MESSAGE QUEUED\r\n";
+					if (notify) {
+						reply += "701-" + id + "\r\n701-" + client + "\r\n701 BEGIN\r\n";
+						reply += "702-" + id + "\r\n702-" + client + "\r\n702 END\r\n";
+					}
+				}
+				continue;
+			}
+			if (starts_with(line, "SPEAK")) {
+				receiving = true;
+				reply += "230 OK RECEIVING DATA\r\n";
+			}
+			else if (starts_with(line, "SET SELF NOTIFICATION") || starts_with(line, "SET ALL NOTIFICATION")) {
+				notify = notify || (line.size() >= 3 && starts_with(line.substr(line.size() - 3), " ON"));
+				reply += "222 OK NOTIFICATION SET\r\n";
+			}
+			else if (starts_with(line, "SET SELF VOLUME ")) {
+				volume = atoi(line.c_str() + 16);
+				reply += "218 OK VOLUME SET\r\n";
+			}
+			else if (starts_with(line, "SET SELF RATE ")) {
+				rate = atoi(line.c_str() + 14);
+				reply += "203 OK RATE SET\r\n";
+			}
+			else if (starts_with(line, "SET ")) {
+				reply += "200 OK\r\n";
+			}
+			else if (starts_with(line, "GET VOLUME")) {
+				reply += "251-" + to_string(volume) + "\r\n251 OK GET RETURN VALUE\r\n";
+			}
+			else if (starts_with(line, "GET RATE")) {
+				reply += "251-" + to_string(rate) + "\r\n251 OK GET RETURN VALUE\r\n";
+			}
+			else if (starts_with(line, "STOP")) {
+				reply += "210 OK STOPPED\r\n";
+			}
+			else if (starts_with(line, "CANCEL")) {
+				reply += "211 OK CANCELED\r\n";
+			}
+			else if (starts_with(line, "HISTORY GET CLIENT_ID")) {
+				reply += "245-" + to_string(client_id) + "\r\n245 OK CLIENT ID SENT\r\n";
+			}
+			else if (starts_with(line, "QUIT")) {
+				reply += "231 HAPPY HACKING\r\n";
+				quit = true;
+				break;
+			}
+			else {
+				reply += "300 ERR UNKNOWN COMMAND\r\n";
+			}
+		}
+		inbox.erase(0, start);
+		if (!reply.empty() && !send_all(fd, reply)) {
+			return;
+		}
+		if (quit) {
+			shutdown(fd, SHUT_RDWR);
+			return;
+		}
+	}
+}
@@ -0,0 +1,37 @@
+// fake_ssip_server: a stand-in for speech-dispatcher on a local Unix socket, for exercising the SSIP paths
+// without a real server or audio. Every message is queued instantly and, once the client enabled notifications,
+// reported as begun and ended right away. It knows just enough SSIP for libspeechd and SpeechCore's own client:
+// SET, GET VOLUME/RATE, SPEAK, STOP, CANCEL, HISTORY GET CLIENT_ID and QUIT.
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+class FakeSsipServer {
+public:
+	FakeSsipServer() = default;
+	~FakeSsipServer();
+	FakeSsipServer(const FakeSsipServer&) = delete;
+	FakeSsipServer& operator=(const FakeSsipServer&) = delete;
+
+	bool start(const std::string& path);
+	void stop();
+// Messages received over all connections.
+	uint64_t messages() const { return received.load(std::memory_order_relaxed); }
+
+private:
+	std::string path;
+	int listen_fd = -1;
+	std::thread acceptor;
+	std::mutex clients_mutex;
+	std::vector<int> clients;
+	std::vector<std::thread> sessions;
+	std::atomic<uint64_t> received{ 0 };
+	std::atomic<uint64_t> next_message{ 0 };
+
+	void accept_loop();
+	void serve(int fd, uint64_t client_id);
+};
@@ -0,0 +1,93 @@
+// JMH benchmark of the JNI layer: speak calls per second from several Java threads against the loopback driver,
+// which does no work of its own, so the numbers are the cost of crossing into SpeechCore.
+// Compares one String per call, a String[] batch and a reused direct ByteBuffer batch.
+//
+// Build bindings/java/SpeechCore.java next to this file with jmh-core and jmh-generator-annprocess on the classpath, then:
+//     java -Djava.library.path=<dir of libSpeechCore> -cp <classpath> org.openjdk.jmh.Main SpeechCoreBench -t 1
+// and again with -t 2, -t 4 and -t 8 for the scaling.
+
+import java.nio.ByteBuffer;
+import java.util.concurrent.TimeUnit;
+
+import org.openjdk.jmh.annotations.Benchmark;
+import org.openjdk.jmh.annotations.BenchmarkMode;
+import org.openjdk.jmh.annotations.Fork;
+import org.openjdk.jmh.annotations.Level;
+import org.openjdk.jmh.annotations.Measurement;
+import org.openjdk.jmh.annotations.Mode;
+import org.openjdk.jmh.annotations.OutputTimeUnit;
+import org.openjdk.jmh.annotations.Param;
+import org.openjdk.jmh.annotations.Scope;
+import org.openjdk.jmh.annotations.Setup;
+import org.openjdk.jmh.annotations.State;
+import org.openjdk.jmh.annotations.TearDown;
+import org.openjdk.jmh.annotations.Warmup;
+
+@BenchmarkMode(Mode.Throughput)
+@OutputTimeUnit(TimeUnit.SECONDS)
+@Warmup(iterations = 3, time = 1)
+@Measurement(iterations = 5, time = 1)
+@Fork(1)
+public class SpeechCoreBench {
+    static final int BATCH = 16;
+
+    @State(Scope.Benchmark)
+    public static class Library {
+        SpeechCore speech;
+
+        @Setup(Level.Trial)
+        public void open() {
+            speech = new SpeechCore();
+            for (int i = 0; i < speech.getDriverCount(); i++) {
+                if ("Loopback".equals(speech.getDriver(i))) {
+                    speech.setDriver(i);
+                    return;
+                }
+            }
+            throw new IllegalStateException("the loopback driver is not built in");
+        }
+
+        @TearDown(Level.Trial)
+        public void close() {
+            speech.close();
+        }
+    }
+
+    @State(Scope.Thread)
+    public static class Messages {
+        @Param({"ascii", "cjk"})
+        String corpus;
+
+        String text;
+        String[] texts = new String[BATCH];
+        ByteBuffer batch;
+
+        @Setup(Level.Trial)
+        public void build() {
+            String sample = corpus.equals("ascii")
+                ? "Press Enter to activate, Tab to move to the next control. "
+                : "日本語のテキスト読み上げ、中文语音合成。";
+            text = sample;
+            batch = SpeechCore.allocateBatch(BATCH * (sample.length() * 2 + 8));
+            for (int i = 0; i < BATCH; i++) {
+                texts[i] = sample;
+                SpeechCore.putBatchText(batch, sample);
+            }
+        }
+    }
+
+    @Benchmark
+    public boolean speak(Library library, Messages messages) {
+        return library.speech.speak(messages.text, false);
+    }
+
+    @Benchmark
+    public boolean speakBatch(Library library, Messages messages) {
+        return library.speech.speakBatch(messages.texts, false);
+    }
+
+    @Benchmark
+    public boolean speakBatchDirect(Library library, Messages messages) {
+        return library.speech.speakBatch(messages.batch, BATCH, false);
+    }
+}
@@ -0,0 +1,81 @@
+# Throughput of the Python bindings with concurrent Python threads, against the loopback driver.
+# The loopback driver sleeps for a fixed latency in every speak call, the way a screen reader round trip would.
+# With the GIL released around that call, N threads reach about N times the single thread throughput,
+# and pure Python work keeps running while another thread is inside the library.
+#
+# Needs the speech_core extension built and pytest-benchmark installed:
+#     pytest bench/python/bench_threads.py --benchmark-columns=mean,ops
+
+import asyncio
+import threading
+
+import pytest
+
+from speech_core import SpeechCore, SC_UTTERANCE_DONE
+# The extension module itself, for the loopback controls the SpeechCore class does not wrap.
+from speech_core.SpeechCore import loopback_set_latency, loopback_reset, SC_LOOPBACK_SPEAK, SC_LATENCY_FIXED
+
+# Loopback latency of one speak call, and the messages spoken per benchmark round.
+SPEAK_LATENCY_US = 200
+MESSAGES = 400
+
+@pytest.fixture(scope="module")
+def speech():
+    with SpeechCore() as speech:
+        names = [speech.get_driver(i) for i in range(speech.get_drivers())]
+        if "Loopback" not in names:
+            pytest.skip("the loopback driver is not built in")
+        speech.set_driver(names.index("Loopback"))
+        loopback_set_latency(SC_LOOPBACK_SPEAK, SC_LATENCY_FIXED, SPEAK_LATENCY_US)
+        yield speech
+        speech.set_async(False)
+
+def speak_from_threads(speech, threads: int):
+    per_thread = MESSAGES // threads
+    def run():
+        for i in range(per_thread):
+            speech.output("benchmark message %d" % i)
+    workers = [threading.Thread(target=run) for _ in range(threads)]
+    for worker in workers:
+        worker.start()
+    for worker in workers:
+        worker.join()
+    loopback_reset()
+
+@pytest.mark.parametrize("threads", [1, 2, 4, 8])
+def test_output_threads(benchmark, speech, threads):
+    benchmark.extra_info["messages"] = MESSAGES
+    benchmark.pedantic(speak_from_threads, args=(speech, threads), rounds=5, warmup_rounds=1)
+
+def test_python_work_during_output(benchmark, speech):
+    # Counts in Python while another thread speaks. With the GIL held across the speak call this stalls.
+    def run():
+        done = threading.Event()
+        def speaker():
+            for i in range(MESSAGES):
+                speech.output("benchmark message %d" % i)
+            done.set()
+        thread = threading.Thread(target=speaker)
+        thread.start()
+        count = 0
+        while not done.is_set():
+            count += 1
+        thread.join()
+        loopback_reset()
+        return count
+    count = benchmark.pedantic(run, rounds=5, warmup_rounds=1)
+    benchmark.extra_info["python_iterations"] = count
+
+def test_output_async_gather(benchmark, speech):
+    speech.set_async(True)
+    async def speak_all():
+        states = await asyncio.gather(*(speech.output_async("benchmark message %d" % i) for i in range(MESSAGES)))
+        await speech.wait_done(5.0)
+        return states
+    def run():
+        states = asyncio.run(speak_all())
+        loopback_reset()
+        return states
+    states = benchmark.pedantic(run, rounds=5, warmup_rounds=1)
+    speech.set_async(False)
+    assert all(state == SC_UTTERANCE_DONE for state in states)
@@ -0,0 +1,173 @@
+// segment_bench: time to first audio against input size, with and without segmentation.
+// The loopback driver stands in for an engine like SAPI that synthesizes a whole request before playing it:
+// each speak call blocks for --synthesis-us per character. Audio starts once the first speak call returned,
+// so the time to first audio is the end of the first recorded call, counted from Speech_Output.
+// Each size is the same help text repeated, spoken --repeat times per segment limit. Results are written as JSON.
+//
+// Usage: segment_bench [--synthesis-us N] [--limit N] [--max-size N] [--repeat N] [--output FILE]
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cwchar>
+#include <string>
+#include <vector>
+#include "SpeechCore.h"
+
+using namespace std;
+using bench_clock = chrono::steady_clock;
+
+struct bench_options {
+	uint32_t synthesis_us = 20;
+	uint32_t limit = 400;
+	size_t max_size = 65536;
+	size_t repeat = 5;
+	const char* output = nullptr;
+};
+
+struct corpus {
+	const char* name;
+	const wchar_t* sample;
+};
+
+static const corpus corpora[] = {
+	{ "english", L"Press Tab to move to the next control, or Shift+Tab to go back. The settings are saved when you close this page; "
+		L"changes to the voice apply right away. See the manual, e.g. the chapter on speech, for more options. " },
+	{ "cjk", L"\u8A2D\u5B9A\u306F\u3053\u306E\u30DA\u30FC\u30B8\u3092\u9589\u3058\u308B\u3068\u4FDD\u5B58\u3055\u308C\u307E\u3059\u3002"
+		L"\u97F3\u58F0\u306E\u5909\u66F4\u306F\u3001\u3059\u3050\u306B\u53CD\u6620\u3055\u308C\u307E\u3059\u3002" },
+};
+
+struct size_result {
+	size_t size;
+	size_t segments;
+	uint64_t first_audio_ns; // Medians of the runs.
+	uint64_t total_ns;
+};
+
+static uint64_t now_ns() {
+	return static_cast<uint64_t>(chrono::duration_cast<chrono::nanoseconds>(bench_clock::now().time_since_epoch()).count());
+}
+
+static uint64_t median(vector<uint64_t>& samples) {
+	sort(samples.begin(), samples.end());
+	return samples[samples.size() / 2];
+}
+
+static size_result run_size(const wstring& text, size_t repeat) {
+	size_result result = { text.size(), 0, 0, 0 };
+	vector<uint64_t> first_audio, total;
+	for (size_t i = 0; i < repeat; i++) {
+		Loopback_Reset();
+		uint64_t start = now_ns();
+		Speech_Output(text.c_str(), false);
+		total.push_back(now_ns() - start);
+		sc_loopback_record record;
+		if (Loopback_Get_Record(0, &record) && record.call == SC_LOOPBACK_SPEAK) {
+			first_audio.push_back(record.end_ns - start);
+		}
+		result.segments = Loopback_Get_Calls(SC_LOOPBACK_SPEAK);
+	}
+	result.first_audio_ns = first_audio.empty() ? 0 : median(first_audio);
+	result.total_ns = median(total);
+	return result;
+}
+
+static void write_results(FILE* out, const vector<size_result>& results, bool last) {
+	for (size_t i = 0; i < results.size(); i++) {
+		const size_result& result = results[i];
+		fprintf(out, "        {\"size\": %zu, \"segments\": %zu, \"first_audio_us\": %.1f, \"total_us\": %.1f}%s\n",
+			result.size, result.segments, result.first_audio_ns / 1e3, result.total_ns / 1e3, (i + 1 < results.size()) ? "," : "");
+	}
+	fprintf(out, "      ]%s\n", last ? "" : ",");
+}
+
+static bool parse_options(int argc, char** argv, bench_options& options) {
+	for (int i = 1; i < argc; i++) {
+		const char* arg = argv[i];
+		const char* value = (i + 1 < argc) ? argv[i + 1] : nullptr;
+		if (value == nullptr) {
+			return false;
+		}
+		if (!strcmp(arg, "--synthesis-us")) {
+			options.synthesis_us = static_cast<uint32_t>(strtoul(value, nullptr, 10));
+		}
+		else if (!strcmp(arg, "--limit")) {
+			options.limit = static_cast<uint32_t>(strtoul(value, nullptr, 10));
+		}
+		else if (!strcmp(arg, "--max-size")) {
+			options.max_size = strtoull(value, nullptr, 10);
+		}
+		else if (!strcmp(arg, "--repeat")) {
+			options.repeat = strtoull(value, nullptr, 10);
+		}
+		else if (!strcmp(arg, "--output")) {
+			options.output = value;
+		}
+		else {
+			return false;
+		}
+		i++;
+	}
+	return options.synthesis_us > 0 && options.limit > 0 && options.max_size >= 256 && options.repeat > 0;
+}
+
+int main(int argc, char** argv) {
+	bench_options options;
+	if (!parse_options(argc, argv, options)) {
+		fprintf(stderr, "usage: %s [--synthesis-us N] [--limit N] [--max-size N] [--repeat N] [--output FILE]\n", argv[0]);
+		return 2;
+	}
+	Speech_Init();
+	int loopback_index = -1;
+	for (int i = 0; i < Speech_Get_Drivers(); i++) {
+		if (!wcscmp(Speech_Get_Driver(i), L"Loopback")) {
+			loopback_index = i;
+		}
+	}
+	if (loopback_index < 0) {
+		fprintf(stderr, "loopback driver not available\n");
+		Speech_Free();
+		return 1;
+	}
+	Speech_Set_Driver(loopback_index);
+	Loopback_Set_Synthesis_Rate(options.synthesis_us);
+
+	FILE* out = options.output ? fopen(options.output, "w") : stdout;
+	if (out == nullptr) {
+		fprintf(stderr, "can't open %s\n", options.output);
+		Speech_Free();
+		return 1;
+	}
+	fprintf(out, "{\n  \"synthesis_us_per_char\": %u,\n  \"limit\": %u,\n  \"repeat\": %zu,\n  \"corpora\": {\n",
+		options.synthesis_us, options.limit, options.repeat);
+	size_t corpus_count = sizeof(corpora) / sizeof(corpora[0]);
+	for (size_t i = 0; i < corpus_count; i++) {
+		fprintf(out, "    \"%s\": {\n", corpora[i].name);
+		const uint32_t limits[] = { 0, options.limit };
+		for (size_t l = 0; l < 2; l++) {
+			Speech_Set_Segment_Limit(limits[l]);
+			vector<size_result> results;
+			for (size_t size = 256; size <= options.max_size; size *= 4) {
+				wstring text;
+				while (text.size() < size) {
+					text += corpora[i].sample;
+				}
+				text.resize(size);
+				results.push_back(run_size(text, options.repeat));
+				fprintf(stderr, "%-8s %-9s size=%-6zu first audio=%.1fms total=%.1fms\n", corpora[i].name, limits[l] ? "segmented" : "whole",
+					size, results.back().first_audio_ns / 1e6, results.back().total_ns / 1e6);
+			}
+			fprintf(out, "      \"%s\": [\n", limits[l] ? "segmented" : "whole");
+			write_results(out, results, l == 1);
+		}
+		fprintf(out, "    }%s\n", (i + 1 < corpus_count) ? "," : "");
+	}
+	fprintf(out, "  }\n}\n");
+	if (out != stdout) {
+		fclose(out);
+	}
+	Speech_Free();
+	return 0;
+}
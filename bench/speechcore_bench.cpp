@@ -0,0 +1,355 @@
+// speechcore_bench: throughput and tail latency of the SpeechCore C API.
+// Every case runs against the loopback driver, so only SpeechCore's own overhead is measured,
+// and is repeated for 1, 2, 4, ... up to --threads threads. Results are written as JSON.
+// Before that, Speech_Init is timed once with lazy and once with eager driver loading, along with the resident memory it adds.
+//
+// Usage: speechcore_bench [--threads N] [--iterations N] [--filter NAME] [--speak-latency-us N] [--output FILE]
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cwchar>
+#include <string>
+#include <thread>
+#include <vector>
+#include "SpeechCore.h"
+#ifdef _WIN32
+#include <Windows.h>
+#endif // _WIN32
+
+using namespace std;
+using bench_clock = chrono::steady_clock;
+
+struct bench_options {
+	unsigned threads = 4;
+	size_t iterations = 100000;
+	const char* filter = nullptr;
+	uint32_t speak_latency_us = 0;
+	const char* output = nullptr;
+};
+
+struct bench_case {
+	const char* name;
+	void (*setup)();
+	void (*op)(unsigned thread, size_t iteration);
+	void (*teardown)();
+	void (*report)(string& fields); // Appends case specific JSON fields, may be null.
+};
+
+struct bench_result {
+	string name;
+	unsigned threads;
+	size_t ops;
+	double seconds;
+	uint64_t p50_ns;
+	uint64_t p99_ns;
+	uint64_t p999_ns;
+	uint64_t max_ns;
+	string fields;
+};
+
+struct startup_result {
+	uint64_t init_ns; // Median of the runs.
+	int64_t rss_kb; // Resident memory added by the first Speech_Init, -1 when the platform is not supported.
+};
+
+static int loopback_index = -1;
+static int other_index = -1;
+
+static void select_loopback() {
+	Speech_Set_Driver(loopback_index);
+	Loopback_Reset();
+}
+
+static void stop_async() {
+	Speech_Set_Async(false);
+}
+
+static void start_async_priority() {
+	Speech_Reset_Priority_Stats();
+	Speech_Set_Async(true);
+}
+
+// Per class queueing latency and preemption from the scheduler, collected after the queue drained.
+static void report_priority(string& fields) {
+	static const char* names[] = { "critical", "high", "normal", "low", "progress" };
+	char buffer[256];
+	fields += ", \"classes\": {";
+	for (uint32_t priority = SC_PRIORITY_CRITICAL; priority <= SC_PRIORITY_PROGRESS; priority++) {
+		uint64_t delivered = 0, preempted = 0, mean = 0, max = 0;
+		Speech_Get_Priority_Stats(priority, &delivered, &preempted, &mean, &max);
+		snprintf(buffer, sizeof(buffer), "%s\"%s\": {\"delivered\": %llu, \"preempted\": %llu, \"mean_latency_us\": %llu, \"max_latency_us\": %llu}",
+			(priority > SC_PRIORITY_CRITICAL) ? ", " : "", names[priority - 1], static_cast<unsigned long long>(delivered),
+			static_cast<unsigned long long>(preempted), static_cast<unsigned long long>(mean), static_cast<unsigned long long>(max));
+		fields += buffer;
+	}
+	fields += "}";
+}
+
+// The *_stats cases repeat a case with driver call statistics enabled, the difference is the instrumentation overhead.
+static void enable_stats() {
+	Speech_Reset_Stats();
+	Speech_Enable_Stats(true);
+}
+
+static void disable_stats() {
+	Speech_Enable_Stats(false);
+}
+
+// output_trace records every event into a ring buffer, the cost with tracing active.
+static void enable_trace() {
+	Speech_Set_Trace_Buffer(65536);
+}
+
+static void disable_trace() {
+	Speech_Set_Trace_Buffer(0);
+}
+
+static const bench_case cases[] = {
+	{ "output", nullptr, [](unsigned, size_t) { Speech_Output(L"SpeechCore benchmark", false); }, nullptr, nullptr },
+	{ "output_stats", enable_stats, [](unsigned, size_t) { Speech_Output(L"SpeechCore benchmark", false); }, disable_stats, nullptr },
+	{ "output_trace", enable_trace, [](unsigned, size_t) { Speech_Output(L"SpeechCore benchmark", false); }, disable_trace, nullptr },
+	{ "output_interrupt", nullptr, [](unsigned, size_t) { Speech_Output(L"SpeechCore benchmark", true); }, nullptr, nullptr },
+	{ "output_async", [] { Speech_Set_Async(true); }, [](unsigned, size_t) { Speech_Output(L"SpeechCore benchmark", false); }, stop_async, nullptr },
+	{ "output_async_priority", start_async_priority, [](unsigned, size_t iteration) { Speech_Output_Priority(L"SpeechCore benchmark", static_cast<uint32_t>(SC_PRIORITY_CRITICAL + iteration % 5)); }, stop_async, report_priority },
+	{ "detect_driver", nullptr, [](unsigned, size_t) { Speech_Detect_Driver(); }, nullptr, nullptr },
+	{ "is_speaking", nullptr, [](unsigned, size_t) { Speech_Is_Speaking(); }, nullptr, nullptr },
+	{ "get_volume", nullptr, [](unsigned, size_t) { Speech_Get_Volume(); }, nullptr, nullptr },
+	{ "get_volume_stats", enable_stats, [](unsigned, size_t) { Speech_Get_Volume(); }, disable_stats, nullptr },
+	{ "get_rate", nullptr, [](unsigned, size_t) { Speech_Get_Rate(); }, nullptr, nullptr },
+	{ "get_current_voice", nullptr, [](unsigned, size_t) { Speech_Get_Current_Voice(); }, nullptr, nullptr },
+	{ "get_flags", nullptr, [](unsigned, size_t) { Speech_Get_Flags(); }, nullptr, nullptr },
+	{ "set_driver", nullptr, [](unsigned, size_t iteration) { Speech_Set_Driver((iteration & 1) ? other_index : loopback_index); }, nullptr, nullptr },
+};
+
+static uint64_t percentile(const vector<uint64_t>& sorted, double fraction) {
+	if (sorted.empty()) {
+		return 0;
+	}
+	size_t index = static_cast<size_t>(fraction * sorted.size());
+	return sorted[min(index, sorted.size() - 1)];
+}
+
+static int64_t resident_kb() {
+#ifdef _WIN32
+	PROCESS_MEMORY_COUNTERS counters;
+	if (K32GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+		return static_cast<int64_t>(counters.WorkingSetSize / 1024);
+	}
+#elif defined(__linux__)
+	FILE* statm = fopen("/proc/self/statm", "r");
+	if (statm != nullptr) {
+		long pages = 0, resident = 0;
+		int fields = fscanf(statm, "%ld %ld", &pages, &resident);
+		fclose(statm);
+		if (fields == 2) {
+			return static_cast<int64_t>(resident) * 4;
+		}
+	}
+#endif // _WIN32
+	return -1;
+}
+
+static uint64_t timed_init(bool lazy, int64_t& rss_kb) {
+	Speech_Set_Lazy_Loading(lazy);
+	int64_t rss_before = resident_kb();
+	bench_clock::time_point start = bench_clock::now();
+	Speech_Init();
+	uint64_t init_ns = static_cast<uint64_t>(chrono::duration_cast<chrono::nanoseconds>(bench_clock::now() - start).count());
+	int64_t rss_after = resident_kb();
+	Speech_Free();
+	Speech_Set_Lazy_Loading(false);
+	rss_kb = (rss_before >= 0 && rss_after >= 0) ? rss_after - rss_before : -1;
+	return init_ns;
+}
+
+// Runs before anything else, with lazy first, so the lazy memory figure is not flattered by modules the eager run left mapped.
+// Runs alternate between the two modes so warm up costs do not favour either.
+static void measure_startup(startup_result& lazy, startup_result& eager) {
+	const size_t runs = 5;
+	vector<uint64_t> lazy_ns, eager_ns;
+	for (size_t run = 0; run < runs; run++) {
+		int64_t rss_kb = 0;
+		lazy_ns.push_back(timed_init(true, rss_kb));
+		if (run == 0) {
+			lazy.rss_kb = rss_kb;
+		}
+		eager_ns.push_back(timed_init(false, rss_kb));
+		if (run == 0) {
+			eager.rss_kb = rss_kb;
+		}
+	}
+	sort(lazy_ns.begin(), lazy_ns.end());
+	sort(eager_ns.begin(), eager_ns.end());
+	lazy.init_ns = percentile(lazy_ns, 0.5);
+	eager.init_ns = percentile(eager_ns, 0.5);
+}
+
+static bench_result run_case(const bench_case& test, unsigned threads, size_t iterations) {
+	select_loopback();
+	if (test.setup) {
+		test.setup();
+	}
+
+	vector<vector<uint64_t>> samples(threads);
+	vector<thread> workers;
+	atomic<unsigned> ready{ 0 };
+	atomic<bool> go{ false };
+	for (unsigned t = 0; t < threads; t++) {
+		workers.emplace_back([&, t] {
+			vector<uint64_t>& latencies = samples[t];
+			latencies.resize(iterations);
+			ready.fetch_add(1);
+			while (!go.load(memory_order_acquire)) {
+				this_thread::yield();
+			}
+			for (size_t i = 0; i < iterations; i++) {
+				bench_clock::time_point start = bench_clock::now();
+				test.op(t, i);
+				latencies[i] = static_cast<uint64_t>(chrono::duration_cast<chrono::nanoseconds>(bench_clock::now() - start).count());
+			}
+		});
+	}
+	while (ready.load() < threads) {
+		this_thread::yield();
+	}
+	bench_clock::time_point start = bench_clock::now();
+	go.store(true, memory_order_release);
+	for (auto& worker : workers) {
+		worker.join();
+	}
+	double seconds = chrono::duration<double>(bench_clock::now() - start).count();
+	if (test.teardown) {
+		test.teardown();
+	}
+	string fields;
+	if (test.report) {
+		test.report(fields);
+	}
+
+	vector<uint64_t> all;
+	all.reserve(static_cast<size_t>(threads) * iterations);
+	for (auto& latencies : samples) {
+		all.insert(all.end(), latencies.begin(), latencies.end());
+	}
+	sort(all.begin(), all.end());
+	return { test.name, threads, all.size(), seconds, percentile(all, 0.50), percentile(all, 0.99), percentile(all, 0.999), all.empty() ? 0 : all.back(), fields };
+}
+
+static void write_json(FILE* out, const bench_options& options, const startup_result& lazy, const startup_result& eager, const vector<bench_result>& results) {
+	fprintf(out, "{\n");
+	fprintf(out, "  \"benchmark\": \"speechcore_bench\",\n");
+	fprintf(out, "  \"startup\": {\"lazy\": {\"init_ns\": %llu, \"rss_kb\": %lld}, \"eager\": {\"init_ns\": %llu, \"rss_kb\": %lld}},\n",
+		static_cast<unsigned long long>(lazy.init_ns), static_cast<long long>(lazy.rss_kb),
+		static_cast<unsigned long long>(eager.init_ns), static_cast<long long>(eager.rss_kb));
+	fprintf(out, "  \"iterations\": %zu,\n", options.iterations);
+	fprintf(out, "  \"max_threads\": %u,\n", options.threads);
+	fprintf(out, "  \"speak_latency_us\": %u,\n", options.speak_latency_us);
+	fprintf(out, "  \"results\": [\n");
+	for (size_t i = 0; i < results.size(); i++) {
+		const bench_result& result = results[i];
+		fprintf(out, "    {\"case\": \"%s\", \"threads\": %u, \"ops\": %zu, \"seconds\": %.6f, \"ops_per_sec\": %.1f, "
+			"\"p50_ns\": %llu, \"p99_ns\": %llu, \"p999_ns\": %llu, \"max_ns\": %llu%s}%s\n",
+			result.name.c_str(), result.threads, result.ops, result.seconds, result.seconds > 0 ? result.ops / result.seconds : 0.0,
+			static_cast<unsigned long long>(result.p50_ns), static_cast<unsigned long long>(result.p99_ns),
+			static_cast<unsigned long long>(result.p999_ns), static_cast<unsigned long long>(result.max_ns), result.fields.c_str(),
+			(i + 1 < results.size()) ? "," : "");
+	}
+	fprintf(out, "  ]\n}\n");
+}
+
+static bool parse_options(int argc, char** argv, bench_options& options) {
+	for (int i = 1; i < argc; i++) {
+		const char* arg = argv[i];
+		const char* value = (i + 1 < argc) ? argv[i + 1] : nullptr;
+		if (value == nullptr) {
+			return false;
+		}
+		if (!strcmp(arg, "--threads")) {
+			options.threads = max(1, atoi(value));
+		}
+		else if (!strcmp(arg, "--iterations")) {
+			options.iterations = strtoull(value, nullptr, 10);
+		}
+		else if (!strcmp(arg, "--filter")) {
+			options.filter = value;
+		}
+		else if (!strcmp(arg, "--speak-latency-us")) {
+			options.speak_latency_us = static_cast<uint32_t>(strtoul(value, nullptr, 10));
+		}
+		else if (!strcmp(arg, "--output")) {
+			options.output = value;
+		}
+		else {
+			return false;
+		}
+		i++;
+	}
+	return true;
+}
+
+int main(int argc, char** argv) {
+	bench_options options;
+	if (!parse_options(argc, argv, options)) {
+		fprintf(stderr, "usage: %s [--threads N] [--iterations N] [--filter NAME] [--speak-latency-us N] [--output FILE]\n", argv[0]);
+		return 2;
+	}
+
+	startup_result lazy, eager;
+	measure_startup(lazy, eager);
+
+	Speech_Init();
+	for (int i = 0; i < Speech_Get_Drivers(); i++) {
+		if (!wcscmp(Speech_Get_Driver(i), L"Loopback")) {
+			loopback_index = i;
+		}
+		else if (other_index < 0) {
+			other_index = i;
+		}
+	}
+	if (loopback_index < 0) {
+		fprintf(stderr, "loopback driver not available\n");
+		Speech_Free();
+		return 1;
+	}
+	if (other_index < 0) {
+		other_index = loopback_index;
+	}
+	Loopback_Set_Seed(0);
+	if (options.speak_latency_us > 0) {
+		Loopback_Set_Latency(SC_LOOPBACK_SPEAK, SC_LATENCY_FIXED, options.speak_latency_us, 0);
+	}
+
+	vector<unsigned> thread_counts;
+	for (unsigned threads = 1; threads < options.threads; threads *= 2) {
+		thread_counts.push_back(threads);
+	}
+	thread_counts.push_back(options.threads);
+
+	vector<bench_result> results;
+	for (const bench_case& test : cases) {
+		if (options.filter && !strstr(test.name, options.filter)) {
+			continue;
+		}
+		for (unsigned threads : thread_counts) {
+			results.push_back(run_case(test, threads, options.iterations));
+			fprintf(stderr, "%-20s threads=%-3u p50=%lluns p99=%lluns\n", test.name, threads,
+				static_cast<unsigned long long>(results.back().p50_ns), static_cast<unsigned long long>(results.back().p99_ns));
+		}
+	}
+	Speech_Free();
+
+	FILE* out = options.output ? fopen(options.output, "w") : stdout;
+	if (out == nullptr) {
+		fprintf(stderr, "can't open %s\n", options.output);
+		return 1;
+	}
+	write_json(out, options, lazy, eager, results);
+	if (out != stdout) {
+		fclose(out);
+	}
+	return 0;
+}
@@ -0,0 +1,206 @@
+// ssip_bench: messages per second through the Speech Dispatcher driver, once over libspeechd and once over the
+// built in SSIP client, both talking to the fake server from fake_ssip_server.cpp. The server queues and finishes
+// every message at once, so what is measured is the client side and the socket round trips.
+// Then, per path, the server is stopped, messages are spoken during the outage and the server is started again:
+// the driver has to reconnect on its own and deliver every message held meanwhile.
+// A path whose setup fails (libspeechd not installed, say) is reported as unavailable. Results are written as JSON.
+// Exits with 1 if an available path lost a message or did not recover every held message after the restart.
+//
+// Usage: ssip_bench [--messages N] [--outage-ms N] [--socket PATH] [--output FILE]
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cwchar>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include "SpeechCore.h"
+#include "fake_ssip_server.h"
+
+using namespace std;
+using bench_clock = chrono::steady_clock;
+
+struct bench_options {
+	size_t messages = 20000;
+	uint32_t outage_ms = 300;
+	string socket;
+	const char* output = nullptr;
+};
+
+struct path_result {
+	bool available = false;
+	double seconds = 0.0;
+	uint64_t received = 0; // Messages the server got, should equal the messages sent.
+};
+
+struct restart_result {
+	bool available = false;
+	bool recovered = false;
+	double recovery_ms = 0.0; // From the server being back until every held message was delivered.
+	uint64_t held = 0;
+	uint64_t received = 0;
+};
+
+static bool select_dispatcher() {
+	for (int i = 0; i < Speech_Get_Drivers(); i++) {
+		if (!wcscmp(Speech_Get_Driver(i), L"Speech Dispatcher")) {
+			Speech_Set_Driver(i);
+			return Speech_Current_Driver() != nullptr && !wcscmp(Speech_Current_Driver(), L"Speech Dispatcher");
+		}
+	}
+	return false;
+}
+
+static path_result run_path(bool native, size_t messages, FakeSsipServer& server) {
+	path_result result;
+	Speech_Set_Native_Ssip(native);
+	Speech_Init();
+	// The warm up message also proves the driver is connected to the fake server and not to something else.
+	uint64_t before = server.messages();
+	if (select_dispatcher() && Speech_Output(L"warm up", false) && Speech_Wait_Until_Done(1000) && server.messages() == before + 1) {
+		before = server.messages();
+		auto start = bench_clock::now();
+		for (size_t i = 0; i < messages; i++) {
+			Speech_Output(L"The quick brown fox jumps over the lazy dog.", false);
+		}
+		Speech_Wait_Until_Done(60000);
+		result.seconds = chrono::duration<double>(bench_clock::now() - start).count();
+		result.received = server.messages() - before;
+		result.available = true;
+	}
+	Speech_Free();
+	return result;
+}
+
+static restart_result run_restart(bool native, uint32_t outage_ms, FakeSsipServer& server, const string& socket) {
+	const uint64_t held = 32;
+	restart_result result;
+	Speech_Set_Native_Ssip(native);
+	Speech_Init();
+	uint64_t before = server.messages();
+	if (select_dispatcher() && Speech_Output(L"warm up", false) && Speech_Wait_Until_Done(1000) && server.messages() == before + 1) {
+		result.available = true;
+		server.stop();
+		for (uint64_t i = 0; i < held; i++) {
+			Speech_Output(L"Spoken while speech-dispatcher is down.", false);
+		}
+		this_thread::sleep_for(chrono::milliseconds(outage_ms));
+		before = server.messages();
+		server.start(socket);
+		auto start = bench_clock::now();
+		result.recovered = Speech_Wait_Until_Done(30000);
+		result.recovery_ms = chrono::duration<double, milli>(bench_clock::now() - start).count();
+		result.held = held;
+		result.received = server.messages() - before;
+	}
+	Speech_Free();
+	return result;
+}
+
+static bool path_passed(const path_result& result, size_t messages) {
+	return !result.available || result.received == messages;
+}
+
+static bool restart_passed(const restart_result& result) {
+	return !result.available || (result.recovered && result.received == result.held);
+}
+
+static void write_restart(FILE* out, const char* name, const restart_result& result, bool last) {
+	if (!result.available) {
+		fprintf(out, "    \"%s\": {\"available\": false}%s\n", name, last ? "" : ",");
+		return;
+	}
+	fprintf(out, "    \"%s\": {\"available\": true, \"recovered\": %s, \"recovery_ms\": %.1f, \"held\": %llu, \"received\": %llu}%s\n",
+		name, result.recovered ? "true" : "false", result.recovery_ms, static_cast<unsigned long long>(result.held),
+		static_cast<unsigned long long>(result.received), last ? "" : ",");
+}
+
+static void write_path(FILE* out, const char* name, const path_result& result, size_t messages, bool last) {
+	if (!result.available) {
+		fprintf(out, "  \"%s\": {\"available\": false}%s\n", name, last ? "" : ",");
+		return;
+	}
+	fprintf(out, "  \"%s\": {\"available\": true, \"seconds\": %.6f, \"messages_per_second\": %.1f, \"received\": %llu}%s\n",
+		name, result.seconds, (result.seconds > 0.0) ? static_cast<double>(messages) / result.seconds : 0.0,
+		static_cast<unsigned long long>(result.received), last ? "" : ",");
+}
+
+static bool parse_options(int argc, char** argv, bench_options& options) {
+	for (int i = 1; i < argc; i++) {
+		const char* arg = argv[i];
+		const char* value = (i + 1 < argc) ? argv[i + 1] : nullptr;
+		if (value == nullptr) {
+			return false;
+		}
+		if (!strcmp(arg, "--messages")) {
+			options.messages = strtoull(value, nullptr, 10);
+		}
+		else if (!strcmp(arg, "--outage-ms")) {
+			options.outage_ms = static_cast<uint32_t>(strtoul(value, nullptr, 10));
+		}
+		else if (!strcmp(arg, "--socket")) {
+			options.socket = value;
+		}
+		else if (!strcmp(arg, "--output")) {
+			options.output = value;
+		}
+		else {
+			return false;
+		}
+		i++;
+	}
+	return true;
+}
+
+int main(int argc, char** argv) {
+	bench_options options;
+	if (!parse_options(argc, argv, options)) {
+		fprintf(stderr, "usage: %s [--messages N] [--outage-ms N] [--socket PATH] [--output FILE]\n", argv[0]);
+		return 2;
+	}
+	if (options.socket.empty()) {
+		options.socket = "/tmp/speechcore-ssip-" + to_string(getpid()) + ".sock";
+	}
+
+	FakeSsipServer server;
+	if (!server.start(options.socket)) {
+		fprintf(stderr, "can't listen on %s\n", options.socket.c_str());
+		return 1;
+	}
+	// Both libspeechd and the built in client follow SPEECHD_ADDRESS.
+	setenv("SPEECHD_ADDRESS", ("unix_socket:" + options.socket).c_str(), 1);
+
+	path_result libspeechd = run_path(false, options.messages, server);
+	fprintf(stderr, "libspeechd %s\n", libspeechd.available ? "done" : "unavailable");
+	path_result native = run_path(true, options.messages, server);
+	fprintf(stderr, "native     %s\n", native.available ? "done" : "unavailable");
+	restart_result libspeechd_restart = run_restart(false, options.outage_ms, server, options.socket);
+	restart_result native_restart = run_restart(true, options.outage_ms, server, options.socket);
+	fprintf(stderr, "restart    libspeechd %s, native %s\n", libspeechd_restart.recovered ? "recovered" : "not recovered",
+		native_restart.recovered ? "recovered" : "not recovered");
+	server.stop();
+	bool passed = path_passed(libspeechd, options.messages) && path_passed(native, options.messages)
+		&& restart_passed(libspeechd_restart) && restart_passed(native_restart);
+	if (!passed) {
+		fprintf(stderr, "FAILED: messages were lost\n");
+	}
+
+	FILE* out = options.output ? fopen(options.output, "w") : stdout;
+	if (out == nullptr) {
+		fprintf(stderr, "can't open %s\n", options.output);
+		return 1;
+	}
+	fprintf(out, "{\n  \"messages\": %zu,\n", options.messages);
+	write_path(out, "libspeechd", libspeechd, options.messages, false);
+	write_path(out, "native", native, options.messages, false);
+	fprintf(out, "  \"restart\": {\n");
+	write_restart(out, "libspeechd", libspeechd_restart, false);
+	write_restart(out, "native", native_restart, true);
+	fprintf(out, "  },\n  \"passed\": %s\n}\n", passed ? "true" : "false");
+	if (out != stdout) {
+		fclose(out);
+	}
+	return passed ? 0 : 1;
+}
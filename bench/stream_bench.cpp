@@ -0,0 +1,209 @@
+// stream_bench: text streams fed a few bytes at a time, the way a language model writes.
+// Each corpus is a list of sentences streamed as UTF-8 in chunks of 1 to --max-chunk bytes, so characters get split
+// across appends. With the idle timeout off, a sentence may only reach the driver once the append carrying the first
+// character of the next one came in, and must reach it right then; the last sentence goes out on close. Every piece
+// the loopback driver recorded has to be exactly one sentence, in order. "e.g." is not a sentence end.
+// Exits with 1 if a check fails, the results and the time per append are written as JSON either way.
+//
+// Usage: stream_bench [--max-chunk N] [--output FILE]
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cwchar>
+#include <string>
+#include <vector>
+#include "SpeechCore.h"
+
+using namespace std;
+using bench_clock = chrono::steady_clock;
+
+struct bench_options {
+	size_t max_chunk = 8;
+	const char* output = nullptr;
+};
+
+struct corpus {
+	const char* name;
+	vector<const wchar_t*> sentences;
+};
+
+static const corpus corpora[] = {
+	{ "english", {
+		L"Streaming text arrives a few characters at a time. ",
+		L"Is every sentence spoken once it is complete? ",
+		L"It should be, e.g. this one waits for its end! ",
+		L"\"Quoted sentences keep their closing quote.\" ",
+		L"The last one goes out on close.",
+	} },
+	{ "cjk", {
+		L"\u8A2D\u5B9A\u306F\u4FDD\u5B58\u3055\u308C\u307E\u3059\u3002",
+		L"\u97F3\u58F0\u306F\u3059\u3050\u306B\u5909\u308F\u308A\u307E\u3059\u3002",
+		L"\u672C\u5F53\u3067\u3059\u304B\uFF1F",
+		L"\u7D42\u308F\u308A",
+	} },
+};
+
+struct chunk_result {
+	size_t chunk;
+	size_t appends = 0;
+	size_t pieces = 0; // Pieces the driver got.
+	size_t misplaced = 0; // Pieces that were not the next sentence, or went out at the wrong append.
+	double append_us = 0; // Mean time per append, speaking included.
+};
+
+// The corpus is plain BMP text, so every wchar_t is one code point whatever its size.
+static string to_utf8(const wchar_t* text) {
+	string utf8;
+	for (; *text; text++) {
+		uint32_t c = static_cast<uint32_t>(*text);
+		if (c < 0x80) {
+			utf8 += static_cast<char>(c);
+		}
+		else if (c < 0x800) {
+			utf8 += static_cast<char>(0xC0 | (c >> 6));
+			utf8 += static_cast<char>(0x80 | (c & 0x3F));
+		}
+		else {
+			utf8 += static_cast<char>(0xE0 | (c >> 12));
+			utf8 += static_cast<char>(0x80 | ((c >> 6) & 0x3F));
+			utf8 += static_cast<char>(0x80 | (c & 0x3F));
+		}
+	}
+	return utf8;
+}
+
+static wstring trimmed(const wchar_t* text) {
+	wstring result(text);
+	size_t first = result.find_first_not_of(L" ");
+	size_t last = result.find_last_not_of(L" ");
+	return (first == wstring::npos) ? wstring() : result.substr(first, last - first + 1);
+}
+
+// Checks the piece recorded after bytes [from, to) were appended: it must be the next sentence, and the append must
+// be the one carrying the first byte of the sentence after it. starts holds where each sentence begins.
+static bool check_piece(const corpus& text, const vector<size_t>& starts, size_t piece, size_t from, size_t to, bool closing) {
+	sc_loopback_record record;
+	if (piece >= text.sentences.size() || !Loopback_Get_Record(piece, &record) || record.call != SC_LOOPBACK_SPEAK) {
+		return false;
+	}
+	if (trimmed(record.text) != trimmed(text.sentences[piece])) {
+		return false;
+	}
+	if (piece + 1 == text.sentences.size()) {
+		return closing;
+	}
+	return !closing && from <= starts[piece + 1] && starts[piece + 1] < to;
+}
+
+static chunk_result run_chunk(const corpus& text, size_t chunk) {
+	chunk_result result;
+	result.chunk = chunk;
+	string utf8;
+	vector<size_t> starts;
+	for (const wchar_t* sentence : text.sentences) {
+		starts.push_back(utf8.size());
+		utf8 += to_utf8(sentence);
+	}
+
+	Loopback_Reset();
+	uint64_t stream = Speech_Stream_Open(0);
+	size_t recorded = 0;
+	bench_clock::time_point start = bench_clock::now();
+	for (size_t offset = 0; offset < utf8.size(); offset += chunk) {
+		size_t length = (utf8.size() - offset < chunk) ? utf8.size() - offset : chunk;
+		Speech_Stream_Append_Utf8(stream, utf8.data() + offset, length);
+		result.appends++;
+		for (; recorded < Loopback_Get_Records(); recorded++) {
+			result.misplaced += check_piece(text, starts, recorded, offset, offset + length, false) ? 0 : 1;
+		}
+	}
+	result.append_us = chrono::duration<double, micro>(bench_clock::now() - start).count() / static_cast<double>(result.appends);
+	Speech_Stream_Close(stream);
+	for (; recorded < Loopback_Get_Records(); recorded++) {
+		result.misplaced += check_piece(text, starts, recorded, utf8.size(), utf8.size(), true) ? 0 : 1;
+	}
+	result.pieces = recorded;
+	return result;
+}
+
+static bool parse_options(int argc, char** argv, bench_options& options) {
+	for (int i = 1; i < argc; i++) {
+		const char* arg = argv[i];
+		const char* value = (i + 1 < argc) ? argv[i + 1] : nullptr;
+		if (value == nullptr) {
+			return false;
+		}
+		if (!strcmp(arg, "--max-chunk")) {
+			options.max_chunk = strtoull(value, nullptr, 10);
+		}
+		else if (!strcmp(arg, "--output")) {
+			options.output = value;
+		}
+		else {
+			return false;
+		}
+		i++;
+	}
+	return options.max_chunk > 0;
+}
+
+int main(int argc, char** argv) {
+	bench_options options;
+	if (!parse_options(argc, argv, options)) {
+		fprintf(stderr, "usage: %s [--max-chunk N] [--output FILE]\n", argv[0]);
+		return 2;
+	}
+	Speech_Init();
+	int loopback_index = -1;
+	for (int i = 0; i < Speech_Get_Drivers(); i++) {
+		if (!wcscmp(Speech_Get_Driver(i), L"Loopback")) {
+			loopback_index = i;
+		}
+	}
+	if (loopback_index < 0) {
+		fprintf(stderr, "loopback driver not available\n");
+		Speech_Free();
+		return 1;
+	}
+	Speech_Set_Driver(loopback_index);
+	// Only boundaries and close may flush, so where each sentence went out does not depend on timing.
+	Speech_Set_Stream_Idle_Timeout(0);
+
+	size_t corpus_count = sizeof(corpora) / sizeof(corpora[0]);
+	vector<vector<chunk_result>> results(corpus_count);
+	bool passed = true;
+	for (size_t i = 0; i < corpus_count; i++) {
+		for (size_t chunk = 1; chunk <= options.max_chunk; chunk++) {
+			chunk_result result = run_chunk(corpora[i], chunk);
+			bool ok = result.misplaced == 0 && result.pieces == corpora[i].sentences.size();
+			passed = passed && ok;
+			fprintf(stderr, "%-8s chunk=%-3zu appends=%-4zu pieces=%zu misplaced=%zu %.2fus/append%s\n", corpora[i].name, chunk,
+				result.appends, result.pieces, result.misplaced, result.append_us, ok ? "" : " FAILED");
+			results[i].push_back(result);
+		}
+	}
+	Speech_Free();
+
+	FILE* out = options.output ? fopen(options.output, "w") : stdout;
+	if (out == nullptr) {
+		fprintf(stderr, "can't open %s\n", options.output);
+		return 1;
+	}
+	fprintf(out, "{\n  \"benchmark\": \"stream_bench\",\n  \"max_chunk\": %zu,\n  \"corpora\": {\n", options.max_chunk);
+	for (size_t i = 0; i < corpus_count; i++) {
+		fprintf(out, "    \"%s\": [\n", corpora[i].name);
+		for (size_t r = 0; r < results[i].size(); r++) {
+			const chunk_result& result = results[i][r];
+			fprintf(out, "      {\"chunk\": %zu, \"appends\": %zu, \"pieces\": %zu, \"misplaced\": %zu, \"append_us\": %.3f}%s\n",
+				result.chunk, result.appends, result.pieces, result.misplaced, result.append_us, (r + 1 < results[i].size()) ? "," : "");
+		}
+		fprintf(out, "    ]%s\n", (i + 1 < corpus_count) ? "," : "");
+	}
+	fprintf(out, "  },\n  \"passed\": %s\n}\n", passed ? "true" : "false");
+	if (out != stdout) {
+		fclose(out);
+	}
+	return passed ? 0 : 1;
+}
@@ -0,0 +1,211 @@
+// stress_bench: Speech_Output from many threads while another thread keeps switching drivers.
+// --threads threads each speak --iterations distinct texts, while one more thread alternates Speech_Set_Driver
+// between the loopback driver and the first other driver, which exercises the RCU protected registry under load.
+// Every output must reach exactly one driver: the speak calls counted by the driver statistics have to add up to the
+// outputs made, and every text the loopback driver recorded has to be one that was sent, intact and only once.
+// Exits with 1 if a check fails, the results are written as JSON either way.
+//
+// Usage: stress_bench [--threads N] [--iterations N] [--output FILE]
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cwchar>
+#include <string>
+#include <thread>
+#include <vector>
+#include "SpeechCore.h"
+
+using namespace std;
+using bench_clock = chrono::steady_clock;
+
+struct bench_options {
+	unsigned threads = 16;
+	size_t iterations = 2000;
+	const char* output = nullptr;
+};
+
+struct stress_result {
+	uint64_t outputs = 0; // Speech_Output calls made.
+	uint64_t accepted = 0; // Calls that returned true.
+	uint64_t switches = 0;
+	uint64_t speak_calls = 0; // Speak calls counted over every listed driver.
+	uint64_t speak_failures = 0;
+	uint64_t loopback_calls = 0;
+	uint64_t malformed = 0; // Recorded texts that were never sent.
+	uint64_t duplicates = 0; // Recorded texts that arrived more than once.
+	double seconds = 0;
+};
+
+static int loopback_index = -1;
+static int other_index = -1;
+
+// Texts are "<thread> <iteration>", so a record can be traced back to exactly one call.
+static bool parse_text(const wchar_t* text, const bench_options& options, size_t& slot) {
+	wchar_t* end = nullptr;
+	unsigned long thread = wcstoul(text, &end, 10);
+	if (end == text || *end != L' ') {
+		return false;
+	}
+	const wchar_t* rest = end + 1;
+	unsigned long long iteration = wcstoull(rest, &end, 10);
+	if (end == rest || *end != 0 || thread >= options.threads || iteration >= options.iterations) {
+		return false;
+	}
+	slot = thread * options.iterations + static_cast<size_t>(iteration);
+	return true;
+}
+
+static stress_result run_stress(const bench_options& options) {
+	stress_result result;
+	Speech_Set_Driver(loopback_index);
+	Loopback_Reset();
+	Speech_Reset_Stats();
+	Speech_Enable_Stats(true);
+
+	vector<thread> workers;
+	atomic<uint64_t> accepted{ 0 };
+	atomic<unsigned> running{ options.threads };
+	atomic<bool> go{ false };
+	for (unsigned t = 0; t < options.threads; t++) {
+		workers.emplace_back([&, t] {
+			wchar_t text[64];
+			uint64_t spoken = 0;
+			while (!go.load(memory_order_acquire)) {
+				this_thread::yield();
+			}
+			for (size_t i = 0; i < options.iterations; i++) {
+				swprintf(text, 64, L"%u %zu", t, i);
+				spoken += Speech_Output(text, false) ? 1 : 0;
+			}
+			accepted.fetch_add(spoken);
+			running.fetch_sub(1, memory_order_release);
+		});
+	}
+	thread switcher([&] {
+		while (!go.load(memory_order_acquire)) {
+			this_thread::yield();
+		}
+		while (running.load(memory_order_acquire) > 0) {
+			Speech_Set_Driver((result.switches & 1) ? other_index : loopback_index);
+			result.switches++;
+		}
+	});
+	bench_clock::time_point start = bench_clock::now();
+	go.store(true, memory_order_release);
+	for (auto& worker : workers) {
+		worker.join();
+	}
+	switcher.join();
+	result.seconds = chrono::duration<double>(bench_clock::now() - start).count();
+	Speech_Enable_Stats(false);
+
+	result.outputs = static_cast<uint64_t>(options.threads) * options.iterations;
+	result.accepted = accepted.load();
+	for (int i = 0; i < Speech_Get_Drivers(); i++) {
+		sc_driver_stats stats;
+		if (Speech_Get_Stats(i, &stats)) {
+			result.speak_calls += stats.calls[SC_STAT_SPEAK].calls;
+			result.speak_failures += stats.calls[SC_STAT_SPEAK].failures;
+		}
+	}
+	result.loopback_calls = Loopback_Get_Calls(SC_LOOPBACK_SPEAK);
+	vector<bool> seen(static_cast<size_t>(result.outputs), false);
+	sc_loopback_record record;
+	for (size_t i = 0; Loopback_Get_Record(i, &record); i++) {
+		if (record.call != SC_LOOPBACK_SPEAK) {
+			continue;
+		}
+		size_t slot;
+		if (!parse_text(record.text, options, slot)) {
+			result.malformed++;
+		}
+		else if (seen[slot]) {
+			result.duplicates++;
+		}
+		else {
+			seen[slot] = true;
+		}
+	}
+	return result;
+}
+
+static bool parse_options(int argc, char** argv, bench_options& options) {
+	for (int i = 1; i < argc; i++) {
+		const char* arg = argv[i];
+		const char* value = (i + 1 < argc) ? argv[i + 1] : nullptr;
+		if (value == nullptr) {
+			return false;
+		}
+		if (!strcmp(arg, "--threads")) {
+			options.threads = max(1, atoi(value));
+		}
+		else if (!strcmp(arg, "--iterations")) {
+			options.iterations = strtoull(value, nullptr, 10);
+		}
+		else if (!strcmp(arg, "--output")) {
+			options.output = value;
+		}
+		else {
+			return false;
+		}
+		i++;
+	}
+	return options.iterations > 0;
+}
+
+int main(int argc, char** argv) {
+	bench_options options;
+	if (!parse_options(argc, argv, options)) {
+		fprintf(stderr, "usage: %s [--threads N] [--iterations N] [--output FILE]\n", argv[0]);
+		return 2;
+	}
+	Speech_Init();
+	for (int i = 0; i < Speech_Get_Drivers(); i++) {
+		if (!wcscmp(Speech_Get_Driver(i), L"Loopback")) {
+			loopback_index = i;
+		}
+		else if (other_index < 0) {
+			other_index = i;
+		}
+	}
+	if (loopback_index < 0) {
+		fprintf(stderr, "loopback driver not available\n");
+		Speech_Free();
+		return 1;
+	}
+	if (other_index < 0) {
+		other_index = loopback_index;
+	}
+
+	stress_result result = run_stress(options);
+	Speech_Free();
+
+	bool delivered = result.speak_calls == result.outputs && result.accepted == result.outputs - result.speak_failures;
+	bool intact = result.malformed == 0 && result.duplicates == 0 && result.loopback_calls <= result.speak_calls;
+	fprintf(stderr, "outputs=%llu accepted=%llu speak calls=%llu loopback=%llu switches=%llu: %s\n",
+		static_cast<unsigned long long>(result.outputs), static_cast<unsigned long long>(result.accepted),
+		static_cast<unsigned long long>(result.speak_calls), static_cast<unsigned long long>(result.loopback_calls),
+		static_cast<unsigned long long>(result.switches), (delivered && intact) ? "ok" : "FAILED");
+
+	FILE* out = options.output ? fopen(options.output, "w") : stdout;
+	if (out == nullptr) {
+		fprintf(stderr, "can't open %s\n", options.output);
+		return 1;
+	}
+	fprintf(out, "{\n  \"benchmark\": \"stress_bench\",\n  \"threads\": %u,\n  \"iterations\": %zu,\n", options.threads, options.iterations);
+	fprintf(out, "  \"seconds\": %.6f,\n  \"outputs\": %llu,\n  \"accepted\": %llu,\n  \"switches\": %llu,\n", result.seconds,
+		static_cast<unsigned long long>(result.outputs), static_cast<unsigned long long>(result.accepted), static_cast<unsigned long long>(result.switches));
+	fprintf(out, "  \"speak_calls\": %llu,\n  \"speak_failures\": %llu,\n  \"loopback_calls\": %llu,\n",
+		static_cast<unsigned long long>(result.speak_calls), static_cast<unsigned long long>(result.speak_failures),
+		static_cast<unsigned long long>(result.loopback_calls));
+	fprintf(out, "  \"malformed\": %llu,\n  \"duplicates\": %llu,\n  \"passed\": %s\n}\n", static_cast<unsigned long long>(result.malformed),
+		static_cast<unsigned long long>(result.duplicates), (delivered && intact) ? "true" : "false");
+	if (out != stdout) {
+		fclose(out);
+	}
+	return (delivered && intact) ? 0 : 1;
+}
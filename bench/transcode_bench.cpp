@@ -0,0 +1,237 @@
+// transcode_bench: wchar_t <-> UTF-8 conversion through src/SCCore/Transcode.cpp against the paths it replaced,
+// wcstombs / mbstowcs under a UTF-8 locale and std::wstring_convert (plus WideCharToMultiByte on Windows).
+// Each corpus is repeated up to --length code units, about what one screen reader message holds by default.
+// Every method's output is compared with the transcoder's, a mismatch is reported instead of a speed. Results are written as JSON.
+// Compare optimized builds: without optimization the transcoder's scalar path loses to the C library on non-ASCII text.
+//
+// Usage: transcode_bench [--iterations N] [--length N] [--output FILE]
+#ifdef _MSC_VER
+#define _SILENCE_CXX17_CODECVT_HEADER_DEPRECATION_WARNING
+#endif // _MSC_VER
+#include <chrono>
+#include <clocale>
+#include <codecvt>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cwchar>
+#include <locale>
+#include <string>
+#include <vector>
+#include "../src/SCCore/Transcode.h"
+#ifdef _WIN32
+#include <Windows.h>
+#endif // _WIN32
+
+#if defined(__GNUC__)
+#pragma GCC diagnostic ignored "-Wdeprecated-declarations"
+#endif
+
+using namespace std;
+using bench_clock = chrono::steady_clock;
+
+struct bench_options {
+	size_t iterations = 200000;
+	size_t length = 256;
+	const char* output = nullptr;
+};
+
+struct corpus {
+	const char* name;
+	const wchar_t* sample;
+};
+
+static const corpus corpora[] = {
+	{ "ascii", L"The quick brown fox jumps over the lazy dog. Press Enter to activate, Tab to move. " },
+	{ "latin1", L"\u00C7a d\u00E9j\u00E0 \u00E9t\u00E9 l\u00E0, na\u00EFve fa\u00E7ade, Stra\u00DFe \u00FCber M\u00FCnchen. " },
+	{ "cjk", L"\u65E5\u672C\u8A9E\u306E\u30C6\u30AD\u30B9\u30C8\u8AAD\u307F\u4E0A\u3052\u3001\u4E2D\u6587\u8BED\u97F3\u5408\u6210\u3002\uD55C\uAD6D\uC5B4 " },
+	{ "emoji", L"Nice \U0001F600\U0001F389\U0001F44D\U0001F3FD \U0001F680 launch \U0001F525\U0001F4AF\u2764\uFE0F " },
+};
+
+// Wraps wstring_convert the way AVTts.cpp and the Python bindings used it, UTF-16 on Windows and UTF-32 elsewhere.
+#ifdef _WIN32
+using old_converter = wstring_convert<codecvt_utf8_utf16<wchar_t>>;
+#else
+using old_converter = wstring_convert<codecvt_utf8<wchar_t>>;
+#endif
+
+struct method_result {
+	const char* method;
+	bool matches = false;
+	double ns_per_call = 0.0;
+	double mb_per_second = 0.0; // UTF-8 megabytes, on both directions.
+};
+
+template<typename Fn>
+static method_result measure(const char* method, size_t iterations, size_t utf8_bytes, bool matches, Fn&& fn) {
+	method_result result;
+	result.method = method;
+	result.matches = matches;
+	if (!matches) {
+		return result;
+	}
+	for (size_t i = 0; i < iterations / 100 + 1; i++) {
+		fn();
+	}
+	auto start = bench_clock::now();
+	for (size_t i = 0; i < iterations; i++) {
+		fn();
+	}
+	double seconds = chrono::duration<double>(bench_clock::now() - start).count();
+	result.ns_per_call = seconds * 1e9 / static_cast<double>(iterations);
+	result.mb_per_second = (seconds > 0.0) ? static_cast<double>(utf8_bytes) * static_cast<double>(iterations) / seconds / 1e6 : 0.0;
+	return result;
+}
+
+// Keeps the compiler from dropping conversions whose result is never used.
+static volatile size_t sink;
+
+static vector<method_result> run_encode(const wstring& text, const string& expected, size_t iterations) {
+	vector<method_result> results;
+	size_t bytes = expected.size();
+	results.push_back(measure("transcode", iterations, bytes, true, [&] {
+		size_t length;
+		transcode::to_utf8(text.c_str(), &length);
+		sink = length;
+	}));
+
+	vector<char> buffer(text.size() * 4 + 1);
+	size_t converted = wcstombs(buffer.data(), text.c_str(), buffer.size());
+	results.push_back(measure("wcstombs", iterations, bytes, converted == bytes && expected.compare(0, bytes, buffer.data(), converted) == 0, [&] {
+		sink = wcstombs(buffer.data(), text.c_str(), buffer.size());
+	}));
+
+	old_converter converter;
+	results.push_back(measure("wstring_convert", iterations, bytes, converter.to_bytes(text) == expected, [&] {
+		sink = old_converter().to_bytes(text).size();
+	}));
+
+#ifdef _WIN32
+	int written = WideCharToMultiByte(CP_UTF8, 0, text.c_str(), static_cast<int>(text.size()), buffer.data(), static_cast<int>(buffer.size()), nullptr, nullptr);
+	results.push_back(measure("WideCharToMultiByte", iterations, bytes, written == static_cast<int>(bytes) && expected.compare(0, bytes, buffer.data(), bytes) == 0, [&] {
+		sink = static_cast<size_t>(WideCharToMultiByte(CP_UTF8, 0, text.c_str(), static_cast<int>(text.size()), buffer.data(), static_cast<int>(buffer.size()), nullptr, nullptr));
+	}));
+#endif // _WIN32
+	return results;
+}
+
+static vector<method_result> run_decode(const string& text, const wstring& expected, size_t iterations) {
+	vector<method_result> results;
+	size_t bytes = text.size();
+	size_t length;
+	const wchar_t* decoded = transcode::to_wide(text.c_str(), &length);
+	results.push_back(measure("transcode", iterations, bytes, expected == wstring(decoded, length), [&] {
+		size_t count;
+		transcode::to_wide(text.c_str(), &count);
+		sink = count;
+	}));
+
+	vector<wchar_t> buffer(text.size() + 1);
+	size_t converted = mbstowcs(buffer.data(), text.c_str(), buffer.size());
+	results.push_back(measure("mbstowcs", iterations, bytes, converted == expected.size() && expected.compare(0, converted, buffer.data(), converted) == 0, [&] {
+		sink = mbstowcs(buffer.data(), text.c_str(), buffer.size());
+	}));
+
+	old_converter converter;
+	results.push_back(measure("wstring_convert", iterations, bytes, converter.from_bytes(text) == expected, [&] {
+		sink = old_converter().from_bytes(text).size();
+	}));
+
+#ifdef _WIN32
+	int written = MultiByteToWideChar(CP_UTF8, 0, text.c_str(), static_cast<int>(bytes), buffer.data(), static_cast<int>(buffer.size()));
+	results.push_back(measure("MultiByteToWideChar", iterations, bytes, written == static_cast<int>(expected.size()) && expected.compare(0, expected.size(), buffer.data(), expected.size()) == 0, [&] {
+		sink = static_cast<size_t>(MultiByteToWideChar(CP_UTF8, 0, text.c_str(), static_cast<int>(bytes), buffer.data(), static_cast<int>(buffer.size())));
+	}));
+#endif // _WIN32
+	return results;
+}
+
+static void write_results(FILE* out, const char* direction, const vector<method_result>& results, bool last) {
+	fprintf(out, "      \"%s\": {\n", direction);
+	for (size_t i = 0; i < results.size(); i++) {
+		const method_result& result = results[i];
+		const char* comma = (i + 1 < results.size()) ? "," : "";
+		if (!result.matches) {
+			fprintf(out, "        \"%s\": {\"matches\": false}%s\n", result.method, comma);
+			continue;
+		}
+		fprintf(out, "        \"%s\": {\"matches\": true, \"ns_per_call\": %.1f, \"mb_per_second\": %.1f}%s\n",
+			result.method, result.ns_per_call, result.mb_per_second, comma);
+	}
+	fprintf(out, "      }%s\n", last ? "" : ",");
+}
+
+static bool parse_options(int argc, char** argv, bench_options& options) {
+	for (int i = 1; i < argc; i++) {
+		const char* arg = argv[i];
+		const char* value = (i + 1 < argc) ? argv[i + 1] : nullptr;
+		if (value == nullptr) {
+			return false;
+		}
+		if (!strcmp(arg, "--iterations")) {
+			options.iterations = strtoull(value, nullptr, 10);
+		}
+		else if (!strcmp(arg, "--length")) {
+			options.length = strtoull(value, nullptr, 10);
+		}
+		else if (!strcmp(arg, "--output")) {
+			options.output = value;
+		}
+		else {
+			return false;
+		}
+		i++;
+	}
+	return options.iterations > 0 && options.length > 0;
+}
+
+int main(int argc, char** argv) {
+	bench_options options;
+	if (!parse_options(argc, argv, options)) {
+		fprintf(stderr, "usage: %s [--iterations N] [--length N] [--output FILE]\n", argv[0]);
+		return 2;
+	}
+	// wcstombs needs a UTF-8 locale to be comparable at all, the driver never set one.
+	const char* locales[] = { "C.UTF-8", "en_US.UTF-8", ".UTF-8" };
+	const char* locale = nullptr;
+	for (const char* name : locales) {
+		if ((locale = setlocale(LC_CTYPE, name)) != nullptr) {
+			break;
+		}
+	}
+	if (locale == nullptr) {
+		fprintf(stderr, "no UTF-8 locale, wcstombs and mbstowcs will not match\n");
+	}
+
+	FILE* out = options.output ? fopen(options.output, "w") : stdout;
+	if (out == nullptr) {
+		fprintf(stderr, "can't open %s\n", options.output);
+		return 1;
+	}
+	fprintf(out, "{\n  \"iterations\": %zu,\n  \"length\": %zu,\n  \"corpora\": {\n", options.iterations, options.length);
+	size_t corpus_count = sizeof(corpora) / sizeof(corpora[0]);
+	for (size_t i = 0; i < corpus_count; i++) {
+		wstring text;
+		while (text.size() < options.length) {
+			text += corpora[i].sample;
+		}
+		// Cut at a code point, not inside a surrogate pair.
+		size_t cut = options.length;
+		if (sizeof(wchar_t) == 2 && text[cut - 1] >= 0xD800 && text[cut - 1] <= 0xDBFF) {
+			cut--;
+		}
+		text.resize(cut);
+		string utf8 = transcode::utf8_string(text.c_str());
+
+		fprintf(stderr, "%s\n", corpora[i].name);
+		fprintf(out, "    \"%s\": {\n      \"utf8_bytes\": %zu,\n", corpora[i].name, utf8.size());
+		write_results(out, "encode", run_encode(text, utf8, options.iterations), false);
+		write_results(out, "decode", run_decode(utf8, text, options.iterations), true);
+		fprintf(out, "    }%s\n", (i + 1 < corpus_count) ? "," : "");
+	}
+	fprintf(out, "  }\n}\n");
+	if (out != stdout) {
+		fclose(out);
+	}
+	return 0;
+}
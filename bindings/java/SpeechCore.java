@@ -1,3 +1,6 @@
+import java.nio.ByteBuffer;
+import java.nio.ByteOrder;
+
 public class SpeechCore implements AutoCloseable {
     static {
         System.loadLibrary("SpeechCore");
@@ -10,6 +13,8 @@ public class SpeechCore implements AutoCloseable {
     public static final int SC_HAS_SPEECH = 1 << 4;
     public static final int SC_HAS_BRAILLE = 1 << 5;
 
+    public static final int SC_OUTPUT_INTERRUPT = 1 << 0;
+
     private native void Speech_Init();
     private native void Speech_Free();
     private native void Speech_Detect_Driver();
@@ -21,6 +26,8 @@ public class SpeechCore implements AutoCloseable {
     private native boolean Speech_Is_Loaded();
     private native boolean Speech_Is_Speaking();
     private native boolean Speech_Output(String text, boolean interrupt);
+    private native boolean Speech_Output_Batch(String[] texts, int flags);
+    private native boolean Speech_Output_Batch_Direct(ByteBuffer batch, int size, int count, int flags);
     private native boolean Speech_Braille(String text);
 
     private native boolean Speech_Stop();
@@ -99,6 +106,34 @@ public void close() {
         return Speech_Output(text, interrupt);
     }
 
+    public boolean speakBatch(String[] texts, boolean interrupt) {
+        return Speech_Output_Batch(texts, interrupt ? SC_OUTPUT_INTERRUPT : 0);
+    }
+
+    // Speaks the count texts packed into batch with putBatchText, from its start up to its position.
+    // The buffer is read in place, so a caller speaking often can reuse one instead of building String arrays.
+    public boolean speakBatch(ByteBuffer batch, int count, boolean interrupt) {
+        return Speech_Output_Batch_Direct(batch, batch.position(), count, interrupt ? SC_OUTPUT_INTERRUPT : 0);
+    }
+
+    // A direct buffer in native byte order, as speakBatch needs it.
+    public static ByteBuffer allocateBatch(int capacity) {
+        return ByteBuffer.allocateDirect(capacity).order(ByteOrder.nativeOrder());
+    }
+
+    // Appends text to a batch: its length in chars, the chars and a 0 char, padded to 4 bytes.
+    public static void putBatchText(ByteBuffer batch, CharSequence text) {
+        int length = text.length();
+        batch.putInt(length);
+        for (int i = 0; i < length; i++) {
+            batch.putChar(text.charAt(i));
+        }
+        batch.putChar((char) 0);
+        while ((batch.position() & 3) != 0) {
+            batch.put((byte) 0);
+        }
+    }
+
     public boolean outputBraille(String text) {
         return Speech_Braille(text);
     }
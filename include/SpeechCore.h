@@ -45,6 +45,72 @@
 #define SC_HAS_BRAILLE (1<<5)
 #define SC_HAS_SPEECH_STATE (1<<6)
 
+// Priority classes, highest first. The values match speech-dispatcher's SPDPriority.
+// Critical speech interrupts everything, a higher class preempts pending and current speech of a lower class,
+// low and progress speech is dropped while something else is speaking, and a newer progress message replaces an older one.
+// Dropping needs to know whether speech is going on: screen readers without SC_HAS_SPEECH_STATE speak low and progress
+// speech like normal speech, and preempt based on the class of the request they spoke last.
+#define SC_PRIORITY_CRITICAL 1
+#define SC_PRIORITY_HIGH 2
+#define SC_PRIORITY_NORMAL 3
+#define SC_PRIORITY_LOW 4
+#define SC_PRIORITY_PROGRESS 5
+
+// Flags for Speech_Output_Batch, Speech_Output_Ex and Speech_Stream_Open.
+#define SC_OUTPUT_INTERRUPT (1<<0)
+#define SC_OUTPUT_PRIORITY(priority) ((priority) << 8) // Priority class of the batch, SC_PRIORITY_NORMAL if not given.
+
+// Length for the _N and _Utf8 functions: the text ends at its terminator.
+#define SC_TEXT_TERMINATED ((size_t)-1)
+
+// Utterance states, see Speech_Output_Ex.
+#define SC_UTTERANCE_UNKNOWN 0 // Not an utterance id, or finished too long ago to be remembered.
+#define SC_UTTERANCE_QUEUED 1 // Waiting to be handed to the driver.
+#define SC_UTTERANCE_SPEAKING 2 // Handed to a driver that reports the end of speech, and not finished yet.
+#define SC_UTTERANCE_DONE 3 // Finished speaking, or accepted by a driver that can not report the end of speech.
+#define SC_UTTERANCE_CANCELLED 4 // Cancelled, stopped, interrupted, or dropped by the scheduler or coalescer.
+#define SC_UTTERANCE_FAILED 5 // No driver was available or the driver rejected it.
+
+// Driver calls recorded and delayed by the loopback driver.
+#define SC_LOOPBACK_SPEAK 0
+#define SC_LOOPBACK_STOP 1
+#define SC_LOOPBACK_IS_RUNNING 2
+#define SC_LOOPBACK_CALLS 3
+
+// Driver calls measured by Speech_Get_Stats.
+#define SC_STAT_SPEAK 0
+#define SC_STAT_STOP 1
+#define SC_STAT_BRAILLE 2
+#define SC_STAT_IS_SPEAKING 3
+#define SC_STAT_IS_RUNNING 4
+#define SC_STAT_OUTPUT_FILE 5
+#define SC_STAT_PAUSE_RESUME 6
+#define SC_STAT_PARAMETERS 7 // Volume, rate and voice getters and setters.
+#define SC_STAT_CALLS 8
+
+// Trace events, see Speech_Set_Trace_Callback.
+#define SC_TRACE_OUTPUT 0 // A Speech_Output call entered the library.
+#define SC_TRACE_QUEUED 1 // The utterance was queued for asynchronous output.
+#define SC_TRACE_DISPATCH_BEGIN 2 // The utterance is being handed to the driver.
+#define SC_TRACE_DISPATCH_END 3 // The driver call returned.
+#define SC_TRACE_SPEECH_START 4 // The driver reported that speech started.
+#define SC_TRACE_SPEECH_END 5 // The driver reported that speech finished.
+#define SC_TRACE_INTERRUPT 6 // The utterance interrupts the current speech.
+#define SC_TRACE_STOP 7 // Speech_Stop was called.
+#define SC_TRACE_DETECT 8 // Speech_Detect_Driver was called, driver is the resulting driver.
+
+// Driver initialization states, see Speech_Get_Init_Info.
+#define SC_INIT_PENDING 0 // Still initializing, within its deadline.
+#define SC_INIT_READY 1 // Initialized before its deadline.
+#define SC_INIT_TIMED_OUT 2 // Still initializing past its deadline. The driver is added once its initialization returns.
+#define SC_INIT_LATE 3 // Initialized after its deadline and added to the drivers then.
+
+// Latency models of the loopback driver, see Loopback_Set_Latency.
+#define SC_LATENCY_NONE 0
+#define SC_LATENCY_FIXED 1 // Always a microseconds.
+#define SC_LATENCY_UNIFORM 2 // Uniformly distributed between a and b microseconds.
+#define SC_LATENCY_EXPONENTIAL 3 // a microseconds plus an exponentially distributed delay with a mean of b microseconds.
+
 #ifdef __cplusplus
 #include <cstdint>
 #endif // __cplusplus
@@ -58,9 +124,33 @@ extern "C" {
 
 	/**
 	 * @brief Initializes the SpeechCore library. Must be called before using other functions.
+	 *
+	 * Every driver is initialized on its own thread. The call returns as soon as a running screen reader is ready,
+	 * or once every driver finished or passed its deadline (see Speech_Set_Init_Timeout).
+	 * Drivers that are still initializing then are added to the driver list when they finish.
 	 */
 	SPEECH_C_API void Speech_Init();
 
+	/**
+	 * @brief Called once Speech_Init_Async finished, on a SpeechCore thread.
+	 * @param driver The name of the selected driver, or NULL if none is available.
+	 * @param userdata The pointer passed to Speech_Init_Async.
+	 */
+	typedef void (*sc_init_callback)(const wchar_t* driver, void* userdata);
+
+	/**
+	 * @brief Initializes the SpeechCore library without blocking the caller.
+	 *
+	 * Drivers are initialized in the background, as in Speech_Init. Speech_Output, Speech_Output_Priority and
+	 * Speech_Output_Batch can be used right away: the speech is held in a bounded buffer and spoken once a driver is ready.
+	 * When the buffer is full the oldest speech is dropped, and an interrupting call drops everything held before it.
+	 * Speech_Is_Loaded returns true once initialization finished, right before the callback runs.
+	 * Does nothing when called again before Speech_Free. The callback may call Speech_Free.
+	 * @param callback Called when initialization finished, can be NULL.
+	 * @param userdata Passed to the callback.
+	 */
+	SPEECH_C_API void Speech_Init_Async(sc_init_callback callback, void* userdata);
+
 	/**
 	 * @brief Finalizes SpeechCore and frees up resources.
 	 */
@@ -75,6 +165,84 @@ extern "C" {
 	 */
 	SPEECH_C_API void Speech_Detect_Driver();
 
+	/**
+	 * @brief Probes every driver immediately and re-runs driver detection.
+	 *
+	 * Driver liveness is normally refreshed by a background monitor (see Speech_Set_Probe_Interval).
+	 * Call this after a screen reader was started or closed to pick up the change without waiting for the next probe.
+	 */
+	SPEECH_C_API void Speech_Refresh_Drivers();
+
+	/**
+	 * @brief Sets how often the background monitor checks whether each screen reader is running.
+	 *
+	 * Speech_Output and Speech_Braille read the cached result instead of querying the screen reader on every call.
+	 * A value of 0 disables the monitor, and the screen reader is queried on every call instead. Default is 1000.
+	 * @param interval_ms The probe interval in milliseconds.
+	 */
+	SPEECH_C_API void Speech_Set_Probe_Interval(uint32_t interval_ms);
+
+	/**
+	 * @brief Retrieves the interval used by the background driver monitor.
+	 * @return An uint32_t representing the probe interval in milliseconds, 0 if the monitor is disabled.
+	 */
+	SPEECH_C_API uint32_t Speech_Get_Probe_Interval();
+
+	/**
+	 * @brief Sets how long Speech_Init waits for each driver to initialize. Default is 3000.
+	 *
+	 * Must be called before Speech_Init. A driver that takes longer does not delay Speech_Init further,
+	 * it is added to the driver list once its initialization returns.
+	 * @param timeout_ms The deadline of every driver in milliseconds.
+	 */
+	SPEECH_C_API void Speech_Set_Init_Timeout(uint32_t timeout_ms);
+
+	/**
+	 * @brief Retrieves the deadline used for driver initialization.
+	 * @return An uint32_t representing the deadline in milliseconds.
+	 */
+	SPEECH_C_API uint32_t Speech_Get_Init_Timeout();
+
+	/**
+	 * @brief Enables or disables lazy driver loading. Disabled by default.
+	 *
+	 * Must be called before Speech_Init. When enabled, Speech_Init registers every screen reader without loading its
+	 * library. A driver is loaded when detection first checks it or when it is selected with Speech_Set_Driver,
+	 * and stays loaded until Speech_Free. Detection checks the preferred drivers first, so once a running screen reader
+	 * is found the less preferred ones are never loaded. Lazily loaded drivers are not listed by Speech_Get_Init_Info.
+	 * @param lazy Whether drivers should be loaded on first use.
+	 */
+	SPEECH_C_API void Speech_Set_Lazy_Loading(bool lazy);
+
+	/**
+	 * @brief Checks if lazy driver loading is enabled.
+	 * @return A bool indicating if drivers are loaded on first use.
+	 */
+	SPEECH_C_API bool Speech_Get_Lazy_Loading();
+
+	/**
+	 * @brief Initialization state and timing of a driver.
+	 */
+	typedef struct sc_driver_init {
+		const wchar_t* name;
+		uint32_t state; // One of the SC_INIT_* values.
+		uint64_t init_ns; // How long the driver initialization took, 0 while it is still running.
+	} sc_driver_init;
+
+	/**
+	 * @brief Retrieves the number of drivers started by Speech_Init, including the ones still initializing.
+	 * @return An int representing the number of drivers.
+	 */
+	SPEECH_C_API int Speech_Get_Init_Drivers();
+
+	/**
+	 * @brief Retrieves the initialization state and timing of a driver.
+	 * @param index The index of the driver in the order Speech_Init started them. Not the index used by Speech_Get_Driver.
+	 * @param init Receives the state and timing.
+	 * @return A bool indicating if the driver exists.
+	 */
+	SPEECH_C_API bool Speech_Get_Init_Info(int index, sc_driver_init* init);
+
 	/**
 	 * @brief Retrieves the name of the currently detected/used screen reader.
 	 * @return A const wchar_t string representing the current driver name.
@@ -83,6 +251,10 @@ extern "C" {
 
 	/**
 	 * @brief Retrieves the name of a screen reader driver by index.
+	 *
+	 * The list is kept in preference order. A driver that finishes initializing after Speech_Init returned joins it
+	 * at its place in that order, so the indices of the drivers after it shift by one. Until Speech_Get_Init_Info
+	 * reports every driver finished, look drivers up by name right before passing an index to Speech_Set_Driver.
 	 * @param index The index of the driver to retrieve.
 	 * @return A const wchar_t string representing the driver name.
 	 */
@@ -120,6 +292,17 @@ extern "C" {
 	 */
 	SPEECH_C_API bool Speech_Is_Speaking();
 
+	/**
+	 * @brief Blocks until the current screen reader finished speaking.
+	 *
+	 * Waits on speech events where the screen reader reports them (speech-dispatcher), otherwise polls Speech_Is_Speaking.
+	 * Returns true right away for screen readers without SC_HAS_SPEECH_STATE.
+	 * Speech still queued by asynchronous output is not waited for, see Speech_Wait for that.
+	 * @param timeout_ms How long to wait at most, in milliseconds.
+	 * @return A bool indicating if speech finished before the timeout.
+	 */
+	SPEECH_C_API bool Speech_Wait_Until_Done(uint32_t timeout_ms);
+
 	/**
 	 * @brief Outputs a given string to be spoken by the currently used/detected screen reader.
 	 * @param text A const wchar_t string representing the text to be spoken.
@@ -128,6 +311,392 @@ extern "C" {
 	 */
 	SPEECH_C_API bool Speech_Output(const wchar_t* text, bool _interrupt = false);
 
+	/**
+	 * @brief Outputs a given string with a priority class.
+	 * Speech_Output with _interrupt set is equivalent to SC_PRIORITY_CRITICAL, without it to SC_PRIORITY_NORMAL.
+	 * Speech Dispatcher handles the classes natively, other screen readers get them emulated on top of interrupt.
+	 * Low and progress speech is only dropped while speaking by drivers reporting SC_HAS_SPEECH_STATE.
+	 * @param text A const wchar_t string representing the text to be spoken.
+	 * @param priority One of the SC_PRIORITY_* values.
+	 * @return A bool indicating if the operation was successful.
+	 */
+	SPEECH_C_API bool Speech_Output_Priority(const wchar_t* text, uint32_t priority);
+
+	/**
+	 * @brief Outputs a string of a known length, like Speech_Output.
+	 * @param text A const wchar_t string representing the text to be spoken. It does not need a terminator.
+	 * @param length The number of wchar_t in text, or SC_TEXT_TERMINATED if it is terminated.
+	 * @param _interrupt Whether to interrupt the current speech segment. Default is false.
+	 * @return A bool indicating if the operation was successful.
+	 */
+	SPEECH_C_API bool Speech_Output_N(const wchar_t* text, size_t length, bool _interrupt = false);
+
+	/**
+	 * @brief Outputs a UTF-8 string, like Speech_Output.
+	 * Speech Dispatcher takes UTF-8 as is, other screen readers get it converted once, with malformed bytes
+	 * replaced by U+FFFD. This saves the round trip through wchar_t for callers that already hold UTF-8.
+	 * @param text A const char string representing the UTF-8 text to be spoken. It does not need a terminator.
+	 * @param length The number of bytes in text, or SC_TEXT_TERMINATED if it is terminated.
+	 * @param _interrupt Whether to interrupt the current speech segment. Default is false.
+	 * @return A bool indicating if the operation was successful.
+	 */
+	SPEECH_C_API bool Speech_Output_Utf8(const char* text, size_t length, bool _interrupt = false);
+
+	/**
+	 * @brief Outputs a UTF-16 string, like Speech_Output. For Java, .NET and other callers holding UTF-16 on every platform.
+	 * On Windows it is taken as is, elsewhere it is converted once to UTF-8, with unpaired surrogates replaced by U+FFFD.
+	 * @param text A const char16_t string representing the UTF-16 text to be spoken. It does not need a terminator.
+	 * @param length The number of char16_t in text, or SC_TEXT_TERMINATED if it is terminated.
+	 * @param _interrupt Whether to interrupt the current speech segment. Default is false.
+	 * @return A bool indicating if the operation was successful.
+	 */
+	SPEECH_C_API bool Speech_Output_Utf16(const char16_t* text, size_t length, bool _interrupt = false);
+
+	/**
+	 * @brief Enables or disables asynchronous output.
+	 *
+	 * When enabled, Speech_Output copies the text into a lock-free queue and returns immediately.
+	 * A single background thread hands queued messages to the current screen reader in order.
+	 * Disabling delivers any queued messages before the background thread exits.
+	 * @param async_output Whether Speech_Output should return without waiting for the screen reader.
+	 */
+	SPEECH_C_API void Speech_Set_Async(bool async_output);
+
+	/**
+	 * @brief Outputs several strings in one call, in order.
+	 * The detected screen reader is looked up once for the whole batch. With asynchronous output enabled
+	 * the batch is queued as a single unit, so output from other threads can not land in the middle of it.
+	 * @param texts An array of const wchar_t strings. NULL entries are skipped.
+	 * @param count The number of entries in texts.
+	 * @param flags SC_OUTPUT_INTERRUPT interrupts current speech before the first string, the rest are queued after it.
+	 * SC_OUTPUT_PRIORITY(priority) sets the priority class of the strings.
+	 * @return A bool indicating if every string was handed to the screen reader (or queued), false if the batch was empty.
+	 */
+	SPEECH_C_API bool Speech_Output_Batch(const wchar_t** texts, size_t count, uint32_t flags);
+
+	/**
+	 * @brief Outputs text like Speech_Output_Priority and returns a handle to follow or cancel that utterance.
+	 *
+	 * The end of speech is reported by NVDA. With other screen readers an utterance is done once the screen reader
+	 * accepted it. The last 4096 finished utterances are remembered.
+	 * @param text A const wchar_t string containing the text to output.
+	 * @param flags SC_OUTPUT_INTERRUPT interrupts current speech, SC_OUTPUT_PRIORITY(priority) sets the priority class.
+	 * @return An uint64_t utterance id, 0 if the text or flags are invalid.
+	 */
+	SPEECH_C_API uint64_t Speech_Output_Ex(const wchar_t* text, uint32_t flags);
+
+	/**
+	 * @brief Speech_Output_Ex for UTF-16 text, converted like Speech_Output_Utf16.
+	 * @param text A const char16_t string containing the text to output. It does not need a terminator.
+	 * @param length The number of char16_t in text, or SC_TEXT_TERMINATED if it is terminated.
+	 * @param flags SC_OUTPUT_INTERRUPT interrupts current speech, SC_OUTPUT_PRIORITY(priority) sets the priority class.
+	 * @return An uint64_t utterance id, 0 if the text or flags are invalid.
+	 */
+	SPEECH_C_API uint64_t Speech_Output_Ex_Utf16(const char16_t* text, size_t length, uint32_t flags);
+
+	/**
+	 * @brief Speech_Output_Ex for UTF-8 text, taken like Speech_Output_Utf8.
+	 * @param text A const char string containing the UTF-8 text to output. It does not need a terminator.
+	 * @param length The number of bytes in text, or SC_TEXT_TERMINATED if it is terminated.
+	 * @param flags SC_OUTPUT_INTERRUPT interrupts current speech, SC_OUTPUT_PRIORITY(priority) sets the priority class.
+	 * @return An uint64_t utterance id, 0 if the text or flags are invalid.
+	 */
+	SPEECH_C_API uint64_t Speech_Output_Ex_Utf8(const char* text, size_t length, uint32_t flags);
+
+	/**
+	 * @brief Retrieves the state of an utterance.
+	 * @param id An utterance id returned by Speech_Output_Ex.
+	 * @return One of the SC_UTTERANCE_* values.
+	 */
+	SPEECH_C_API uint32_t Speech_Get_Utterance_State(uint64_t id);
+
+	/**
+	 * @brief Waits until an utterance finished.
+	 * @param id An utterance id returned by Speech_Output_Ex.
+	 * @param timeout_ms How long to wait at most, in milliseconds.
+	 * @return The state of the utterance: SC_UTTERANCE_QUEUED or SC_UTTERANCE_SPEAKING if the wait timed out.
+	 */
+	SPEECH_C_API uint32_t Speech_Wait(uint64_t id, uint32_t timeout_ms);
+
+	/**
+	 * @brief Cancels an utterance.
+	 *
+	 * A queued utterance is removed without affecting other speech. An utterance being spoken is stopped,
+	 * which also stops whatever the screen reader queued with it.
+	 * @param id An utterance id returned by Speech_Output_Ex.
+	 * @return A bool indicating if the utterance was cancelled, false if it already finished or is unknown.
+	 */
+	SPEECH_C_API bool Speech_Cancel(uint64_t id);
+
+	/**
+	 * @brief Called when an utterance returned by Speech_Output_Ex finished, on the thread that finished it.
+	 * @param id The utterance id.
+	 * @param state SC_UTTERANCE_DONE, SC_UTTERANCE_CANCELLED or SC_UTTERANCE_FAILED.
+	 * @param userdata The pointer passed to Speech_Set_Utterance_Callback.
+	 */
+	typedef void (*sc_utterance_callback)(uint64_t id, uint32_t state, void* userdata);
+
+	/**
+	 * @brief Sets the callback called when an utterance finished. The callback must not call Speech_Set_Utterance_Callback.
+	 * @param callback The callback, NULL to remove it.
+	 * @param userdata Passed to the callback.
+	 */
+	SPEECH_C_API void Speech_Set_Utterance_Callback(sc_utterance_callback callback, void* userdata);
+
+	/**
+	 * @brief Opens a stream for text that arrives a few characters at a time, like the output of a language model.
+	 *
+	 * Appended text is held until a sentence is complete, or a clause once enough text built up, and then output
+	 * like Speech_Output_Utf8. What is left is output once nothing was appended for the idle timeout, see Speech_Set_Stream_Idle_Timeout.
+	 * Speech_Stop drops the text streams hold, the streams stay open.
+	 * @param flags SC_OUTPUT_INTERRUPT interrupts current speech, SC_OUTPUT_PRIORITY(priority) sets the priority class.
+	 * Both only apply to the first piece of text, the rest is queued after it as normal speech.
+	 * @return An uint64_t stream id, 0 if the flags are invalid.
+	 */
+	SPEECH_C_API uint64_t Speech_Stream_Open(uint32_t flags);
+
+	/**
+	 * @brief Appends text to a stream.
+	 * @param stream A stream id returned by Speech_Stream_Open.
+	 * @param text A const wchar_t string containing the text to append.
+	 * @return A bool indicating if the stream is open.
+	 */
+	SPEECH_C_API bool Speech_Stream_Append(uint64_t stream, const wchar_t* text);
+
+	/**
+	 * @brief Appends UTF-8 text to a stream. A character may be split across calls, it is output once it is complete.
+	 * @param stream A stream id returned by Speech_Stream_Open.
+	 * @param text A const char string containing the UTF-8 text to append. It does not need a terminator.
+	 * @param length The number of bytes in text, or SC_TEXT_TERMINATED if it is terminated.
+	 * @return A bool indicating if the stream is open.
+	 */
+	SPEECH_C_API bool Speech_Stream_Append_Utf8(uint64_t stream, const char* text, size_t length);
+
+	/**
+	 * @brief Outputs everything a stream holds right away.
+	 * @param stream A stream id returned by Speech_Stream_Open.
+	 * @return A bool indicating if the stream is open.
+	 */
+	SPEECH_C_API bool Speech_Stream_Flush(uint64_t stream);
+
+	/**
+	 * @brief Outputs everything a stream holds and closes it.
+	 * @param stream A stream id returned by Speech_Stream_Open.
+	 * @return A bool indicating if the stream was open.
+	 */
+	SPEECH_C_API bool Speech_Stream_Close(uint64_t stream);
+
+	/**
+	 * @brief Sets how long a stream waits for more text before it outputs an unfinished sentence.
+	 * @param timeout_ms The timeout in milliseconds, 0 waits for a boundary, Speech_Stream_Flush or Speech_Stream_Close. The default is 300.
+	 */
+	SPEECH_C_API void Speech_Set_Stream_Idle_Timeout(uint32_t timeout_ms);
+
+	/**
+	 * @brief Gets the stream idle timeout.
+	 * @return A uint32_t with the timeout in milliseconds, 0 if streams only output at boundaries.
+	 */
+	SPEECH_C_API uint32_t Speech_Get_Stream_Idle_Timeout();
+
+	/**
+	 * @brief Checks if asynchronous output is enabled.
+	 * @return A bool indicating if Speech_Output is queued to a background thread.
+	 */
+	SPEECH_C_API bool Speech_Is_Async();
+
+	/**
+	 * @brief Sets the coalescing window used by asynchronous output.
+	 * Messages queued within the window are combined before reaching the screen reader: an interrupting message drops
+	 * whatever is still held, whatever its class, other messages are appended to a held message of the same class.
+	 * Held speech is delivered once the window, counted from its first message, has elapsed.
+	 * An utterance appended to a held message finishes along with it, when that message is handed to the driver.
+	 * Only applies while asynchronous output is enabled.
+	 * @param window_ms The window in milliseconds, 0 (the default) disables coalescing.
+	 */
+	SPEECH_C_API void Speech_Set_Coalesce_Window(uint32_t window_ms);
+
+	/**
+	 * @brief Gets the coalescing window.
+	 * @return A uint32_t with the window in milliseconds, 0 if coalescing is disabled.
+	 */
+	SPEECH_C_API uint32_t Speech_Get_Coalesce_Window();
+
+	/**
+	 * @brief Gets the coalescing counters.
+	 * @param dropped Receives the number of messages superseded by an interrupting message. May be NULL.
+	 * @param merged Receives the number of messages appended to a held message. May be NULL.
+	 */
+	SPEECH_C_API void Speech_Get_Coalesce_Stats(uint64_t* dropped, uint64_t* merged);
+
+	/**
+	 * @brief Resets the coalescing counters to zero.
+	 */
+	SPEECH_C_API void Speech_Reset_Coalesce_Stats();
+
+	/**
+	 * @brief Sets the window of the deduplication stage, which suppresses an utterance that exactly repeats one spoken within the window.
+	 * Repeats are matched on the text, the driver, the priority class and the speech parameters; changing the volume, rate or voice
+	 * ends every window, and so do switching drivers and Speech_Free. Interrupting and SC_PRIORITY_CRITICAL utterances are never suppressed.
+	 * A suppressed utterance interrupts nothing and counts as SC_UTTERANCE_CANCELLED. Only utterances the driver accepted count as spoken,
+	 * and Speech_Stop, Speech_Cancel of a speaking utterance and interrupting utterances forget everything spoken so far, so a repeat of
+	 * speech that was cut off is heard again.
+	 * @param window_ms The window in milliseconds, counted from the last time the text was spoken. 0 (the default) disables deduplication.
+	 */
+	SPEECH_C_API void Speech_Set_Dedup_Window(uint32_t window_ms);
+
+	/**
+	 * @brief Gets the deduplication window.
+	 * @return A uint32_t with the window in milliseconds, 0 if deduplication is disabled.
+	 */
+	SPEECH_C_API uint32_t Speech_Get_Dedup_Window();
+
+	/**
+	 * @brief Sets how many recently spoken utterances the deduplication stage remembers. The one spoken longest ago is forgotten first.
+	 * @param entries The number of utterances, 64 by default.
+	 */
+	SPEECH_C_API void Speech_Set_Dedup_Capacity(uint32_t entries);
+
+	/**
+	 * @brief Gets the deduplication counters.
+	 * @param hits Receives the number of utterances suppressed as repeats. May be NULL.
+	 * @param misses Receives the number of utterances checked and spoken. May be NULL.
+	 */
+	SPEECH_C_API void Speech_Get_Dedup_Stats(uint64_t* hits, uint64_t* misses);
+
+	/**
+	 * @brief Resets the deduplication counters to zero.
+	 */
+	SPEECH_C_API void Speech_Reset_Dedup_Stats();
+
+	/**
+	 * @brief Sets the longest text handed to an engine that synthesizes a whole request before playing any of it, like SAPI.
+	 * Longer text goes in segments cut at sentence ends, or failing that at clause marks, whitespace or grapheme boundaries,
+	 * so speech starts once the first segment is synthesized. Segments after the first never interrupt, and the ones not handed
+	 * to the engine yet are dropped by interrupting output, Speech_Stop and Speech_Cancel. Screen readers are never segmented.
+	 * @param units The limit in code units of the text as passed, bytes for the UTF-8 functions. 0 disables segmentation, the default is 400.
+	 */
+	SPEECH_C_API void Speech_Set_Segment_Limit(uint32_t units);
+
+	/**
+	 * @brief Gets the segment limit.
+	 * @return A uint32_t with the limit in code units, 0 if segmentation is disabled.
+	 */
+	SPEECH_C_API uint32_t Speech_Get_Segment_Limit();
+
+	/**
+	 * @brief Gets the segmentation counters.
+	 * @param segmented Receives the number of requests split into segments. May be NULL.
+	 * @param segments Receives the number of segments handed to engines. May be NULL.
+	 * @param interrupted Receives the number of segmented requests whose remaining segments were dropped. May be NULL.
+	 */
+	SPEECH_C_API void Speech_Get_Segment_Stats(uint64_t* segmented, uint64_t* segments, uint64_t* interrupted);
+
+	/**
+	 * @brief Resets the segmentation counters to zero.
+	 */
+	SPEECH_C_API void Speech_Reset_Segment_Stats();
+
+	/**
+	 * @brief Gets the scheduling counters of a priority class.
+	 * Latency is measured from queueing a message to handing it to the screen reader, so it only covers asynchronous output.
+	 * @param priority One of the SC_PRIORITY_* values.
+	 * @param delivered Receives the number of messages handed to the screen reader. May be NULL.
+	 * @param preempted Receives the number of pending messages dropped in favor of a higher class. May be NULL.
+	 * @param mean_latency_us Receives the mean queueing latency in microseconds. May be NULL.
+	 * @param max_latency_us Receives the highest queueing latency in microseconds. May be NULL.
+	 * @return A bool indicating if priority is a valid class.
+	 */
+	SPEECH_C_API bool Speech_Get_Priority_Stats(uint32_t priority, uint64_t* delivered, uint64_t* preempted, uint64_t* mean_latency_us, uint64_t* max_latency_us);
+
+	/**
+	 * @brief Resets the scheduling counters of every priority class to zero.
+	 */
+	SPEECH_C_API void Speech_Reset_Priority_Stats();
+
+	/**
+	 * @brief Timing of one kind of driver call, see Speech_Get_Stats.
+	 * Percentiles are accurate to within about 6%.
+	 */
+	typedef struct sc_call_stats {
+		uint64_t calls;
+		uint64_t failures; // Calls that returned false. Only counted for SC_STAT_SPEAK, SC_STAT_STOP and SC_STAT_BRAILLE.
+		uint64_t total_ns;
+		uint64_t max_ns;
+		uint64_t p50_ns;
+		uint64_t p90_ns;
+		uint64_t p99_ns;
+		uint64_t p999_ns;
+	} sc_call_stats;
+
+	/**
+	 * @brief Snapshot of the call statistics of a driver.
+	 */
+	typedef struct sc_driver_stats {
+		const wchar_t* name;
+		sc_call_stats calls[SC_STAT_CALLS]; // Indexed by the SC_STAT_* values.
+	} sc_driver_stats;
+
+	/**
+	 * @brief Enables or disables timing of driver calls. Disabled by default.
+	 * @param enable Whether every call SpeechCore makes into a driver should be timed and counted.
+	 */
+	SPEECH_C_API void Speech_Enable_Stats(bool enable);
+
+	/**
+	 * @brief Checks if timing of driver calls is enabled.
+	 * @return A bool indicating if statistics are being collected.
+	 */
+	SPEECH_C_API bool Speech_Stats_Enabled();
+
+	/**
+	 * @brief Gets a snapshot of the call statistics of a driver.
+	 * @param index The index of the driver as used by Speech_Get_Driver, or -1 for the current driver.
+	 * @param stats Receives the snapshot.
+	 * @return A bool indicating if the driver exists.
+	 */
+	SPEECH_C_API bool Speech_Get_Stats(int index, sc_driver_stats* stats);
+
+	/**
+	 * @brief Resets the call statistics of every driver to zero.
+	 */
+	SPEECH_C_API void Speech_Reset_Stats();
+
+	/**
+	 * @brief A trace event, see Speech_Set_Trace_Callback.
+	 */
+	typedef struct sc_trace_event {
+		uint32_t type; // One of the SC_TRACE_* values.
+		uint32_t thread; // Small number identifying the emitting thread.
+		uint64_t timestamp_ns; // Monotonic clock timestamp.
+		uint64_t utterance; // Id shared by every event of one utterance, 0 for events not tied to one.
+		const wchar_t* driver; // Name of the driver involved, or NULL.
+	} sc_trace_event;
+
+	typedef void (*sc_trace_callback)(const sc_trace_event* event, void* userdata);
+
+	/**
+	 * @brief Sets a callback receiving every trace event.
+	 * The callback runs on the thread emitting the event and must return quickly.
+	 * It must not change the trace settings itself.
+	 * @param callback The callback, or NULL to remove it.
+	 * @param userdata Passed back to the callback.
+	 */
+	SPEECH_C_API void Speech_Set_Trace_Callback(sc_trace_callback callback, void* userdata);
+
+	/**
+	 * @brief Keeps the most recent trace events in memory so they can be written with Speech_Write_Trace.
+	 * Setting a buffer discards any events recorded so far.
+	 * @param capacity The number of events to keep, 0 removes the buffer.
+	 */
+	SPEECH_C_API void Speech_Set_Trace_Buffer(size_t capacity);
+
+	/**
+	 * @brief Writes the buffered trace events to a file in Chrome trace (JSON) format, viewable in chrome://tracing or Perfetto.
+	 * @param filePath A const char* representing the name of the file.
+	 * @return A bool indicating if a trace buffer is set and the file was written.
+	 */
+	SPEECH_C_API bool Speech_Write_Trace(const char* filePath);
+
 	/**
 	 * @brief Outputs a given string to the braille display if supported.
 	 * @param text A const wchar_t string representing the text to be displayed in braille.
@@ -135,6 +704,30 @@ extern "C" {
 	 */
 	SPEECH_C_API bool Speech_Braille(const wchar_t* text);
 
+	/**
+	 * @brief Outputs a string of a known length to the braille display if supported.
+	 * @param text A const wchar_t string representing the text to be displayed in braille. It does not need a terminator.
+	 * @param length The number of wchar_t in text, or SC_TEXT_TERMINATED if it is terminated.
+	 * @return A bool indicating if the operation was successful.
+	 */
+	SPEECH_C_API bool Speech_Braille_N(const wchar_t* text, size_t length);
+
+	/**
+	 * @brief Outputs a UTF-8 string to the braille display if supported.
+	 * @param text A const char string representing the UTF-8 text to be displayed in braille. It does not need a terminator.
+	 * @param length The number of bytes in text, or SC_TEXT_TERMINATED if it is terminated.
+	 * @return A bool indicating if the operation was successful.
+	 */
+	SPEECH_C_API bool Speech_Braille_Utf8(const char* text, size_t length);
+
+	/**
+	 * @brief Outputs a UTF-16 string to the braille display if supported.
+	 * @param text A const char16_t string representing the UTF-16 text to be displayed in braille. It does not need a terminator.
+	 * @param length The number of char16_t in text, or SC_TEXT_TERMINATED if it is terminated.
+	 * @return A bool indicating if the operation was successful.
+	 */
+	SPEECH_C_API bool Speech_Braille_Utf16(const char16_t* text, size_t length);
+
 	/**
 	 * @brief Stops speaking if the screen reader is currently speaking.
 	 * @return A bool indicating if the operation was successful.
@@ -207,6 +800,76 @@ extern "C" {
 	 */
 	SPEECH_C_API void Speech_Pause();
 
+	/**
+	 * @brief A driver call recorded by the loopback driver.
+	 * Liveness probes made by the background health monitor are neither recorded nor counted.
+	 */
+	typedef struct sc_loopback_record {
+		uint32_t call; // One of the SC_LOOPBACK_* values.
+		bool interrupt; // Whether a speak call interrupted the current speech.
+		uint64_t start_ns; // Monotonic clock timestamp when the call was made.
+		uint64_t end_ns; // Monotonic clock timestamp when the call returned.
+		const wchar_t* text; // The spoken text, empty for other calls. Valid until Loopback_Reset or Speech_Free.
+	} sc_loopback_record;
+
+	/**
+	 * @brief Sets the latency the loopback driver simulates for a call.
+	 * The loopback driver is only registered by builds with SPEECHCORE_LOOPBACK, the CMake option of that name or
+	 * loopback=yes with SCons, which the benchmarks turn on. It is registered last and never detected, select it with
+	 * Speech_Set_Driver. The loopback functions do nothing until Speech_Init has been called, or in other builds.
+	 * @param call One of the SC_LOOPBACK_* values.
+	 * @param model One of the SC_LATENCY_* values.
+	 * @param a_us The first model parameter in microseconds.
+	 * @param b_us The second model parameter in microseconds.
+	 * @return A bool indicating if call and model are valid.
+	 */
+	SPEECH_C_API bool Loopback_Set_Latency(uint32_t call, uint32_t model, uint32_t a_us, uint32_t b_us);
+
+	/**
+	 * @brief Seeds the random generator behind the latency models, making runs reproducible.
+	 * @param seed The seed.
+	 */
+	SPEECH_C_API void Loopback_Set_Seed(uint64_t seed);
+
+	/**
+	 * @brief Sets how long the loopback driver pretends to be speaking, which is what Speech_Is_Speaking reports.
+	 * @param us_per_char Simulated speaking time per character in microseconds. 0 (the default) never speaks.
+	 */
+	SPEECH_C_API void Loopback_Set_Speech_Rate(uint32_t us_per_char);
+
+	/**
+	 * @brief Sets how long a speak call to the loopback driver blocks per character, like an engine that synthesizes
+	 * the whole text before playing it. While set, long text reaches the loopback driver in segments, see Speech_Set_Segment_Limit.
+	 * @param us_per_char Simulated synthesis time per character in microseconds. 0 (the default) synthesizes nothing.
+	 */
+	SPEECH_C_API void Loopback_Set_Synthesis_Rate(uint32_t us_per_char);
+
+	/**
+	 * @brief Gets how many times a call reached the loopback driver since the last reset.
+	 * @param call One of the SC_LOOPBACK_* values.
+	 * @return A uint64_t with the number of calls.
+	 */
+	SPEECH_C_API uint64_t Loopback_Get_Calls(uint32_t call);
+
+	/**
+	 * @brief Gets the number of recorded calls. Only the first 65536 calls after a reset are recorded.
+	 * @return A size_t with the number of records.
+	 */
+	SPEECH_C_API size_t Loopback_Get_Records();
+
+	/**
+	 * @brief Gets a recorded call, in the order calls returned.
+	 * @param index The index of the record.
+	 * @param record Receives the record.
+	 * @return A bool indicating if the record exists.
+	 */
+	SPEECH_C_API bool Loopback_Get_Record(size_t index, sc_loopback_record* record);
+
+	/**
+	 * @brief Clears the recorded calls, the call counters and the simulated speaking state.
+	 */
+	SPEECH_C_API void Loopback_Reset();
+
 #ifdef _WIN32
 	/**
 	 * @brief Sets the preference for using SAPI as the primary speech engine.
@@ -317,6 +980,25 @@ extern "C" {
 	SPEECH_C_API void Sapi_Stop();
 
 #endif // _WIN32
+#ifdef __linux__
+	/**
+	 * @brief Makes the Speech Dispatcher driver use the built in SSIP client instead of libspeechd. Disabled by default.
+	 *
+	 * Must be called before Speech_Init. The built in client talks to speech-dispatcher's Unix socket directly
+	 * (SPEECHD_ADDRESS when it names a unix_socket, otherwise the default socket), writes commands without waiting for
+	 * their replies and sends rate and volume changes together with the next message. When no speech-dispatcher is
+	 * listening there, the driver falls back to libspeechd, which can also start one.
+	 * @param native_ssip Whether to use the built in SSIP client.
+	 */
+	SPEECH_C_API void Speech_Set_Native_Ssip(bool native_ssip);
+
+	/**
+	 * @brief Checks if the built in SSIP client is enabled.
+	 * @return A bool indicating if the Speech Dispatcher driver prefers the built in SSIP client.
+	 */
+	SPEECH_C_API bool Speech_Get_Native_Ssip();
+
+#endif // __linux__
 
 
 #ifdef __cplusplus
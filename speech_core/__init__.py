@@ -6,16 +6,19 @@
 # All functions have bin converted to lower snake case and the Speech prefix have bin removed.
 
 import sys
+from typing import Optional
 
 from .__speech_common import *
 from .SpeechCore import (
     init, is_loaded, free, resume, pause, stop,
-    output, output_file, braille,
+    output, output_batch, output_file, braille,
     set_driver, get_driver, get_drivers, current_driver, detect_driver,
-    get_voice, get_voices, set_voice,
+    get_voice, get_current_voice, get_voices, set_voice,
     get_rate, set_rate, get_volume, set_volume,
-    get_flags
+    get_flags, is_speaking, wait_until_done, set_async, is_async
     )
+from . import __speech_async as speech_async
+from .__speech_async import output_async, wait_done
 
 if sys.platform == "win32":
     from .__speech_sapi import Sapi
@@ -32,6 +35,7 @@ class SpeechCore:
     @classmethod
     def free(cls):
         if cls.is_loaded():
+            speech_async.completions.uninstall()
             free()
 
     @classmethod
@@ -118,6 +122,10 @@ class SpeechCore:
     def output(self, text: str, interrupt: bool = False) -> bool:
         return output(text, interrupt)
 
+    @CheckInit
+    def output_batch(self, texts: list, interrupt: bool = False) -> bool:
+        return output_batch(texts, interrupt)
+
     @CheckInit
     def output_braille(self, text: str) ->bool :
         return braille(text)
@@ -138,13 +146,34 @@ class SpeechCore:
     def stop(self) ->None :
         stop()
 
+    @CheckInit
+    def wait_until_done(self, timeout_ms: int) ->bool :
+        return wait_until_done(timeout_ms)
+
+    @CheckInit
+    def set_async(self, async_output: bool) ->None :
+        set_async(async_output)
+
+    @CheckInit
+    def is_async(self) ->bool :
+        return is_async()
+
+    @CheckInit
+    async def output_async(self, text: str, interrupt: bool = False) -> int:
+        return await speech_async.output_async(text, interrupt)
+
+    @CheckInit
+    async def wait_done(self, timeout: Optional[float] = None) -> bool:
+        return await speech_async.wait_done(timeout)
+
 
 __all__ = [
         "init", "free", "resume", "pause", "stop",
-    "output", "output_file", "braille",
+    "output", "output_batch", "output_file", "braille",
     "set_driver", "get_driver", "get_drivers", "current_driver", "detect_driver",
-    "get_voice", "get_voices", "set_voice",
+    "get_voice", "get_current_voice", "get_voices", "set_voice",
     "get_rate", "set_rate", "get_volume", "set_volume",
-    "get_flags",
+    "get_flags", "is_speaking", "wait_until_done", "set_async", "is_async",
+    "output_async", "wait_done",
     "SpeechCore", "Sapi"
     ]
\ No newline at end of file
@@ -0,0 +1,128 @@
+# asyncio support for SpeechCore.
+# Utterances are queued with output_ex, and the library reports their end from its own threads.
+# The completion handler runs there with the GIL held, collects every finished utterance and
+# resolves the matching futures on the event loops that are waiting for them.
+
+import asyncio
+import threading
+from typing import Optional
+
+from .SpeechCore import (
+    output_ex, cancel, is_async, wait_until_done,
+    set_completion_handler, take_completions,
+    SC_OUTPUT_INTERRUPT, SC_UTTERANCE_CANCELLED, SC_UTTERANCE_FAILED
+    )
+
+# Completions that arrived before output_async registered their future. Utterances queued from
+# outside output_async also end up here and are never claimed, so only the newest are kept.
+_EARLY_LIMIT = 1024
+
+# Longest single wait in wait_done, so a cancelled wait_done frees its executor thread quickly.
+_WAIT_SLICE_MS = 100
+
+def _resolve(future, state):
+    if not future.done():
+        future.set_result(state)
+
+def _resolve_threadsafe(future, state):
+    try:
+        future.get_loop().call_soon_threadsafe(_resolve, future, state)
+    except RuntimeError:
+        # The loop was closed, nobody is waiting anymore.
+        pass
+
+class _Completions:
+    def __init__(self):
+        self._lock = threading.Lock()
+        self._futures = {}
+        self._early = {}
+        self._installed = False
+
+    def install(self):
+        with self._lock:
+            if self._installed:
+                return
+            self._installed = True
+        set_completion_handler(self._wake)
+
+    def uninstall(self):
+        with self._lock:
+            if not self._installed:
+                return
+            self._installed = False
+            futures = list(self._futures.values())
+            self._futures.clear()
+            self._early.clear()
+        set_completion_handler(None)
+        for future in futures:
+            _resolve_threadsafe(future, SC_UTTERANCE_CANCELLED)
+
+    def register(self, id: int, loop) -> asyncio.Future:
+        future = loop.create_future()
+        with self._lock:
+            state = self._early.pop(id, None)
+            if state is None:
+                self._futures[id] = future
+        if state is not None:
+            future.set_result(state)
+        return future
+
+    def forget(self, id: int):
+        with self._lock:
+            self._futures.pop(id, None)
+
+    def _wake(self):
+        resolved = []
+        with self._lock:
+            for id, state in take_completions():
+                future = self._futures.pop(id, None)
+                if future is not None:
+                    resolved.append((future, state))
+                    continue
+                self._early[id] = state
+                if len(self._early) > _EARLY_LIMIT:
+                    del self._early[next(iter(self._early))]
+        for future, state in resolved:
+            _resolve_threadsafe(future, state)
+
+completions = _Completions()
+
+async def output_async(text: str, interrupt: bool = False) -> int:
+    """Speaks text and returns once it finished, with its SC_UTTERANCE_* state.
+
+    With asynchronous output on (set_async) queueing never blocks and is done on the loop,
+    otherwise the driver call runs in the loop's default executor. Cancelling the task cancels the utterance.
+    """
+    completions.install()
+    loop = asyncio.get_running_loop()
+    flags = SC_OUTPUT_INTERRUPT if interrupt else 0
+    if is_async():
+        id = output_ex(text, flags)
+    else:
+        id = await loop.run_in_executor(None, output_ex, text, flags)
+    if id == 0:
+        return SC_UTTERANCE_FAILED
+    future = completions.register(id, loop)
+    try:
+        return await future
+    except asyncio.CancelledError:
+        completions.forget(id)
+        cancel(id)
+        raise
+
+async def wait_done(timeout: Optional[float] = None) -> bool:
+    """Waits until the screen reader finished speaking, see wait_until_done. timeout is in seconds, None waits forever.
+
+    Returns False if speech was still going on when the timeout expired.
+    """
+    loop = asyncio.get_running_loop()
+    deadline = None if timeout is None else loop.time() + timeout
+    while True:
+        slice_ms = _WAIT_SLICE_MS
+        if deadline is not None:
+            remaining = deadline - loop.time()
+            if remaining <= 0:
+                return False
+            slice_ms = max(1, min(_WAIT_SLICE_MS, int(remaining * 1000)))
+        if await loop.run_in_executor(None, wait_until_done, slice_ms):
+            return True
@@ -2,7 +2,8 @@ from functools import wraps
 
 from .SpeechCore import (
     SC_SPEECH_FLOW_CONTROL, SC_SPEECH_PARAMETER_CONTROL, SC_VOICE_CONFIG, SC_FILE_OUTPUT,
-    SC_HAS_SPEECH, SC_HAS_BRAILLE, SC_HAS_SPEECH_STATE
+    SC_HAS_SPEECH, SC_HAS_BRAILLE, SC_HAS_SPEECH_STATE,
+    SC_UTTERANCE_DONE, SC_UTTERANCE_CANCELLED, SC_UTTERANCE_FAILED
     )
 
 class InitializationError(Exception):
@@ -36,5 +37,6 @@ def CheckSapi(func):
 __all__ = [
     "SC_SPEECH_FLOW_CONTROL", "SC_SPEECH_PARAMETER_CONTROL", "SC_VOICE_CONFIG", "SC_FILE_OUTPUT",
     "SC_HAS_SPEECH", "SC_HAS_BRAILLE", "SC_HAS_SPEECH_STATE",
+    "SC_UTTERANCE_DONE", "SC_UTTERANCE_CANCELLED", "SC_UTTERANCE_FAILED",
     "InitializationError", "NotLoadedError", "CheckInit", "CheckSapi"
     ]
\ No newline at end of file
@@ -2,36 +2,60 @@
 #include <pybind11/stl.h>
 #include <pybind11/functional.h>
 
+#include <cstdint>
+#include <mutex>
 #include <string>
+#include <string_view>
+#include <utility>
 #include <vector>
 #include <cstring>
 
-#if defined(__linux__) || defined(__APPLE__) || defined(__DARWIN__) || defined(__MACH__)
-#include <locale>
-#include <codecvt>
-#endif
-
 #include "SpeechCore.h"
+#include "../src/SCCore/Transcode.h"
 
 namespace py = pybind11;
 
 std::string wchar_to_string(const wchar_t* wstr) {
     if (!wstr) return "";
-    
-#if defined(__linux__) || defined(__APPLE__) || defined(__DARWIN__) || defined(__MACH__)
-    return std::wstring_convert<std::codecvt_utf8<wchar_t>>().to_bytes(wstr);
-#else
-    std::wstring ws(wstr);
-    return std::string(ws.begin(), ws.end());
-#endif
+    return transcode::utf8_string(wstr);
 }
 
 std::wstring string_to_wstring(const std::string& str) {
-#if defined(__linux__) || defined(__APPLE__) || defined(__DARWIN__) || defined(__MACH__)
-    return std::wstring_convert<std::codecvt_utf8<wchar_t>>().from_bytes(str);
-#else
-    return std::wstring(str.begin(), str.end());
-#endif
+    return transcode::wide_string(str.data(), str.size());
+}
+
+// Every call that can reach a driver runs without the GIL, so a slow screen reader only blocks the calling thread.
+// The library also calls back into Python from its own threads (see on_utterance), which would deadlock against
+// a thread waiting inside the library with the GIL held.
+using release_gil = py::call_guard<py::gil_scoped_release>;
+
+// Utterances finished since Python last looked, for the asyncio API in __speech_async.py. The library reports them
+// on whatever thread finished them. Only the first one queued takes the GIL, to call the wake handler;
+// the handler schedules take_completions, which collects that one and everything queued after it.
+static std::mutex completions_mutex;
+static std::vector<std::pair<uint64_t, uint32_t>> completions;
+static py::object* wake_handler = nullptr; // Guarded by the GIL.
+
+static void on_utterance(uint64_t id, uint32_t state, void* userdata) {
+    {
+        std::lock_guard<std::mutex> lock(completions_mutex);
+        completions.emplace_back(id, state);
+        if (completions.size() > 1) {
+            return;
+        }
+    }
+    if (!Py_IsInitialized()) {
+        return;
+    }
+    py::gil_scoped_acquire acquire;
+    if (wake_handler != nullptr) {
+        try {
+            (*wake_handler)();
+        }
+        catch (py::error_already_set& error) {
+            error.discard_as_unraisable("speech_core completion handler");
+        }
+    }
 }
 
 PYBIND11_MODULE(SpeechCore, m) {
@@ -44,13 +68,27 @@ PYBIND11_MODULE(SpeechCore, m) {
     m.attr("SC_HAS_SPEECH") = py::int_(SC_HAS_SPEECH);
     m.attr("SC_HAS_BRAILLE") = py::int_(SC_HAS_BRAILLE);
     m.attr("SC_HAS_SPEECH_STATE") = py::int_(SC_HAS_SPEECH_STATE);
+    m.attr("SC_OUTPUT_INTERRUPT") = py::int_(SC_OUTPUT_INTERRUPT);
+    m.attr("SC_UTTERANCE_UNKNOWN") = py::int_(SC_UTTERANCE_UNKNOWN);
+    m.attr("SC_UTTERANCE_QUEUED") = py::int_(SC_UTTERANCE_QUEUED);
+    m.attr("SC_UTTERANCE_SPEAKING") = py::int_(SC_UTTERANCE_SPEAKING);
+    m.attr("SC_UTTERANCE_DONE") = py::int_(SC_UTTERANCE_DONE);
+    m.attr("SC_UTTERANCE_CANCELLED") = py::int_(SC_UTTERANCE_CANCELLED);
+    m.attr("SC_UTTERANCE_FAILED") = py::int_(SC_UTTERANCE_FAILED);
+    m.attr("SC_LOOPBACK_SPEAK") = py::int_(SC_LOOPBACK_SPEAK);
+    m.attr("SC_LATENCY_NONE") = py::int_(SC_LATENCY_NONE);
+    m.attr("SC_LATENCY_FIXED") = py::int_(SC_LATENCY_FIXED);
 
-    m.def("init", &Speech_Init);
-    m.def("free", &Speech_Free);
-    m.def("detect_driver", &Speech_Detect_Driver);
+    m.def("init", &Speech_Init, release_gil());
+    m.def("free", &Speech_Free, release_gil());
+    m.def("detect_driver", &Speech_Detect_Driver, release_gil());
     
     m.def("current_driver", []() -> py::object {
-        const wchar_t* driver = Speech_Current_Driver();
+        const wchar_t* driver;
+        {
+            py::gil_scoped_release release;
+            driver = Speech_Current_Driver();
+        }
         if (driver) {
             return py::str(wchar_to_string(driver));
         }
@@ -58,39 +96,93 @@ PYBIND11_MODULE(SpeechCore, m) {
     });
     
     m.def("get_driver", [](int index) -> py::object {
-        const wchar_t* driver = Speech_Get_Driver(index);
+        const wchar_t* driver;
+        {
+            py::gil_scoped_release release;
+            driver = Speech_Get_Driver(index);
+        }
         if (driver) {
             return py::str(wchar_to_string(driver));
         }
         return py::none();
     }, py::arg("index"));
     
-    m.def("set_driver", &Speech_Set_Driver, py::arg("index"));
-    m.def("get_drivers", &Speech_Get_Drivers);
-    m.def("get_flags", &Speech_Get_Flags);
+    m.def("set_driver", &Speech_Set_Driver, py::arg("index"), release_gil());
+    m.def("get_drivers", &Speech_Get_Drivers, release_gil());
+    m.def("get_flags", &Speech_Get_Flags, release_gil());
     m.def("is_loaded", &Speech_Is_Loaded);
-    m.def("is_speaking", &Speech_Is_Speaking);
+    m.def("is_speaking", &Speech_Is_Speaking, release_gil());
+    m.def("wait_until_done", &Speech_Wait_Until_Done, py::arg("timeout_ms"), release_gil());
+    m.def("set_async", &Speech_Set_Async, py::arg("async_output"), release_gil());
+    m.def("is_async", &Speech_Is_Async);
     
-    m.def("output", [](const std::string& text, bool interrupt = false) -> bool {
-        static thread_local std::wstring wtext_holder;
-        wtext_holder = string_to_wstring(text);
-        return Speech_Output(wtext_holder.c_str(), interrupt);
-    }, py::arg("text"), py::arg("interrupt") = false);
+    // string_view borrows the UTF-8 Python already holds for the str, and the library takes it as is.
+    // The arguments are converted before the GIL is released, and the caller keeps the str alive for the call.
+    m.def("output", [](std::string_view text, bool interrupt = false) -> bool {
+        return Speech_Output_Utf8(text.data(), text.size(), interrupt);
+    }, py::arg("text"), py::arg("interrupt") = false, release_gil());
     
-    m.def("braille", [](const std::string& text) -> bool {
-        static thread_local std::wstring wtext_holder;
-        wtext_holder = string_to_wstring(text);
-        return Speech_Braille(wtext_holder.c_str());
-    }, py::arg("text"));
+    m.def("output_batch", [](const std::vector<std::string>& texts, bool interrupt = false) -> bool {
+        static thread_local std::vector<std::wstring> wtext_holder;
+        static thread_local std::vector<const wchar_t*> wtext_pointers;
+        wtext_holder.resize(texts.size());
+        wtext_pointers.resize(texts.size());
+        for (size_t i = 0; i < texts.size(); i++) {
+            wtext_holder[i] = string_to_wstring(texts[i]);
+            wtext_pointers[i] = wtext_holder[i].c_str();
+        }
+        py::gil_scoped_release release;
+        return Speech_Output_Batch(wtext_pointers.data(), wtext_pointers.size(), interrupt ? SC_OUTPUT_INTERRUPT : 0);
+    }, py::arg("texts"), py::arg("interrupt") = false);
+    
+    m.def("braille", [](std::string_view text) -> bool {
+        return Speech_Braille_Utf8(text.data(), text.size());
+    }, py::arg("text"), release_gil());
+
+    // Utterance handles, and what the asyncio API is built on.
+    m.def("output_ex", [](std::string_view text, uint32_t flags) -> uint64_t {
+        return Speech_Output_Ex_Utf8(text.data(), text.size(), flags);
+    }, py::arg("text"), py::arg("flags") = 0, release_gil());
+    m.def("get_utterance_state", &Speech_Get_Utterance_State, py::arg("id"));
+    m.def("wait", &Speech_Wait, py::arg("id"), py::arg("timeout_ms"), release_gil());
+    m.def("cancel", &Speech_Cancel, py::arg("id"), release_gil());
+
+    // handler is called without arguments, on a library thread, when completions are waiting. None removes it.
+    m.def("set_completion_handler", [](py::object handler) {
+        {
+            std::lock_guard<std::mutex> lock(completions_mutex);
+            completions.clear();
+        }
+        delete wake_handler;
+        wake_handler = handler.is_none() ? nullptr : new py::object(std::move(handler));
+        sc_utterance_callback callback = (wake_handler != nullptr) ? on_utterance : nullptr;
+        py::gil_scoped_release release;
+        Speech_Set_Utterance_Callback(callback, nullptr);
+    }, py::arg("handler"));
+
+    // Returns the (id, state) pairs of the utterances finished since the last call.
+    m.def("take_completions", []() {
+        std::vector<std::pair<uint64_t, uint32_t>> taken;
+        std::lock_guard<std::mutex> lock(completions_mutex);
+        taken.swap(completions);
+        return taken;
+    });
+
+    m.def("loopback_set_latency", &Loopback_Set_Latency, py::arg("call"), py::arg("model"), py::arg("a_us"), py::arg("b_us") = 0);
+    m.def("loopback_reset", &Loopback_Reset);
     
-    m.def("stop", &Speech_Stop);
-    m.def("get_volume", &Speech_Get_Volume);
-    m.def("set_volume", &Speech_Set_Volume, py::arg("volume"));
-    m.def("get_rate", &Speech_Get_Rate);
-    m.def("set_rate", &Speech_Set_Rate, py::arg("rate"));
+    m.def("stop", &Speech_Stop, release_gil());
+    m.def("get_volume", &Speech_Get_Volume, release_gil());
+    m.def("set_volume", &Speech_Set_Volume, py::arg("volume"), release_gil());
+    m.def("get_rate", &Speech_Get_Rate, release_gil());
+    m.def("set_rate", &Speech_Set_Rate, py::arg("rate"), release_gil());
     
     m.def("get_current_voice", []() -> py::object {
-        const wchar_t* voice = Speech_Get_Current_Voice();
+        const wchar_t* voice;
+        {
+            py::gil_scoped_release release;
+            voice = Speech_Get_Current_Voice();
+        }
         if (voice) {
             return py::str(wchar_to_string(voice));
         }
@@ -98,33 +190,42 @@ PYBIND11_MODULE(SpeechCore, m) {
     });
     
     m.def("get_voice", [](int index) -> py::object {
-        const wchar_t* voice = Speech_Get_Voice(index);
+        const wchar_t* voice;
+        {
+            py::gil_scoped_release release;
+            voice = Speech_Get_Voice(index);
+        }
         if (voice) {
             return py::str(wchar_to_string(voice));
         }
         return py::none();
     }, py::arg("index"));
     
-    m.def("set_voice", &Speech_Set_Voice, py::arg("index"));
-    m.def("get_voices", &Speech_Get_Voices);
+    m.def("set_voice", &Speech_Set_Voice, py::arg("index"), release_gil());
+    m.def("get_voices", &Speech_Get_Voices, release_gil());
     
     m.def("output_file", [](const std::string& file_path, const std::string& text) {
         static thread_local std::wstring wtext_holder;
         wtext_holder = string_to_wstring(text);
+        py::gil_scoped_release release;
         Speech_Output_File(file_path.c_str(), wtext_holder.c_str());
     }, py::arg("file_path"), py::arg("text"));
     
-    m.def("resume", &Speech_Resume);
-    m.def("pause", &Speech_Pause);
+    m.def("resume", &Speech_Resume, release_gil());
+    m.def("pause", &Speech_Pause, release_gil());
 
 #ifdef _WIN32
-    m.def("prefer_sapi", &Speech_Prefer_Sapi, py::arg("prefer_sapi"));
-    m.def("sapi_loaded", &Speech_Sapi_Loaded);
-    m.def("sapi_init", &Sapi_Init);
-    m.def("sapi_release", &Sapi_Release);
+    m.def("prefer_sapi", &Speech_Prefer_Sapi, py::arg("prefer_sapi"), release_gil());
+    m.def("sapi_loaded", &Speech_Sapi_Loaded, release_gil());
+    m.def("sapi_init", &Sapi_Init, release_gil());
+    m.def("sapi_release", &Sapi_Release, release_gil());
     
     m.def("sapi_get_current_voice", []() -> py::object {
-        const wchar_t* voice = Sapi_Get_Current_Voice();
+        const wchar_t* voice;
+        {
+            py::gil_scoped_release release;
+            voice = Sapi_Get_Current_Voice();
+        }
         if (voice) {
             return py::str(wchar_to_string(voice));
         }
@@ -132,7 +233,11 @@ PYBIND11_MODULE(SpeechCore, m) {
     });
     
     m.def("sapi_get_voice", [](int index) -> py::object {
-        const wchar_t* voice = Sapi_Get_Voice(index);
+        const wchar_t* voice;
+        {
+            py::gil_scoped_release release;
+            voice = Sapi_Get_Voice(index);
+        }
         if (voice) {
             return py::str(wchar_to_string(voice));
         }
@@ -142,31 +247,34 @@ PYBIND11_MODULE(SpeechCore, m) {
     m.def("sapi_set_voice", [](const std::string& voice) {
         static thread_local std::wstring wvoice_holder;
         wvoice_holder = string_to_wstring(voice);
+        py::gil_scoped_release release;
         Sapi_Set_Voice(wvoice_holder.c_str());
     }, py::arg("voice"));
     
-    m.def("sapi_set_voice_by_index", &Sapi_Set_Voice_By_Index, py::arg("index"));
-    m.def("sapi_get_voices", &Sapi_Get_Voices);
-    m.def("sapi_voice_get_volume", &Sapi_Voice_Get_Volume);
-    m.def("sapi_voice_set_volume", &Sapi_Voice_Set_Volume, py::arg("volume"));
-    m.def("sapi_voice_get_rate", &Sapi_Voice_Get_Rate);
-    m.def("sapi_voice_set_rate", &Sapi_Voice_Set_Rate, py::arg("rate"));
+    m.def("sapi_set_voice_by_index", &Sapi_Set_Voice_By_Index, py::arg("index"), release_gil());
+    m.def("sapi_get_voices", &Sapi_Get_Voices, release_gil());
+    m.def("sapi_voice_get_volume", &Sapi_Voice_Get_Volume, release_gil());
+    m.def("sapi_voice_set_volume", &Sapi_Voice_Set_Volume, py::arg("volume"), release_gil());
+    m.def("sapi_voice_get_rate", &Sapi_Voice_Get_Rate, release_gil());
+    m.def("sapi_voice_set_rate", &Sapi_Voice_Set_Rate, py::arg("rate"), release_gil());
     
     m.def("sapi_speak", [](const std::string& text, bool interrupt = false, bool xml = false) {
         static thread_local std::wstring wtext_holder;
         wtext_holder = string_to_wstring(text);
+        py::gil_scoped_release release;
         Sapi_Speak(wtext_holder.c_str(), interrupt, xml);
     }, py::arg("text"), py::arg("interrupt") = false, py::arg("xml") = false);
     
     m.def("sapi_output_file", [](const std::string& filename, const std::string& text, bool xml = false) {
         static thread_local std::wstring wtext_holder;
         wtext_holder = string_to_wstring(text);
+        py::gil_scoped_release release;
         Sapi_Output_File(filename.c_str(), wtext_holder.c_str(), xml);
     }, py::arg("filename"), py::arg("text"), py::arg("xml") = false);
     
-    m.def("sapi_pause", &Sapi_Pause);
-    m.def("sapi_resume", &Sapi_Resume);
-    m.def("sapi_stop", &Sapi_Stop);
+    m.def("sapi_pause", &Sapi_Pause, release_gil());
+    m.def("sapi_resume", &Sapi_Resume, release_gil());
+    m.def("sapi_stop", &Sapi_Stop, release_gil());
 #endif
 
 #ifdef VERSION_INFO
@@ -0,0 +1,57 @@
+#include "Coalescer.h"
+
+Coalescer::~Coalescer() {
+	discard();
+}
+
+speech_message* Coalescer::add(speech_message* message) {
+	if (held != nullptr && held->priority != message->priority && message->priority == SC_PRIORITY_CRITICAL) {
+		// Interrupted before it was ever spoken, the same as in the scheduler. The critical message starts its own window.
+		delete held;
+		held = nullptr;
+		dropped.fetch_add(1, std::memory_order_relaxed);
+	}
+	if (held == nullptr || held->priority != message->priority) {
+		speech_message* released = held;
+		held = message;
+		held_deadline = clock::now() + std::chrono::milliseconds(get_window());
+		return released;
+	}
+	if (message->priority == SC_PRIORITY_CRITICAL) {
+		// Superseded before it was ever spoken. The window keeps running from the first message,
+		// so a long key-repeat burst still produces output at least once per window.
+		delete held;
+		held = message;
+		dropped.fetch_add(1, std::memory_order_relaxed);
+		return nullptr;
+	}
+	held->merge(*message);
+	delete message;
+	merged.fetch_add(1, std::memory_order_relaxed);
+	return nullptr;
+}
+
+bool Coalescer::window_changed() {
+	uint64_t changes = window_changes.load(std::memory_order_acquire);
+	if (changes == seen_changes) {
+		return false;
+	}
+	seen_changes = changes;
+	return true;
+}
+
+speech_message* Coalescer::take() {
+	speech_message* message = held;
+	held = nullptr;
+	return message;
+}
+
+void Coalescer::discard() {
+	delete held;
+	held = nullptr;
+}
+
+void Coalescer::reset_counters() {
+	dropped.store(0, std::memory_order_relaxed);
+	merged.store(0, std::memory_order_relaxed);
+}
@@ -0,0 +1,51 @@
+// Coalescing stage used by the output worker.
+// Within the configured window a critical message drops whatever message is held before it,
+// and messages of other classes are merged into the held utterance of the same class. The held
+// utterance is released once the window, counted from its first message, has elapsed,
+// or earlier when a non-critical message of a different class arrives.
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include "SpeechMessage.h"
+
+class Coalescer {
+public:
+	using clock = std::chrono::steady_clock;
+
+	Coalescer() = default;
+	~Coalescer();
+	Coalescer(const Coalescer&) = delete;
+	Coalescer& operator=(const Coalescer&) = delete;
+
+	void set_window(uint32_t window_ms) {
+		window.store(window_ms, std::memory_order_relaxed);
+		window_changes.fetch_add(1, std::memory_order_release);
+	}
+	uint32_t get_window() const { return window.load(std::memory_order_relaxed); }
+	bool enabled() const { return get_window() != 0; }
+// Whether the window was set since the last call. The held message has to go out then, before anything added later.
+	bool window_changed();
+
+// Takes ownership of the message. Returns a previously held message of another class, which the caller now owns,
+// unless the new message is critical and dropped it.
+	speech_message* add(speech_message* message);
+	bool holding() const { return held != nullptr; }
+	clock::time_point deadline() const { return held_deadline; }
+// Releases the held message; the caller takes ownership.
+	speech_message* take();
+	void discard();
+
+	uint64_t dropped_count() const { return dropped.load(std::memory_order_relaxed); }
+	uint64_t merged_count() const { return merged.load(std::memory_order_relaxed); }
+	void reset_counters();
+
+private:
+	speech_message* held = nullptr;
+	clock::time_point held_deadline;
+	std::atomic<uint32_t> window{ 0 };
+	std::atomic<uint64_t> window_changes{ 0 };
+	uint64_t seen_changes = 0;
+	std::atomic<uint64_t> dropped{ 0 };
+	std::atomic<uint64_t> merged{ 0 };
+};
@@ -0,0 +1,127 @@
+#include "DedupCache.h"
+
+namespace {
+
+constexpr uint64_t fnv_offset = 0xCBF29CE484222325ull;
+constexpr uint64_t fnv_prime = 0x100000001B3ull;
+
+// FNV-1a over code points rather than code units, so both encodings of a text hash the same.
+inline uint64_t mix_code_point(uint64_t hash, uint32_t code_point) {
+	return (hash ^ code_point) * fnv_prime;
+}
+
+// splitmix64 finalizer, spreads the combined fields over all bits of the key.
+inline uint64_t finalize(uint64_t value) {
+	value ^= value >> 30;
+	value *= 0xBF58476D1CE4E5B9ull;
+	value ^= value >> 27;
+	value *= 0x94D049BB133111EBull;
+	return value ^ (value >> 31);
+}
+
+}
+
+uint64_t DedupCache::hash(const wchar_t* text, size_t count) {
+	uint64_t hash = fnv_offset;
+	for (size_t i = 0; i < count; i++) {
+		uint32_t unit = static_cast<uint32_t>(text[i]);
+		if constexpr (sizeof(wchar_t) == 2) {
+			if (unit >= 0xD800 && unit <= 0xDBFF && i + 1 < count) {
+				uint32_t low = static_cast<uint32_t>(text[i + 1]);
+				if (low >= 0xDC00 && low <= 0xDFFF) {
+					unit = 0x10000 + ((unit - 0xD800) << 10) + (low - 0xDC00);
+					i++;
+				}
+			}
+		}
+		hash = mix_code_point(hash, unit);
+	}
+	return hash;
+}
+
+uint64_t DedupCache::hash(const char* text, size_t count) {
+	uint64_t hash = fnv_offset;
+	size_t i = 0;
+	while (i < count) {
+		unsigned char lead = static_cast<unsigned char>(text[i]);
+		if (lead < 0x80) {
+			hash = mix_code_point(hash, lead);
+			i++;
+			continue;
+		}
+		size_t length = ((lead >> 5) == 0x06) ? 2 : ((lead >> 4) == 0x0E) ? 3 : ((lead >> 3) == 0x1E) ? 4 : 0;
+		uint32_t code_point = (length != 0) ? (lead & (0x7F >> length)) : 0;
+		bool valid = length != 0 && i + length <= count;
+		for (size_t k = 1; valid && k < length; k++) {
+			unsigned char unit = static_cast<unsigned char>(text[i + k]);
+			valid = (unit & 0xC0) == 0x80;
+			code_point = (code_point << 6) | (unit & 0x3F);
+		}
+		// Malformed bytes hash apart from any code point.
+		hash = mix_code_point(hash, valid ? code_point : 0x80000000u | lead);
+		i += valid ? length : 1;
+	}
+	return hash;
+}
+
+uint64_t DedupCache::key(uint64_t text_hash, const void* driver, uint32_t priority) const {
+	return finalize(text_hash ^ finalize(reinterpret_cast<uintptr_t>(driver)
+		^ (static_cast<uint64_t>(priority) << 56) ^ generation.load(std::memory_order_relaxed)));
+}
+
+bool DedupCache::repeated(uint64_t key) {
+	clock::time_point now = clock::now();
+	clock::duration horizon = std::chrono::milliseconds(get_window());
+	std::lock_guard<std::mutex> guard(lock);
+	for (const entry& candidate : entries) {
+		if (candidate.key == key && now - candidate.spoken < horizon) {
+			hits.fetch_add(1, std::memory_order_relaxed);
+			return true;
+		}
+	}
+	misses.fetch_add(1, std::memory_order_relaxed);
+	return false;
+}
+
+void DedupCache::spoken(uint64_t key, uint64_t cleared) {
+	clock::time_point now = clock::now();
+	std::lock_guard<std::mutex> guard(lock);
+	if (clears.load(std::memory_order_relaxed) != cleared) {
+		return;
+	}
+	entry* oldest = nullptr;
+	for (entry& candidate : entries) {
+		if (candidate.key == key) {
+			candidate.spoken = now; // Spoken again: the window restarts from now.
+			return;
+		}
+		if (oldest == nullptr || candidate.spoken < oldest->spoken) {
+			oldest = &candidate;
+		}
+	}
+	if (entries.size() < get_capacity()) {
+		entries.push_back({ key, now });
+	}
+	else if (oldest != nullptr) {
+		*oldest = { key, now };
+	}
+}
+
+void DedupCache::set_capacity(uint32_t _entries) {
+	capacity.store(_entries, std::memory_order_relaxed);
+	std::lock_guard<std::mutex> guard(lock);
+	if (entries.size() > _entries) {
+		entries.clear(); // Rare, the next utterances fill it again.
+	}
+}
+
+void DedupCache::clear() {
+	std::lock_guard<std::mutex> guard(lock);
+	entries.clear();
+	clears.fetch_add(1, std::memory_order_release);
+}
+
+void DedupCache::reset_counters() {
+	hits.store(0, std::memory_order_relaxed);
+	misses.store(0, std::memory_order_relaxed);
+}
@@ -0,0 +1,64 @@
+// Deduplication stage in front of the drivers.
+// Remembers the most recently spoken utterances, keyed by a hash of their text, the driver, the priority class and
+// the speech parameters, and suppresses an exact repeat that comes within the window after it was last spoken.
+// An utterance only counts as spoken once the driver accepted it and no stop or interrupt cut it off meanwhile.
+// The entries are a small fixed set, the one spoken longest ago is replaced first.
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+class DedupCache {
+public:
+	using clock = std::chrono::steady_clock;
+
+	static constexpr uint32_t default_capacity = 64;
+
+	DedupCache() = default;
+	DedupCache(const DedupCache&) = delete;
+	DedupCache& operator=(const DedupCache&) = delete;
+
+	void set_window(uint32_t window_ms) { window.store(window_ms, std::memory_order_relaxed); }
+	uint32_t get_window() const { return window.load(std::memory_order_relaxed); }
+	bool enabled() const { return get_window() != 0; }
+	void set_capacity(uint32_t entries);
+	uint32_t get_capacity() const { return capacity.load(std::memory_order_relaxed); }
+
+// Hashes of the text, equal for the same text whether it came as wchar_t or UTF-8.
+	static uint64_t hash(const wchar_t* text, size_t count);
+	static uint64_t hash(const char* text, size_t count);
+// Key of an utterance, from the hash of its text, the driver, the priority class and the speech parameters.
+	uint64_t key(uint64_t text_hash, const void* driver, uint32_t priority) const;
+// Returns true if the utterance was spoken within the window.
+	bool repeated(uint64_t key);
+// Remembers the utterance as spoken now, once the driver took it. Skipped when the cache was cleared since
+// clear_count() returned cleared: speech cut off by a stop or an interrupt was not heard, a repeat has to go through.
+	void spoken(uint64_t key, uint64_t cleared);
+	uint64_t clear_count() const { return clears.load(std::memory_order_acquire); }
+// Volume, rate or voice changed, so nothing spoken before counts as a repeat.
+	void parameters_changed() { generation.fetch_add(1, std::memory_order_relaxed); }
+// Forgets everything, used when speech was stopped or interrupted and when the driver changes.
+	void clear();
+
+	uint64_t hit_count() const { return hits.load(std::memory_order_relaxed); }
+	uint64_t miss_count() const { return misses.load(std::memory_order_relaxed); }
+	void reset_counters();
+
+private:
+	struct entry {
+		uint64_t key;
+		clock::time_point spoken;
+	};
+
+	std::mutex lock;
+	std::vector<entry> entries;
+	std::atomic<uint32_t> window{ 0 };
+	std::atomic<uint32_t> capacity{ default_capacity };
+	std::atomic<uint64_t> generation{ 0 };
+	std::atomic<uint64_t> clears{ 0 };
+	std::atomic<uint64_t> hits{ 0 };
+	std::atomic<uint64_t> misses{ 0 };
+};
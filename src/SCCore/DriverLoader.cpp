@@ -0,0 +1,179 @@
+#include "DriverLoader.h"
+
+DriverLoader::~DriverLoader() {
+	abandon();
+	reap(join_timeout_ms);
+	// Left with drivers whose init never returned. The process is going away, waiting longer would only hang it.
+	for (auto& owner : stragglers) {
+		for (auto& job : owner->jobs) {
+			if (job->thread.joinable()) {
+				job->thread.detach();
+			}
+		}
+	}
+}
+
+void DriverLoader::begin(ready_fn ready) {
+	abandon();
+	reap(0);
+	current = std::make_shared<session>();
+	current->ready = std::move(ready);
+}
+
+void DriverLoader::add(ScreenReader* driver, bool detectable, uint32_t timeout_ms) {
+	std::lock_guard<std::mutex> lock(current->mutex);
+	auto job = std::make_unique<init_job>();
+	job->driver = driver;
+	job->detectable = detectable;
+	job->rank = static_cast<uint32_t>(current->jobs.size());
+	job->deadline = clock::now() + std::chrono::milliseconds(timeout_ms);
+	job->thread = std::thread(&DriverLoader::run, current, job.get());
+	current->jobs.push_back(std::move(job));
+}
+
+bool DriverLoader::wait() {
+	if (!current) {
+		return false;
+	}
+	std::unique_lock<std::mutex> lock(current->mutex);
+	clock::time_point deadline = clock::now();
+	for (auto& job : current->jobs) {
+		if (job->deadline > deadline) {
+			deadline = job->deadline;
+		}
+	}
+	current->changed.wait_until(lock, deadline, [this] {
+		return current->usable || current->abandoned || current->finished == current->jobs.size();
+	});
+	return !current->abandoned;
+}
+
+void DriverLoader::cancel() {
+	if (!current) {
+		return;
+	}
+	{
+		std::lock_guard<std::mutex> lock(current->mutex);
+		current->abandoned = true;
+	}
+	current->changed.notify_all();
+}
+
+void DriverLoader::abandon() {
+	if (!current) {
+		return;
+	}
+	cancel();
+	{
+		std::unique_lock<std::mutex> lock(current->mutex);
+		// A ready callback in progress publishes into the registry, which the caller tears down next.
+		current->changed.wait(lock, [this] { return current->publishing == 0; });
+		current->changed.wait_for(lock, std::chrono::milliseconds(join_timeout_ms), [this] {
+			return current->returned == current->jobs.size();
+		});
+	}
+	if (!join_returned(*current)) {
+		stragglers.push_back(std::move(current));
+	}
+	current.reset();
+}
+
+bool DriverLoader::join_returned(session& owner) {
+	bool all = true;
+	for (auto& job : owner.jobs) {
+		bool returned;
+		{
+			std::lock_guard<std::mutex> lock(owner.mutex);
+			returned = job->returned;
+		}
+		if (!returned) {
+			all = false;
+		}
+		else if (job->thread.joinable()) {
+			job->thread.join();
+		}
+	}
+	return all;
+}
+
+// Joins the init threads of earlier sessions, waiting for them until timeout_ms from now.
+void DriverLoader::reap(uint32_t timeout_ms) {
+	clock::time_point deadline = clock::now() + std::chrono::milliseconds(timeout_ms);
+	for (auto it = stragglers.begin(); it != stragglers.end();) {
+		session& owner = **it;
+		{
+			std::unique_lock<std::mutex> lock(owner.mutex);
+			owner.changed.wait_until(lock, deadline, [&owner] { return owner.returned == owner.jobs.size(); });
+		}
+		it = join_returned(owner) ? stragglers.erase(it) : it + 1;
+	}
+}
+
+size_t DriverLoader::count() const {
+	if (!current) {
+		return 0;
+	}
+	std::lock_guard<std::mutex> lock(current->mutex);
+	return current->jobs.size();
+}
+
+bool DriverLoader::info(size_t index, sc_driver_init& init) const {
+	if (!current) {
+		return false;
+	}
+	std::lock_guard<std::mutex> lock(current->mutex);
+	if (index >= current->jobs.size()) {
+		return false;
+	}
+	const init_job& job = *current->jobs[index];
+	init.name = (job.driver != nullptr) ? job.driver->get_name() : L"";
+	init.state = job.state.load(std::memory_order_acquire);
+	if (init.state == SC_INIT_PENDING && clock::now() > job.deadline) {
+		init.state = SC_INIT_TIMED_OUT;
+	}
+	init.init_ns = job.init_ns.load(std::memory_order_relaxed);
+	return true;
+}
+
+void DriverLoader::run(std::shared_ptr<session> owner, init_job* job) {
+	auto start = clock::now();
+	job->driver->init();
+	auto end = clock::now();
+	job->init_ns.store(static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count()), std::memory_order_relaxed);
+
+	ScreenReader* unused = nullptr;
+	{
+		std::lock_guard<std::mutex> lock(owner->mutex);
+		if (owner->abandoned) {
+			// Nobody will take the driver anymore.
+			unused = job->driver;
+			job->driver = nullptr;
+		}
+		else {
+			owner->publishing++;
+		}
+	}
+	bool usable = false;
+	if (unused != nullptr) {
+		delete unused;
+	}
+	else {
+		// Unlocked, so publishing into the registry never holds up wait() or the other init threads.
+		std::lock_guard<std::mutex> ready_lock(owner->ready_mutex);
+		usable = owner->ready(job->driver, job->detectable, job->rank);
+	}
+	{
+		std::lock_guard<std::mutex> lock(owner->mutex);
+		if (unused == nullptr) {
+			owner->publishing--;
+			owner->finished++;
+			if (usable && job->detectable) {
+				owner->usable = true;
+			}
+		}
+		job->state.store((end > job->deadline) ? SC_INIT_LATE : SC_INIT_READY, std::memory_order_release);
+		job->returned = true;
+		owner->returned++;
+	}
+	owner->changed.notify_all();
+}
@@ -0,0 +1,80 @@
+// Runs the init() of every driver on its own thread so startup costs the slowest wait, not the sum of all probes.
+// Speech_Init waits until a usable driver is ready or every driver reached its deadline; drivers finishing later
+// are still handed to the ready callback and join the registry then.
+// Init threads end once init() returned, so a driver must not leave per-thread state behind on them: one that needs
+// a COM apartment for its lifetime keeps a thread of its own (see ScreenReaderJaws).
+// A driver whose init hangs only holds up Speech_Free for a bounded wait: its thread is kept and deletes the driver
+// itself once init returns, and is joined by a later session or, again bounded, when the loader is destroyed.
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "../SCDrivers/SCDriver.h"
+
+class DriverLoader {
+public:
+	using clock = std::chrono::steady_clock;
+// Called on the init thread once the driver is initialized, returns whether the driver is running and usable.
+// Never called concurrently, never with the session locked, and never after abandon() returned.
+	using ready_fn = std::function<bool(ScreenReader* driver, bool detectable, uint32_t rank)>;
+
+	static constexpr uint32_t join_timeout_ms = 1000; // How long abandon() waits for drivers still initializing.
+
+	DriverLoader() = default;
+	~DriverLoader();
+	DriverLoader(const DriverLoader&) = delete;
+	DriverLoader& operator=(const DriverLoader&) = delete;
+
+// Starts a new loading session. Ranks are assigned in the order drivers are added.
+	void begin(ready_fn ready);
+	void add(ScreenReader* driver, bool detectable, uint32_t timeout_ms);
+// Waits until a usable driver is ready, every driver finished, or every pending driver passed its deadline.
+// Returns false when the session was cancelled meanwhile.
+	bool wait();
+// Stops handing drivers to the ready callback and wakes wait(). Safe to call while another thread waits.
+	void cancel();
+// Cancels the session and joins its init threads. Waits for ready callbacks in progress, and up to join_timeout_ms
+// for drivers still initializing. Those that take longer delete themselves once their init returns and are joined later.
+	void abandon();
+
+	size_t count() const;
+	bool info(size_t index, sc_driver_init& init) const;
+
+private:
+	struct init_job {
+		ScreenReader* driver;
+		bool detectable;
+		uint32_t rank;
+		clock::time_point deadline;
+		std::atomic<uint32_t> state{ SC_INIT_PENDING };
+		std::atomic<uint64_t> init_ns{ 0 };
+		std::thread thread;
+		bool returned = false; // Under the session mutex, set once the thread is about to exit.
+	};
+	struct session {
+		std::mutex mutex;
+		std::condition_variable changed;
+		std::mutex ready_mutex; // Serializes the ready callbacks, which run without the session locked.
+		ready_fn ready;
+		std::vector<std::unique_ptr<init_job>> jobs;
+		size_t finished = 0; // Jobs handed to the ready callback.
+		size_t returned = 0; // Jobs whose thread is done, finished or not.
+		size_t publishing = 0; // Ready callbacks in progress.
+		bool usable = false;
+		bool abandoned = false;
+	};
+
+	std::shared_ptr<session> current;
+	std::vector<std::shared_ptr<session>> stragglers; // Abandoned sessions with init threads that did not return yet.
+
+	static void run(std::shared_ptr<session> owner, init_job* job);
+// Joins the threads of an abandoned session that returned, and returns whether all of them did.
+	static bool join_returned(session& owner);
+	void reap(uint32_t timeout_ms);
+};
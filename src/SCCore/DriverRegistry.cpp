@@ -0,0 +1,37 @@
+#include <algorithm>
+#include "DriverRegistry.h"
+
+void DriverRegistry::publish(driver_list* list) {
+	std::lock_guard<std::mutex> lock(writer);
+	replace(list);
+}
+
+void DriverRegistry::insert(driver_entry* entry) {
+	std::lock_guard<std::mutex> lock(writer);
+	const driver_list* previous = drivers.load(std::memory_order_acquire);
+	driver_list* list = (previous != nullptr) ? new driver_list(*previous) : new driver_list();
+	auto position = std::upper_bound(list->entries.begin(), list->entries.end(), entry,
+		[](const driver_entry* a, const driver_entry* b) { return a->rank < b->rank; });
+	list->entries.insert(position, entry);
+	replace(list);
+}
+
+driver_list* DriverRegistry::retire() {
+	std::lock_guard<std::mutex> lock(writer);
+	driver_list* previous = drivers.exchange(nullptr, std::memory_order_acq_rel);
+	// Readers that still saw the old list may select one of its entries, so clear the selection only once they left,
+	// then wait again for readers that picked up that selection.
+	rcu.synchronize();
+	selected.store(nullptr, std::memory_order_release);
+	rcu.synchronize();
+	return previous;
+}
+
+// Requires the writer lock.
+void DriverRegistry::replace(driver_list* list) {
+	driver_list* previous = drivers.exchange(list, std::memory_order_acq_rel);
+	if (previous != nullptr) {
+		rcu.synchronize();
+		delete previous;
+	}
+}
@@ -0,0 +1,90 @@
+// Driver registry shared by every API entry point.
+// The list of drivers and the selected driver are published through atomics and protected by an RCU domain:
+// the speak path reads them without taking a lock, while switching, adding and tearing down drivers is safe
+// against concurrent readers.
+#pragma once
+#include <atomic>
+#include <mutex>
+#include <vector>
+#include "DriverStats.h"
+#include "Rcu.h"
+#include "../SCDrivers/SCDriver.h"
+
+struct driver_entry {
+	ScreenReader* driver;
+	std::atomic<bool> alive{ false }; // Cached result of the last is_running() probe.
+	bool detectable = true; // False for drivers that are only used when selected explicitly.
+	uint32_t rank = 0; // Position in the preference order, entries are listed by rank.
+	std::atomic<bool> loaded{ true }; // False until init() ran, for drivers registered lazily.
+	std::mutex load_mutex;
+	DriverStats stats;
+
+	explicit driver_entry(ScreenReader* _driver, bool _detectable = true, uint32_t _rank = 0, bool _loaded = true) :
+		driver(_driver), detectable(_detectable), rank(_rank), loaded(_loaded) {}
+
+// Runs init() of a lazily registered driver once, on first detection or selection. Its module is loaded from then on.
+// init() can take seconds, so this is never called under a read guard: it would hold up every writer meanwhile.
+	void load() {
+		if (loaded.load(std::memory_order_acquire)) {
+			return;
+		}
+		std::lock_guard<std::mutex> lock(load_mutex);
+		if (!loaded.load(std::memory_order_relaxed)) {
+			driver->init();
+			loaded.store(true, std::memory_order_release);
+		}
+	}
+	bool is_loaded() const { return loaded.load(std::memory_order_acquire); }
+
+// A driver that was never loaded counts as not running, loading it is up to the caller.
+	bool probe() {
+		if (!is_loaded()) {
+			return false;
+		}
+		bool running = stats.time(SC_STAT_IS_RUNNING, [this] { return driver->is_running(); });
+		alive.store(running, std::memory_order_relaxed);
+		return running;
+	}
+	bool is_alive() const { return alive.load(std::memory_order_relaxed); }
+};
+
+// Immutable snapshot of the registered drivers. Replaced as a whole, never modified once published.
+struct driver_list {
+	std::vector<driver_entry*> entries;
+	driver_entry* fallback = nullptr; // Selected when no listed driver is running (SAPI on Windows). Not listed.
+};
+
+class DriverRegistry {
+public:
+// Every pointer read from the registry stays valid for as long as a read_guard is alive on the same thread.
+	using read_guard = Rcu::read_guard;
+
+	DriverRegistry() = default;
+	DriverRegistry(const DriverRegistry&) = delete;
+	DriverRegistry& operator=(const DriverRegistry&) = delete;
+
+	Rcu& domain() { return rcu; }
+	const driver_list* list() const { return drivers.load(std::memory_order_acquire); }
+	driver_entry* current() const { return selected.load(std::memory_order_acquire); }
+
+	void select(driver_entry* entry) { selected.store(entry, std::memory_order_release); }
+// Replaces the selection only if it is still expected, so detection never overrides a concurrent Speech_Set_Driver.
+	bool select_if(driver_entry* expected, driver_entry* entry) {
+		return selected.compare_exchange_strong(expected, entry, std::memory_order_acq_rel);
+	}
+
+// Publishes a new snapshot and frees the previous one once no reader can see it. Entries are not freed.
+	void publish(driver_list* list);
+// Publishes a copy of the current snapshot with the entry added at its rank. Drivers that finish initializing late join this way.
+	void insert(driver_entry* entry);
+// Unpublishes everything and waits for readers to leave. The caller owns the returned list and its entries.
+	driver_list* retire();
+
+private:
+	std::atomic<driver_list*> drivers{ nullptr };
+	std::atomic<driver_entry*> selected{ nullptr };
+	std::mutex writer; // Serializes publish, insert and retire so concurrent updates never lose an entry.
+	Rcu rcu;
+
+	void replace(driver_list* list);
+};
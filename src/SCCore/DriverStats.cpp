@@ -0,0 +1,23 @@
+#include "DriverStats.h"
+
+void DriverStats::snapshot(sc_driver_stats& stats) const {
+	for (uint32_t call = 0; call < SC_STAT_CALLS; call++) {
+		const Histogram& histogram = histograms[call];
+		sc_call_stats& out = stats.calls[call];
+		out.calls = histogram.get_count();
+		out.failures = failures[call].load(std::memory_order_relaxed);
+		out.total_ns = histogram.get_total();
+		out.max_ns = histogram.get_max();
+		out.p50_ns = histogram.percentile(0.50);
+		out.p90_ns = histogram.percentile(0.90);
+		out.p99_ns = histogram.percentile(0.99);
+		out.p999_ns = histogram.percentile(0.999);
+	}
+}
+
+void DriverStats::reset() {
+	for (uint32_t call = 0; call < SC_STAT_CALLS; call++) {
+		histograms[call].reset();
+		failures[call].store(0, std::memory_order_relaxed);
+	}
+}
@@ -0,0 +1,53 @@
+// Per driver call statistics: a latency histogram and a failure counter for every SC_STAT_* call.
+// Timing is skipped entirely while statistics are disabled, so the disabled cost is one relaxed load.
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <type_traits>
+#include "Histogram.h"
+#include "../../include/SpeechCore.h"
+
+class DriverStats {
+public:
+	static inline std::atomic<bool> enabled{ false };
+
+	DriverStats() = default;
+	DriverStats(const DriverStats&) = delete;
+	DriverStats& operator=(const DriverStats&) = delete;
+
+// Runs the driver call, recording its duration and, for speak/stop/braille, whether it failed.
+	template <typename F>
+	auto time(uint32_t call, F&& driver_call) -> decltype(driver_call()) {
+		if (!enabled.load(std::memory_order_relaxed)) {
+			return driver_call();
+		}
+		auto start = std::chrono::steady_clock::now();
+		if constexpr (std::is_void_v<decltype(driver_call())>) {
+			driver_call();
+			record(call, start);
+		}
+		else {
+			auto result = driver_call();
+			record(call, start);
+			if constexpr (std::is_same_v<decltype(result), bool>) {
+				if (!result && call <= SC_STAT_BRAILLE) {
+					failures[call].fetch_add(1, std::memory_order_relaxed);
+				}
+			}
+			return result;
+		}
+	}
+
+	void snapshot(sc_driver_stats& stats) const;
+	void reset();
+
+private:
+	Histogram histograms[SC_STAT_CALLS];
+	std::atomic<uint64_t> failures[SC_STAT_CALLS] = {};
+
+	void record(uint32_t call, std::chrono::steady_clock::time_point start) {
+		auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start);
+		histograms[call].record(static_cast<uint64_t>(elapsed.count()));
+	}
+};
@@ -0,0 +1,66 @@
+#include <chrono>
+#include "HealthMonitor.h"
+
+namespace {
+
+thread_local bool monitor_thread = false;
+
+}
+
+bool HealthMonitor::on_monitor_thread() {
+	return monitor_thread;
+}
+
+HealthMonitor::~HealthMonitor() {
+	stop();
+}
+
+void HealthMonitor::start(probe_fn _probe, uint32_t interval_ms) {
+	std::lock_guard<std::mutex> guard(control_mutex);
+	if (thread.joinable() || interval_ms == 0) {
+		return;
+	}
+	probe = std::move(_probe);
+	interval.store(interval_ms, std::memory_order_relaxed);
+	stopping = false;
+	running.store(true, std::memory_order_release);
+	thread = std::thread(&HealthMonitor::run, this);
+}
+
+void HealthMonitor::stop() {
+	std::lock_guard<std::mutex> guard(control_mutex);
+	if (!thread.joinable()) {
+		return;
+	}
+	{
+		std::lock_guard<std::mutex> lock(wait_mutex);
+		stopping = true;
+	}
+	wait_condition.notify_one();
+	thread.join();
+	running.store(false, std::memory_order_release);
+}
+
+void HealthMonitor::set_interval(uint32_t interval_ms) {
+	{
+		std::lock_guard<std::mutex> lock(wait_mutex);
+		interval.store(interval_ms, std::memory_order_relaxed);
+		interval_changed = true;
+	}
+	wait_condition.notify_one();
+}
+
+void HealthMonitor::run() {
+	monitor_thread = true;
+	std::unique_lock<std::mutex> lock(wait_mutex);
+	while (!stopping) {
+		auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(interval.load(std::memory_order_relaxed));
+		interval_changed = false;
+		if (wait_condition.wait_until(lock, deadline, [this] { return stopping || interval_changed; })) {
+			continue; // Stopping, or restart the wait with the new interval.
+		}
+		lock.unlock();
+		probe();
+		lock.lock();
+	}
+}
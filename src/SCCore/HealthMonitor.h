@@ -0,0 +1,38 @@
+// Background thread probing driver liveness on a fixed interval.
+// The probe callback publishes its results into driver_entry::alive so the output path only reads a cached flag.
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+class HealthMonitor {
+public:
+	using probe_fn = std::function<void()>;
+
+	HealthMonitor() = default;
+	~HealthMonitor();
+
+	void start(probe_fn probe, uint32_t interval_ms);
+	void stop();
+	bool is_running() const { return running.load(std::memory_order_acquire); }
+	void set_interval(uint32_t interval_ms);
+	uint32_t get_interval() const { return interval.load(std::memory_order_relaxed); }
+// Whether the calling thread is a monitor thread, so drivers can tell background probes from calls made for a caller.
+	static bool on_monitor_thread();
+
+private:
+	probe_fn probe;
+	std::thread thread;
+	std::atomic<bool> running{ false };
+	std::atomic<uint32_t> interval{ 0 };
+	std::mutex control_mutex; // Serializes start and stop, so two starts never both assign the thread.
+	std::mutex wait_mutex;
+	std::condition_variable wait_condition;
+	bool stopping = false;
+	bool interval_changed = false;
+
+	void run();
+};
@@ -0,0 +1,68 @@
+#include "Histogram.h"
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif // _MSC_VER
+
+static uint32_t highest_bit(uint64_t value) {
+#ifdef _MSC_VER
+	unsigned long bit;
+	_BitScanReverse64(&bit, value);
+	return static_cast<uint32_t>(bit);
+#else
+	return 63 - static_cast<uint32_t>(__builtin_clzll(value));
+#endif // _MSC_VER
+}
+
+// Values below sub_buckets are stored exactly. Above that, a value whose highest set bit is msb lands in
+// octave msb - sub_bucket_bits + 1, at the linear sub bucket given by the sub_bucket_bits bits below msb.
+uint32_t Histogram::index_of(uint64_t value) {
+	if (value < sub_buckets) {
+		return static_cast<uint32_t>(value);
+	}
+	uint32_t msb = highest_bit(value);
+	if (msb >= max_bits) {
+		return bucket_count - 1;
+	}
+	uint32_t shift = msb - sub_bucket_bits;
+	uint32_t sub = static_cast<uint32_t>(value >> shift) - sub_buckets;
+	return (shift + 1) * sub_buckets + sub;
+}
+
+uint64_t Histogram::highest_of(uint32_t index) {
+	if (index < sub_buckets) {
+		return index;
+	}
+	uint32_t shift = index / sub_buckets - 1;
+	uint64_t sub = index % sub_buckets;
+	return ((sub_buckets + sub + 1) << shift) - 1;
+}
+
+uint64_t Histogram::percentile(double fraction) const {
+	uint64_t total_count = get_count();
+	if (total_count == 0) {
+		return 0;
+	}
+	uint64_t target = static_cast<uint64_t>(fraction * total_count);
+	if (target >= total_count) {
+		target = total_count - 1;
+	}
+	uint64_t seen = 0;
+	for (uint32_t i = 0; i < bucket_count; i++) {
+		seen += buckets[i].load(std::memory_order_relaxed);
+		if (seen > target) {
+			uint64_t highest = highest_of(i);
+			uint64_t observed = get_max();
+			return (highest < observed) ? highest : observed;
+		}
+	}
+	return get_max();
+}
+
+void Histogram::reset() {
+	for (auto& bucket : buckets) {
+		bucket.store(0, std::memory_order_relaxed);
+	}
+	count.store(0, std::memory_order_relaxed);
+	total.store(0, std::memory_order_relaxed);
+	max.store(0, std::memory_order_relaxed);
+}
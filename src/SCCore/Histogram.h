@@ -0,0 +1,43 @@
+// Lock-free log-linear latency histogram in the style of HdrHistogram.
+// Every power of two range is split into sub_buckets linear buckets, so any recorded value is
+// reported within 1/sub_buckets (6.25%) of its true value. Recording is a handful of relaxed atomic adds.
+#pragma once
+#include <atomic>
+#include <cstdint>
+
+class Histogram {
+public:
+	static constexpr uint32_t sub_bucket_bits = 4;
+	static constexpr uint32_t sub_buckets = 1 << sub_bucket_bits;
+	static constexpr uint32_t max_bits = 36; // Values from 2^36 (about 68 seconds in ns) up land in the last bucket.
+	static constexpr uint32_t bucket_count = (max_bits - sub_bucket_bits + 1) * sub_buckets;
+
+	Histogram() = default;
+	Histogram(const Histogram&) = delete;
+	Histogram& operator=(const Histogram&) = delete;
+
+	void record(uint64_t value) {
+		buckets[index_of(value)].fetch_add(1, std::memory_order_relaxed);
+		count.fetch_add(1, std::memory_order_relaxed);
+		total.fetch_add(value, std::memory_order_relaxed);
+		uint64_t current = max.load(std::memory_order_relaxed);
+		while (value > current && !max.compare_exchange_weak(current, value, std::memory_order_relaxed)) {
+		}
+	}
+
+	uint64_t get_count() const { return count.load(std::memory_order_relaxed); }
+	uint64_t get_total() const { return total.load(std::memory_order_relaxed); }
+	uint64_t get_max() const { return max.load(std::memory_order_relaxed); }
+// Returns the highest value equivalent to the bucket holding the given fraction (0..1) of recorded values.
+	uint64_t percentile(double fraction) const;
+	void reset();
+
+private:
+	std::atomic<uint64_t> buckets[bucket_count] = {};
+	std::atomic<uint64_t> count{ 0 };
+	std::atomic<uint64_t> total{ 0 };
+	std::atomic<uint64_t> max{ 0 };
+
+	static uint32_t index_of(uint64_t value);
+	static uint64_t highest_of(uint32_t index);
+};
@@ -0,0 +1,60 @@
+// Lock-free intrusive multi-producer / single-consumer queue (Vyukov style).
+// Producers never block: a push is one atomic exchange plus one store.
+// Only a single consumer thread may call pop().
+// Node types must expose a `std::atomic<T*> next` member and be default constructible (used for the stub node).
+#pragma once
+#include <atomic>
+
+template <typename T>
+class MessageQueue {
+private:
+	alignas(64) std::atomic<T*> head; // Written by producers.
+	alignas(64) T* tail;              // Owned by the consumer.
+	T stub;
+
+public:
+	MessageQueue() : head(&stub), tail(&stub) {
+		stub.next.store(nullptr, std::memory_order_relaxed);
+	}
+	MessageQueue(const MessageQueue&) = delete;
+	MessageQueue& operator=(const MessageQueue&) = delete;
+
+	void push(T* node) {
+		push_chain(node, node);
+	}
+
+// Pushes an already linked chain first..last in one step, so its nodes stay contiguous and in order.
+	void push_chain(T* first, T* last) {
+		last->next.store(nullptr, std::memory_order_relaxed);
+		T* prev = head.exchange(last, std::memory_order_acq_rel);
+		prev->next.store(first, std::memory_order_release);
+	}
+
+// Returns nullptr when the queue is empty, or when a producer is half way through a push.
+	T* pop() {
+		T* current = tail;
+		T* next = current->next.load(std::memory_order_acquire);
+		if (current == &stub) {
+			if (next == nullptr) {
+				return nullptr;
+			}
+			tail = next;
+			current = next;
+			next = next->next.load(std::memory_order_acquire);
+		}
+		if (next != nullptr) {
+			tail = next;
+			return current;
+		}
+		if (current != head.load(std::memory_order_acquire)) {
+			return nullptr;
+		}
+		push(&stub);
+		next = current->next.load(std::memory_order_acquire);
+		if (next != nullptr) {
+			tail = next;
+			return current;
+		}
+		return nullptr;
+	}
+};
@@ -0,0 +1,184 @@
+#include "OutputWorker.h"
+
+OutputWorker::~OutputWorker() {
+	stop(false);
+}
+
+void OutputWorker::start(deliver_fn _deliver) {
+	std::lock_guard<std::mutex> guard(control_mutex);
+	if (running.load(std::memory_order_acquire)) {
+		return;
+	}
+	deliver = std::move(_deliver);
+	draining.store(false, std::memory_order_relaxed);
+	running.store(true, std::memory_order_release);
+	thread = std::thread(&OutputWorker::run, this);
+}
+
+void OutputWorker::stop(bool drain) {
+	std::lock_guard<std::mutex> guard(control_mutex);
+	if (!thread.joinable()) {
+		return;
+	}
+	draining.store(drain, std::memory_order_relaxed);
+	running.store(false, std::memory_order_seq_cst);
+	// A producer that saw the worker running may still be pushing. Once it is done its message is queued,
+	// so a drain delivers it and discard_all below deletes it otherwise; later pushes see running cleared.
+	while (pushing.load(std::memory_order_seq_cst) != 0) {
+		std::this_thread::yield();
+	}
+	wake();
+	thread.join();
+	discard_all();
+}
+
+bool OutputWorker::push(speech_message* message) {
+	return push_chain(message, message);
+}
+
+bool OutputWorker::push_chain(speech_message* first, speech_message* last) {
+	pushing.fetch_add(1, std::memory_order_seq_cst);
+	if (!running.load(std::memory_order_seq_cst)) {
+		pushing.fetch_sub(1, std::memory_order_release);
+		return false;
+	}
+	uint64_t epoch = cancel_epoch.load(std::memory_order_relaxed);
+	auto now = std::chrono::steady_clock::now();
+	for (speech_message* message = first; message != last; message = message->next.load(std::memory_order_relaxed)) {
+		message->epoch = epoch;
+		message->queued = now;
+	}
+	last->epoch = epoch;
+	last->queued = now;
+	queue.push_chain(first, last);
+	// Pairs with the fence in run(): either the worker sees this message or we see it sleeping.
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	if (sleeping.load(std::memory_order_relaxed)) {
+		wake();
+	}
+	pushing.fetch_sub(1, std::memory_order_release);
+	return true;
+}
+
+void OutputWorker::cancel_pending() {
+	cancel_epoch.fetch_add(1, std::memory_order_relaxed);
+}
+
+void OutputWorker::set_coalesce_window(uint32_t window_ms) {
+	coalescer.set_window(window_ms);
+	if (is_running()) {
+		wake();
+	}
+}
+
+void OutputWorker::wake() {
+	{
+		std::lock_guard<std::mutex> lock(wake_mutex);
+		wake_pending = true;
+	}
+	wake_condition.notify_one();
+}
+
+// Throws away held and pending speech once a cancel has happened.
+void OutputWorker::sync_epoch() {
+	uint64_t epoch = cancel_epoch.load(std::memory_order_relaxed);
+	if (epoch != seen_epoch) {
+		coalescer.discard();
+		scheduler.discard();
+		seen_epoch = epoch;
+	}
+}
+
+// Releases the held message once the window changed, it would otherwise wait for a deadline that no longer applies
+// while messages added under the new window overtake it.
+void OutputWorker::sync_window() {
+	if (coalescer.window_changed()) {
+		schedule(coalescer.take());
+	}
+}
+
+// Drops the message if a cancel happened since it was queued, otherwise passes it on to the coalescer or scheduler.
+void OutputWorker::process(speech_message* message) {
+	sync_epoch();
+	sync_window();
+	if (message->epoch != seen_epoch) {
+		delete message;
+	}
+	else if (coalescer.enabled()) {
+		schedule(coalescer.add(message));
+	}
+	else {
+		schedule(message);
+	}
+}
+
+void OutputWorker::schedule(speech_message* message) {
+	if (message != nullptr) {
+		scheduler.add(message);
+	}
+}
+
+void OutputWorker::deliver_next(speech_message* message) {
+	if (message->epoch == cancel_epoch.load(std::memory_order_relaxed)) {
+		scheduler.record_delivery(*message);
+		deliver(*message);
+	}
+	delete message;
+}
+
+void OutputWorker::run() {
+	for (;;) {
+		if (!running.load(std::memory_order_acquire) && !draining.load(std::memory_order_relaxed)) {
+			coalescer.discard();
+			scheduler.discard();
+			return;
+		}
+		// Move everything queued so far into the scheduler first, so a higher class can overtake pending speech.
+		while (speech_message* message = queue.pop()) {
+			process(message);
+		}
+		sync_epoch();
+		sync_window();
+		if (coalescer.holding() && (Coalescer::clock::now() >= coalescer.deadline() || !running.load(std::memory_order_acquire))) {
+			schedule(coalescer.take());
+		}
+		if (speech_message* message = scheduler.next()) {
+			deliver_next(message);
+			continue;
+		}
+		if (!running.load(std::memory_order_acquire)) {
+			// Draining: a producer may still have been half way through a push on the previous pop.
+			if (speech_message* message = queue.pop()) {
+				process(message);
+				continue;
+			}
+			return;
+		}
+
+		std::unique_lock<std::mutex> lock(wake_mutex);
+		sleeping.store(true, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		speech_message* message = queue.pop();
+		if (message == nullptr) {
+			if (coalescer.holding()) {
+				wake_condition.wait_until(lock, coalescer.deadline(), [this] { return wake_pending; });
+			}
+			else {
+				wake_condition.wait(lock, [this] { return wake_pending; });
+			}
+		}
+		wake_pending = false;
+		sleeping.store(false, std::memory_order_relaxed);
+		lock.unlock();
+
+		if (message != nullptr) {
+			process(message);
+		}
+	}
+}
+
+void OutputWorker::discard_all() {
+	while (speech_message* message = queue.pop()) {
+		delete message;
+	}
+}
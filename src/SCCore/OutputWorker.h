@@ -0,0 +1,66 @@
+// Background dispatcher used by the asynchronous output mode.
+// Callers push messages through a lock-free queue and return immediately,
+// a single worker thread drains the queue into the coalescer and scheduler and hands messages to the deliver callback.
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include "Coalescer.h"
+#include "MessageQueue.h"
+#include "Scheduler.h"
+#include "SpeechMessage.h"
+
+class OutputWorker {
+public:
+	using deliver_fn = std::function<void(speech_message&)>;
+
+	OutputWorker() = default;
+	~OutputWorker();
+
+	void start(deliver_fn deliver);
+// Stops the worker thread. Pending messages are delivered first when drain is true, discarded otherwise.
+	void stop(bool drain);
+	bool is_running() const { return running.load(std::memory_order_acquire); }
+
+// Takes ownership of the message and returns true, or returns false once the worker stopped: the caller still owns
+// the message then and speaks it synchronously. A push that got in before stop() is delivered or discarded by it.
+	bool push(speech_message* message);
+// Queues an already linked chain first..last as one unit, preserving its order. Same ownership rules as push.
+	bool push_chain(speech_message* first, speech_message* last);
+// Drops every message queued before this call. Does not touch speech already handed to the driver.
+	void cancel_pending();
+// Sets the coalesce window. A message held under the old window is released right away, so nothing overtakes it.
+	void set_coalesce_window(uint32_t window_ms);
+	Coalescer& coalescing() { return coalescer; }
+	Scheduler& scheduling() { return scheduler; }
+
+private:
+	MessageQueue<speech_message> queue;
+	Coalescer coalescer;
+	Scheduler scheduler;
+	deliver_fn deliver;
+	std::thread thread;
+	std::atomic<bool> running{ false };
+	std::atomic<bool> draining{ false };
+	std::atomic<bool> sleeping{ false };
+	std::atomic<uint32_t> pushing{ 0 }; // Pushes past their check of running, stop() waits for them.
+	std::atomic<uint64_t> cancel_epoch{ 0 };
+	std::mutex control_mutex; // Serializes start and stop, so two starts never both assign the thread.
+	std::mutex wake_mutex;
+	std::condition_variable wake_condition;
+	bool wake_pending = false;
+
+	uint64_t seen_epoch = 0;
+
+	void wake();
+	void run();
+	void sync_epoch();
+	void sync_window();
+	void process(speech_message* message);
+	void schedule(speech_message* message);
+	void deliver_next(speech_message* message);
+	void discard_all();
+};
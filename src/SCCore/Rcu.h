@@ -0,0 +1,73 @@
+// Minimal read-copy-update domain.
+// Readers only touch two atomic counters, never a lock. Writers publish a new pointer,
+// call synchronize() to wait for every reader that could still see the old one, then reclaim it.
+// A read section may last as long as a driver call, so the writer sleeps until the last old reader leaves and wakes it.
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+
+class Rcu {
+private:
+	std::atomic<uint64_t> epoch{ 0 };
+	std::atomic<int64_t> readers[2] = { 0, 0 };
+	std::mutex writer_mutex;
+	std::atomic<bool> writer_waiting{ false };
+	std::mutex wait_mutex;
+	std::condition_variable readers_left;
+
+// Only the reader leaving last while a writer waits takes the lock, to wake it.
+	void leave(uint64_t reader_epoch) {
+		if (readers[reader_epoch & 1].fetch_sub(1, std::memory_order_seq_cst) == 1 && writer_waiting.load(std::memory_order_seq_cst)) {
+			{
+				std::lock_guard<std::mutex> lock(wait_mutex);
+			}
+			readers_left.notify_all();
+		}
+	}
+
+public:
+	uint64_t read_lock() {
+		for (;;) {
+			uint64_t current = epoch.load(std::memory_order_seq_cst);
+			readers[current & 1].fetch_add(1, std::memory_order_seq_cst);
+			// Re-check so a writer that flipped the epoch in between cannot miss us.
+			if (epoch.load(std::memory_order_seq_cst) == current) {
+				return current;
+			}
+			leave(current);
+		}
+	}
+
+	void read_unlock(uint64_t reader_epoch) {
+		leave(reader_epoch);
+	}
+
+// Returns once every reader that entered before the call has left.
+	void synchronize() {
+		std::lock_guard<std::mutex> lock(writer_mutex);
+		uint64_t previous = epoch.fetch_add(1, std::memory_order_seq_cst);
+		std::atomic<int64_t>& old_readers = readers[previous & 1];
+		if (old_readers.load(std::memory_order_acquire) == 0) {
+			return;
+		}
+		std::unique_lock<std::mutex> wait_lock(wait_mutex);
+		// Either the last reader sees the flag and wakes us, or we see the count it left behind.
+		writer_waiting.store(true, std::memory_order_seq_cst);
+		readers_left.wait(wait_lock, [&] { return old_readers.load(std::memory_order_seq_cst) == 0; });
+		writer_waiting.store(false, std::memory_order_relaxed);
+	}
+
+	class read_guard {
+	private:
+		Rcu& domain;
+		uint64_t reader_epoch;
+
+	public:
+		explicit read_guard(Rcu& _domain) : domain(_domain), reader_epoch(_domain.read_lock()) {}
+		~read_guard() { domain.read_unlock(reader_epoch); }
+		read_guard(const read_guard&) = delete;
+		read_guard& operator=(const read_guard&) = delete;
+	};
+};
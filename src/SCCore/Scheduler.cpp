@@ -0,0 +1,70 @@
+#include "Scheduler.h"
+
+Scheduler::~Scheduler() {
+	discard();
+}
+
+void Scheduler::add(speech_message* message) {
+	uint32_t priority = message->priority;
+	for (uint32_t lower = priority + 1; lower <= SC_PRIORITY_PROGRESS; lower++) {
+		if (lower >= SC_PRIORITY_NORMAL) {
+			drop(lower);
+		}
+	}
+	if (priority == SC_PRIORITY_PROGRESS) {
+		drop(priority); // Only the latest progress report is worth speaking.
+	}
+	pending[priority - 1].push_back(message);
+}
+
+speech_message* Scheduler::next() {
+	for (auto& queue : pending) {
+		if (!queue.empty()) {
+			speech_message* message = queue.front();
+			queue.pop_front();
+			return message;
+		}
+	}
+	return nullptr;
+}
+
+void Scheduler::discard() {
+	for (auto& queue : pending) {
+		for (speech_message* message : queue) {
+			delete message;
+		}
+		queue.clear();
+	}
+}
+
+void Scheduler::drop(uint32_t priority) {
+	auto& queue = pending[priority - 1];
+	if (queue.empty()) {
+		return;
+	}
+	counters[priority - 1].preempted.fetch_add(queue.size(), std::memory_order_relaxed);
+	for (speech_message* message : queue) {
+		delete message;
+	}
+	queue.clear();
+}
+
+void Scheduler::record_delivery(const speech_message& message) {
+	auto latency = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - message.queued);
+	uint64_t latency_us = static_cast<uint64_t>(latency.count());
+	class_stats& counter = counters[message.priority - 1];
+	counter.delivered.fetch_add(1, std::memory_order_relaxed);
+	counter.total_latency_us.fetch_add(latency_us, std::memory_order_relaxed);
+	uint64_t max = counter.max_latency_us.load(std::memory_order_relaxed);
+	while (latency_us > max && !counter.max_latency_us.compare_exchange_weak(max, latency_us, std::memory_order_relaxed)) {
+	}
+}
+
+void Scheduler::reset_stats() {
+	for (auto& counter : counters) {
+		counter.delivered.store(0, std::memory_order_relaxed);
+		counter.preempted.store(0, std::memory_order_relaxed);
+		counter.total_latency_us.store(0, std::memory_order_relaxed);
+		counter.max_latency_us.store(0, std::memory_order_relaxed);
+	}
+}
@@ -0,0 +1,44 @@
+// Priority scheduler used by the output worker.
+// Pending messages wait in one FIFO per SC_PRIORITY_* class and the highest class is always delivered first.
+// A new message preempts pending messages of lower normal, low and progress classes, the way speech-dispatcher does.
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include "SpeechMessage.h"
+
+class Scheduler {
+public:
+	static constexpr uint32_t class_count = SC_PRIORITY_PROGRESS;
+
+	struct class_stats {
+		std::atomic<uint64_t> delivered{ 0 };
+		std::atomic<uint64_t> preempted{ 0 };
+		std::atomic<uint64_t> total_latency_us{ 0 };
+		std::atomic<uint64_t> max_latency_us{ 0 };
+	};
+
+	Scheduler() = default;
+	~Scheduler();
+	Scheduler(const Scheduler&) = delete;
+	Scheduler& operator=(const Scheduler&) = delete;
+
+	static bool valid_priority(uint32_t priority) { return priority >= SC_PRIORITY_CRITICAL && priority <= SC_PRIORITY_PROGRESS; }
+
+// Takes ownership of the message.
+	void add(speech_message* message);
+// Returns the oldest message of the highest pending class, nullptr if nothing is pending. The caller takes ownership.
+	speech_message* next();
+	void discard();
+
+// Records the queueing latency of a message that is about to be handed to the driver.
+	void record_delivery(const speech_message& message);
+	const class_stats& stats(uint32_t priority) const { return counters[priority - 1]; }
+	void reset_stats();
+
+private:
+	std::deque<speech_message*> pending[class_count];
+	class_stats counters[class_count];
+
+	void drop(uint32_t priority);
+};
@@ -0,0 +1,244 @@
+#include "Segmenter.h"
+
+namespace {
+
+// What the text since the last cut candidate allows, weakest first.
+enum class boundary { none, clause, sentence_unless_lower, sentence };
+
+// Reads the code point at pos and returns the position after it. Malformed input reads as one unit.
+size_t decode(const wchar_t* text, size_t count, size_t pos, uint32_t& code_point) {
+	uint32_t unit = static_cast<uint32_t>(text[pos]);
+	if constexpr (sizeof(wchar_t) == 2) {
+		if (unit >= 0xD800 && unit <= 0xDBFF && pos + 1 < count) {
+			uint32_t low = static_cast<uint32_t>(text[pos + 1]);
+			if (low >= 0xDC00 && low <= 0xDFFF) {
+				code_point = 0x10000 + ((unit - 0xD800) << 10) + (low - 0xDC00);
+				return pos + 2;
+			}
+		}
+	}
+	code_point = unit;
+	return pos + 1;
+}
+
+size_t decode(const char* text, size_t count, size_t pos, uint32_t& code_point) {
+	unsigned char lead = static_cast<unsigned char>(text[pos]);
+	size_t length = (lead < 0x80) ? 1 : ((lead >> 5) == 0x06) ? 2 : ((lead >> 4) == 0x0E) ? 3 : ((lead >> 3) == 0x1E) ? 4 : 0;
+	code_point = 0xFFFD;
+	if (length == 0 || pos + length > count) {
+		return pos + 1;
+	}
+	uint32_t value = (length == 1) ? lead : (lead & (0x7F >> length));
+	for (size_t i = 1; i < length; i++) {
+		unsigned char unit = static_cast<unsigned char>(text[pos + i]);
+		if ((unit & 0xC0) != 0x80) {
+			return pos + 1;
+		}
+		value = (value << 6) | (unit & 0x3F);
+	}
+	code_point = value;
+	return pos + length;
+}
+
+bool is_space(uint32_t c) {
+	return c == ' ' || c == '\t' || c == '\r' || c == 0xA0 || c == 0x3000 || (c >= 0x2000 && c <= 0x200A);
+}
+
+bool is_line_break(uint32_t c) {
+	return c == '\n' || c == 0x2028 || c == 0x2029;
+}
+
+// Ends a sentence when whitespace follows: Latin, Arabic and Devanagari full stops and question marks.
+bool is_terminal(uint32_t c) {
+	return c == '.' || c == '!' || c == '?' || c == 0x2026 || c == 0x061F || c == 0x06D4 || c == 0x0964 || c == 0x0965;
+}
+
+// Ends a sentence on its own, CJK text has no spaces after it.
+bool is_cjk_terminal(uint32_t c) {
+	return c == 0x3002 || c == 0xFF01 || c == 0xFF0E || c == 0xFF1F || c == 0xFF61;
+}
+
+bool is_clause_mark(uint32_t c) {
+	return c == ',' || c == ';' || c == ':' || c == 0x060C || c == 0x061B;
+}
+
+bool is_cjk_clause_mark(uint32_t c) {
+	return c == 0x3001 || c == 0xFF0C || c == 0xFF1A || c == 0xFF1B || c == 0xFF64;
+}
+
+// Quotes and brackets closing a sentence belong to it.
+bool is_closer(uint32_t c) {
+	return c == '"' || c == '\'' || c == ')' || c == ']' || c == '}' || c == 0xBB || c == 0x2019 || c == 0x201D
+		|| c == 0x300D || c == 0x300F || c == 0x3011 || c == 0xFF09;
+}
+
+// A lowercase letter after a full stop means an abbreviation like "e.g. this", not a new sentence.
+bool is_lower(uint32_t c) {
+	return (c >= 'a' && c <= 'z') || (c >= 0xDF && c <= 0xFF && c != 0xF7);
+}
+
+// Code points that continue the grapheme before them: combining marks, joiners, variation selectors, skin tones and tags.
+bool extends(uint32_t c) {
+	static const uint32_t ranges[][2] = {
+		{ 0x0300, 0x036F }, { 0x0483, 0x0489 }, { 0x0591, 0x05BD }, { 0x0610, 0x061A }, { 0x064B, 0x065F },
+		{ 0x0670, 0x0670 }, { 0x06D6, 0x06DC }, { 0x0900, 0x0903 }, { 0x093A, 0x094F }, { 0x0951, 0x0957 },
+		{ 0x0962, 0x0963 }, { 0x0E31, 0x0E31 }, { 0x0E34, 0x0E3A }, { 0x0E47, 0x0E4E }, { 0x1AB0, 0x1AFF },
+		{ 0x1DC0, 0x1DFF }, { 0x200C, 0x200D }, { 0x20D0, 0x20FF }, { 0x302A, 0x302F }, { 0x3099, 0x309A },
+		{ 0xFE00, 0xFE0F }, { 0xFE20, 0xFE2F }, { 0x1F3FB, 0x1F3FF }, { 0xE0020, 0xE007F }, { 0xE0100, 0xE01EF },
+	};
+	if (c < 0x0300) {
+		return false;
+	}
+	for (const auto& range : ranges) {
+		if (c < range[0]) {
+			return false;
+		}
+		if (c <= range[1]) {
+			return true;
+		}
+	}
+	return false;
+}
+
+bool is_regional_indicator(uint32_t c) {
+	return c >= 0x1F1E6 && c <= 0x1F1FF;
+}
+
+// Whether a cut between two code points leaves both graphemes whole.
+bool grapheme_break(uint32_t before, uint32_t after) {
+	return !extends(after) && before != 0x200D && !(is_regional_indicator(before) && is_regional_indicator(after));
+}
+
+// Last cut of every kind within the first limit code units, 0 where there is none.
+struct cuts {
+	size_t sentence = 0;
+	size_t clause = 0;
+	size_t word = 0;
+	size_t point = 0;
+	size_t end = 0; // Where the scan stopped.
+	uint32_t previous = 0; // The code point before end.
+};
+
+// One forward pass over the code points starting at or before limit.
+template<typename Unit>
+cuts scan(const Unit* text, size_t count, size_t limit) {
+	cuts found;
+	boundary pending = boundary::none;
+	bool after_terminal = false;
+	bool after_clause_mark = false;
+	bool spaced = false;
+	uint32_t previous = 0;
+	size_t pos = 0;
+	while (pos <= limit && pos < count) {
+		uint32_t c;
+		size_t next = decode(text, count, pos, c);
+		if (is_space(c) || is_line_break(c)) {
+			if (is_line_break(c)) {
+				pending = boundary::sentence;
+			}
+			else if (after_terminal && pending < boundary::sentence_unless_lower) {
+				pending = boundary::sentence_unless_lower;
+			}
+			else if (after_clause_mark && pending < boundary::clause) {
+				pending = boundary::clause;
+			}
+			after_terminal = after_clause_mark = false;
+			spaced = true;
+		}
+		else {
+			// A closer right after a CJK mark still belongs to the sentence it ends.
+			bool closes = !spaced && is_closer(c);
+			if (pos > 0) {
+				if (!closes && pending != boundary::none) {
+					if (pending == boundary::sentence || (pending == boundary::sentence_unless_lower && !is_lower(c))) {
+						found.sentence = pos;
+					}
+					else {
+						found.clause = pos;
+					}
+				}
+				if (spaced) {
+					found.word = pos;
+				}
+				if (grapheme_break(previous, c)) {
+					found.point = pos;
+				}
+			}
+			if (!closes) {
+				pending = boundary::none;
+			}
+			spaced = false;
+			if (is_cjk_terminal(c)) {
+				pending = boundary::sentence;
+			}
+			else if (is_cjk_clause_mark(c) && pending < boundary::clause) {
+				pending = boundary::clause;
+			}
+			if (!is_closer(c)) {
+				after_terminal = is_terminal(c);
+				after_clause_mark = is_clause_mark(c);
+			}
+		}
+		previous = c;
+		pos = next;
+	}
+	found.end = pos;
+	found.previous = previous;
+	return found;
+}
+
+template<typename Unit>
+size_t find_cut(const Unit* text, size_t count, size_t limit) {
+	if (count <= limit) {
+		return count;
+	}
+	cuts found = scan(text, count, limit);
+	size_t cut = found.sentence ? found.sentence : found.clause ? found.clause : found.word ? found.word : found.point;
+	// A single grapheme longer than the limit goes whole.
+	uint32_t previous = found.previous;
+	for (size_t pos = found.end; cut == 0 && pos < count;) {
+		uint32_t c;
+		size_t next = decode(text, count, pos, c);
+		if (grapheme_break(previous, c)) {
+			cut = pos;
+		}
+		previous = c;
+		pos = next;
+	}
+	return cut ? cut : count;
+}
+
+}
+
+size_t Segmenter::cut(const char* text, size_t count, size_t limit) {
+	return find_cut(text, count, limit);
+}
+
+size_t Segmenter::complete(const char* text, size_t count, size_t clause_min) {
+	cuts found = scan(text, count, count);
+	return (found.clause >= clause_min && found.clause > found.sentence) ? found.clause : found.sentence;
+}
+
+size_t Segmenter::next(const wchar_t* text, size_t count) const {
+	uint32_t units = get_limit();
+	return (units != 0) ? find_cut(text, count, units) : count;
+}
+
+size_t Segmenter::next(const char* text, size_t count) const {
+	uint32_t units = get_limit();
+	return (units != 0) ? cut(text, count, units) : count;
+}
+
+void Segmenter::count(size_t segments, bool cut_short) {
+	segmented.fetch_add(1, std::memory_order_relaxed);
+	segments_total.fetch_add(segments, std::memory_order_relaxed);
+	if (cut_short) {
+		interrupted.fetch_add(1, std::memory_order_relaxed);
+	}
+}
+
+void Segmenter::reset_counters() {
+	segmented.store(0, std::memory_order_relaxed);
+	segments_total.store(0, std::memory_order_relaxed);
+	interrupted.store(0, std::memory_order_relaxed);
+}
@@ -0,0 +1,57 @@
+// Segmentation stage in front of drivers whose engine synthesizes a whole request before any of it plays.
+// Text longer than the limit is cut into segments of at most that many code units, preferring sentence ends,
+// then clause marks, then whitespace, and only then any code point that does not start a grapheme continuation.
+// The first segment plays while the rest is still being synthesized, so time to first audio no longer grows with the text.
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+
+class Segmenter {
+public:
+	static constexpr uint32_t default_limit = 400; // About three sentences of English.
+
+	Segmenter() = default;
+	Segmenter(const Segmenter&) = delete;
+	Segmenter& operator=(const Segmenter&) = delete;
+
+	void set_limit(uint32_t units) { limit.store(units, std::memory_order_relaxed); }
+	uint32_t get_limit() const { return limit.load(std::memory_order_relaxed); }
+	bool enabled() const { return get_limit() != 0; }
+
+// Length in code units of the first segment of text, count if all of it fits within the limit.
+	size_t next(const wchar_t* text, size_t count) const;
+	size_t next(const char* text, size_t count) const;
+// Same cut for a given limit, for callers with a limit of their own.
+	static size_t cut(const char* text, size_t count, size_t limit);
+// Length of the text up to its last complete sentence, or up to its last clause if that is longer and at least
+// clause_min code units. 0 if there is none yet: a sentence is only complete once the next one began.
+	static size_t complete(const char* text, size_t count, size_t clause_min);
+
+// Interrupting output and stops advance the epoch. A segmented request gives up its remaining segments once it changed.
+// feed_lock() is held from checking the epoch until the segment reached the driver, and interrupt() waits for it
+// after advancing the epoch: a stop either comes first and the segment is not handed out, or finds it queued in the
+// driver, whose stop drops it.
+	uint64_t epoch() const { return interrupts.load(std::memory_order_acquire); }
+	void interrupt() {
+		interrupts.fetch_add(1, std::memory_order_acq_rel);
+		std::lock_guard<std::mutex> lock(feed);
+	}
+	std::mutex& feed_lock() { return feed; }
+
+// Counts one request that went in segments, and whether an interrupt kept its remaining segments from the driver.
+	void count(size_t segments, bool cut_short);
+	uint64_t segmented_count() const { return segmented.load(std::memory_order_relaxed); }
+	uint64_t segment_count() const { return segments_total.load(std::memory_order_relaxed); }
+	uint64_t interrupted_count() const { return interrupted.load(std::memory_order_relaxed); }
+	void reset_counters();
+
+private:
+	std::atomic<uint32_t> limit{ default_limit };
+	std::atomic<uint64_t> interrupts{ 0 };
+	std::mutex feed;
+	std::atomic<uint64_t> segmented{ 0 };
+	std::atomic<uint64_t> segments_total{ 0 };
+	std::atomic<uint64_t> interrupted{ 0 };
+};
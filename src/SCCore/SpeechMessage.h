@@ -0,0 +1,84 @@
+// Message queued by the asynchronous output path.
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "Utterances.h"
+#include "../../include/SpeechCore.h"
+#include "../SCDrivers/SCDriver.h"
+
+struct speech_message {
+	std::atomic<speech_message*> next{ nullptr };
+	std::wstring text;
+	std::string utf8; // Set instead of text when the message came as UTF-8, it is converted only if the driver needs it.
+	uint32_t priority = SC_PRIORITY_NORMAL;
+	uint64_t epoch = 0; // Value of the cancel epoch when the message was queued.
+	uint64_t utterance = 0; // Utterance id, 0 unless tracing is on or the caller asked for a handle.
+	std::vector<uint64_t> merged; // Utterances the coalescer merged into this one, they share its outcome.
+	std::chrono::steady_clock::time_point queued;
+
+	speech_message() = default;
+	speech_message(const wchar_t* _text, uint32_t _priority) : text(_text), priority(_priority) {}
+	speech_message(const speech_request& request) : priority(request.priority) {
+		if (request.utf8) {
+			utf8.assign(request.utf8, request.count());
+		}
+		else {
+			text.assign(request.text, request.count());
+		}
+	}
+// A message deleted before reaching a driver was dropped (cancelled, preempted or superseded).
+	~speech_message() {
+		utterances.dropped(utterance, SC_UTTERANCE_CANCELLED);
+		for (uint64_t id : merged) {
+			utterances.dropped(id, SC_UTTERANCE_CANCELLED);
+		}
+	}
+
+	speech_request request() const {
+		if (!utf8.empty()) {
+			return { nullptr, priority, utf8.size(), utf8.c_str() };
+		}
+		return { text.c_str(), priority, text.size() };
+	}
+// Appends another message and takes over its utterances, which are then spoken with this one.
+	void merge(speech_message& other) {
+		append(other);
+		if (other.utterance != 0) {
+			merged.push_back(other.utterance);
+			other.utterance = 0;
+		}
+		merged.insert(merged.end(), other.merged.begin(), other.merged.end());
+		other.merged.clear();
+	}
+// Completes the merged utterances once this message was handed to the driver, with the outcome it had.
+	void settle_merged(bool spoken) {
+		uint32_t state = spoken ? SC_UTTERANCE_DONE
+			: (utterances.state(utterance) == SC_UTTERANCE_CANCELLED) ? SC_UTTERANCE_CANCELLED : SC_UTTERANCE_FAILED;
+		for (uint64_t id : merged) {
+			utterances.settle_merged(id, state);
+		}
+		merged.clear();
+	}
+// Appends another message after a space. Mixed forms end up as wchar_t.
+	void append(const speech_message& other) {
+		if (!utf8.empty() && !other.utf8.empty()) {
+			utf8 += ' ';
+			utf8 += other.utf8;
+			return;
+		}
+		if (!utf8.empty()) {
+			text = transcode::wide_string(utf8.data(), utf8.size());
+			utf8.clear();
+		}
+		text.append(L" ");
+		if (!other.utf8.empty()) {
+			text.append(transcode::to_wide(other.utf8.data(), other.utf8.size(), nullptr));
+		}
+		else {
+			text.append(other.text);
+		}
+	}
+};
@@ -0,0 +1,82 @@
+#include "StartupBuffer.h"
+
+StartupBuffer::~StartupBuffer() {
+	clear();
+}
+
+void StartupBuffer::open(size_t _capacity) {
+	std::lock_guard<std::mutex> lock(mutex);
+	clear();
+	capacity = (_capacity > 0) ? _capacity : 1;
+	dropped.store(0, std::memory_order_relaxed);
+	opened.store(true, std::memory_order_release);
+}
+
+void StartupBuffer::close(release_fn release) {
+	std::unique_lock<std::mutex> lock(mutex);
+	// Released without the lock: a synchronous release reaches the driver, whose completion callbacks may queue more
+	// output. The buffer stays open meanwhile, so that output is held behind this batch and released in the next one.
+	while (!held.empty()) {
+		std::deque<speech_message*> batch;
+		batch.swap(held);
+		uint64_t discards = discarded;
+		lock.unlock();
+		for (speech_message* message : batch) {
+			if (release && !discarded_since(discards)) {
+				release(message);
+			}
+			else {
+				delete message; // Closed without release, or Speech_Stop came in while draining.
+			}
+		}
+		lock.lock();
+	}
+	// Only now: output that still sees the buffer open waits for the lock and then goes on behind the held speech.
+	opened.store(false, std::memory_order_release);
+}
+
+bool StartupBuffer::add_chain(speech_message* first, speech_message* last) {
+	std::lock_guard<std::mutex> lock(mutex);
+	if (!opened.load(std::memory_order_relaxed)) {
+		return false;
+	}
+	for (speech_message* message = first; ; ) {
+		// Read the link first, the message is owned by the buffer once pushed.
+		speech_message* next = (message != last) ? message->next.load(std::memory_order_relaxed) : nullptr;
+		message->next.store(nullptr, std::memory_order_relaxed);
+		if (message->priority == SC_PRIORITY_CRITICAL) {
+			dropped.fetch_add(held.size(), std::memory_order_relaxed);
+			clear();
+		}
+		else if (held.size() >= capacity) {
+			delete held.front();
+			held.pop_front();
+			dropped.fetch_add(1, std::memory_order_relaxed);
+		}
+		held.push_back(message);
+		if (next == nullptr) {
+			break;
+		}
+		message = next;
+	}
+	return true;
+}
+
+void StartupBuffer::discard() {
+	std::lock_guard<std::mutex> lock(mutex);
+	clear();
+	discarded++;
+}
+
+bool StartupBuffer::discarded_since(uint64_t discards) {
+	std::lock_guard<std::mutex> lock(mutex);
+	return discarded != discards;
+}
+
+// Requires the lock.
+void StartupBuffer::clear() {
+	for (speech_message* message : held) {
+		delete message;
+	}
+	held.clear();
+}
@@ -0,0 +1,44 @@
+// Holds output requested while Speech_Init_Async is still looking for a driver, so early speech is not lost.
+// Bounded: once full the oldest message is dropped, and a critical message drops everything held before it,
+// as it would have interrupted that speech anyway.
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include "SpeechMessage.h"
+
+class StartupBuffer {
+public:
+	using release_fn = std::function<void(speech_message*)>;
+
+	StartupBuffer() = default;
+	~StartupBuffer();
+	StartupBuffer(const StartupBuffer&) = delete;
+	StartupBuffer& operator=(const StartupBuffer&) = delete;
+
+	void open(size_t capacity);
+// Hands every held message to release in order, then closes. Output racing with the close is held behind the
+// released speech and handed over too, so nothing overtakes it. release is called without the lock held.
+	void close(release_fn release);
+	bool is_open() const { return opened.load(std::memory_order_acquire); }
+
+// Takes ownership of the linked chain first..last and returns true, or returns false when the buffer is closed.
+	bool add_chain(speech_message* first, speech_message* last);
+	bool add(speech_message* message) { return add_chain(message, message); }
+// Drops every held message, used by Speech_Stop. A close in progress drops the rest of its batch as well.
+	void discard();
+	uint64_t dropped_count() const { return dropped.load(std::memory_order_relaxed); }
+
+private:
+	std::mutex mutex;
+	std::deque<speech_message*> held;
+	size_t capacity = 0;
+	std::atomic<bool> opened{ false };
+	std::atomic<uint64_t> dropped{ 0 };
+	uint64_t discarded = 0; // Calls to discard, so a close releasing without the lock notices them.
+
+	void clear();
+	bool discarded_since(uint64_t discards);
+};
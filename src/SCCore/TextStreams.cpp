@@ -0,0 +1,211 @@
+#include "TextStreams.h"
+#include <vector>
+#include "Segmenter.h"
+
+namespace {
+
+// Length of the text without a UTF-8 sequence cut off at its end, the next fragment completes it.
+size_t complete_utf8(const std::string& text) {
+	size_t count = text.size();
+	size_t continuations = 0;
+	while (continuations < 3 && continuations < count && (static_cast<unsigned char>(text[count - 1 - continuations]) & 0xC0) == 0x80) {
+		continuations++;
+	}
+	if (continuations == count) {
+		return count;
+	}
+	unsigned char lead = static_cast<unsigned char>(text[count - 1 - continuations]);
+	size_t length = ((lead >> 5) == 0x06) ? 2 : ((lead >> 4) == 0x0E) ? 3 : ((lead >> 3) == 0x1E) ? 4 : 1;
+	return (length > continuations + 1) ? count - 1 - continuations : count;
+}
+
+bool blank(const char* text, size_t length) {
+	for (size_t i = 0; i < length; i++) {
+		if (text[i] != ' ' && text[i] != '\t' && text[i] != '\r' && text[i] != '\n') {
+			return false;
+		}
+	}
+	return true;
+}
+
+int64_t ticks(TextStreams::clock::time_point time) {
+	return static_cast<int64_t>(time.time_since_epoch().count());
+}
+
+}
+
+TextStreams::~TextStreams() {
+	stop();
+}
+
+void TextStreams::start(speak_fn _speak) {
+	std::lock_guard<std::mutex> guard(lock);
+	if (running) {
+		return;
+	}
+	speak = std::move(_speak);
+	running = true;
+	timer = std::thread(&TextStreams::run, this);
+}
+
+void TextStreams::stop() {
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		if (!running) {
+			return;
+		}
+		running = false;
+		streams.clear();
+	}
+	wake.notify_all();
+	timer.join();
+}
+
+uint64_t TextStreams::open(uint32_t priority) {
+	auto created = std::make_shared<stream>();
+	created->priority = priority;
+	created->epoch = discard_epoch.load(std::memory_order_relaxed);
+	std::lock_guard<std::mutex> guard(lock);
+	if (!running) {
+		return 0;
+	}
+	uint64_t id = ++last_id;
+	streams.emplace(id, std::move(created));
+	return id;
+}
+
+bool TextStreams::append(uint64_t id, const char* text, size_t length) {
+	std::shared_ptr<stream> target = find(id);
+	if (!target) {
+		return false;
+	}
+	std::lock_guard<std::mutex> guard(target->lock);
+	sync_epoch(*target);
+	target->pending.append(text, length);
+	size_t cut = Segmenter::complete(target->pending.data(), target->pending.size(), clause_min);
+	if (cut == 0 && target->pending.size() >= buffer_limit) {
+		cut = Segmenter::cut(target->pending.data(), complete_utf8(target->pending), buffer_limit);
+	}
+	emit(*target, cut);
+	arm(*target);
+	return true;
+}
+
+bool TextStreams::flush(uint64_t id) {
+	std::shared_ptr<stream> target = find(id);
+	if (!target) {
+		return false;
+	}
+	std::lock_guard<std::mutex> guard(target->lock);
+	sync_epoch(*target);
+	emit(*target, complete_utf8(target->pending));
+	arm(*target);
+	return true;
+}
+
+bool TextStreams::close(uint64_t id) {
+	std::shared_ptr<stream> target;
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		auto it = streams.find(id);
+		if (it == streams.end()) {
+			return false;
+		}
+		target = std::move(it->second);
+		streams.erase(it);
+	}
+	std::lock_guard<std::mutex> guard(target->lock);
+	sync_epoch(*target);
+	emit(*target, complete_utf8(target->pending));
+	return true;
+}
+
+void TextStreams::set_idle_timeout(uint32_t timeout_ms) {
+	idle_timeout_ms.store(timeout_ms, std::memory_order_relaxed);
+	std::lock_guard<std::mutex> guard(lock);
+	wake.notify_one();
+}
+
+std::shared_ptr<TextStreams::stream> TextStreams::find(uint64_t id) {
+	std::lock_guard<std::mutex> guard(lock);
+	auto it = streams.find(id);
+	return (it != streams.end()) ? it->second : nullptr;
+}
+
+void TextStreams::sync_epoch(stream& target) {
+	uint64_t epoch = discard_epoch.load(std::memory_order_relaxed);
+	if (target.epoch != epoch) {
+		target.epoch = epoch;
+		target.pending.clear();
+	}
+}
+
+void TextStreams::emit(stream& target, size_t length) {
+	if (length == 0) {
+		return;
+	}
+	if (!blank(target.pending.data(), length)) {
+		speak({ nullptr, target.priority, length, target.pending.data(), length == target.pending.size() });
+		// Only the first piece interrupts or jumps ahead, the rest follows it like the segments of one text.
+		target.priority = SC_PRIORITY_NORMAL;
+	}
+	target.pending.erase(0, length);
+}
+
+void TextStreams::arm(stream& target) {
+	uint32_t timeout = get_idle_timeout();
+	if (target.pending.empty() || timeout == 0) {
+		target.deadline.store(0, std::memory_order_relaxed);
+		return;
+	}
+	int64_t deadline = ticks(clock::now() + std::chrono::milliseconds(timeout));
+	// A later deadline for a stream that had one already never wakes the timer earlier.
+	if (target.deadline.exchange(deadline, std::memory_order_relaxed) == 0) {
+		std::lock_guard<std::mutex> guard(lock);
+		wake.notify_one();
+	}
+}
+
+void TextStreams::run() {
+	std::unique_lock<std::mutex> guard(lock);
+	std::vector<std::shared_ptr<stream>> idle;
+	while (running) {
+		int64_t now = ticks(clock::now());
+		int64_t nearest = 0;
+		for (const auto& entry : streams) {
+			int64_t deadline = entry.second->deadline.load(std::memory_order_relaxed);
+			if (deadline == 0) {
+				continue;
+			}
+			if (deadline <= now) {
+				idle.push_back(entry.second);
+			}
+			else if (nearest == 0 || deadline < nearest) {
+				nearest = deadline;
+			}
+		}
+		if (!idle.empty()) {
+			// Speaking can block on the driver, streams are opened, appended to and closed meanwhile.
+			guard.unlock();
+			for (const auto& target : idle) {
+				std::lock_guard<std::mutex> stream_guard(target->lock);
+				int64_t deadline = target->deadline.load(std::memory_order_relaxed);
+				if (deadline == 0 || deadline > ticks(clock::now())) {
+					continue; // Appended to meanwhile.
+				}
+				target->deadline.store(0, std::memory_order_relaxed);
+				sync_epoch(*target);
+				emit(*target, complete_utf8(target->pending));
+			}
+			idle.clear();
+			guard.lock();
+			continue;
+		}
+		if (nearest == 0) {
+			wake.wait(guard);
+		}
+		else {
+			wake.wait_until(guard, clock::time_point(clock::duration(nearest)));
+		}
+	}
+}
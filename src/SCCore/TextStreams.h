@@ -0,0 +1,76 @@
+// Text streams for producers that write a few characters at a time, like language models or chat logs.
+// Fragments are buffered per stream as UTF-8 and handed to the speak callback as soon as a sentence is complete,
+// or a clause once enough text built up, so speech neither waits for the whole text nor stutters over every fragment.
+// What is left goes out once the stream was idle for the timeout, or when it is flushed or closed.
+// A single timer thread, started with the first stream, handles the idle timeouts of all streams.
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include "../SCDrivers/SCDriver.h"
+
+class TextStreams {
+public:
+	using clock = std::chrono::steady_clock;
+	using speak_fn = std::function<void(const speech_request&)>;
+
+	static constexpr uint32_t default_idle_timeout_ms = 300;
+	static constexpr size_t clause_min = 60; // Bytes a clause needs before it goes out on its own.
+	static constexpr size_t buffer_limit = 400; // Text without any boundary goes out at a word once it is this long.
+
+	TextStreams() = default;
+	~TextStreams();
+	TextStreams(const TextStreams&) = delete;
+	TextStreams& operator=(const TextStreams&) = delete;
+
+// Starts the timer thread. Does nothing if it is running already.
+	void start(speak_fn speak);
+// Stops the timer thread and closes every stream without speaking what they still hold.
+	void stop();
+
+// Returns the id of a new stream. Its first piece of text is spoken with priority, the rest queues behind it as normal speech.
+	uint64_t open(uint32_t priority);
+	bool append(uint64_t id, const char* text, size_t length);
+// Speaks everything the stream holds now.
+	bool flush(uint64_t id);
+// Flushes the stream and forgets it.
+	bool close(uint64_t id);
+// Drops the text every stream holds. The streams stay open. Never waits for a stream that is speaking.
+	void discard() { discard_epoch.fetch_add(1, std::memory_order_relaxed); }
+
+	void set_idle_timeout(uint32_t timeout_ms);
+	uint32_t get_idle_timeout() const { return idle_timeout_ms.load(std::memory_order_relaxed); }
+
+private:
+	struct stream {
+		std::mutex lock; // Held while speaking, so the pieces of a stream go out in order.
+		std::string pending;
+		uint32_t priority;
+		uint64_t epoch; // Value of the discard epoch the pending text belongs to.
+		std::atomic<int64_t> deadline{ 0 }; // Idle deadline in clock ticks, 0 while nothing is pending.
+	};
+
+	std::mutex lock;
+	std::condition_variable wake;
+	std::unordered_map<uint64_t, std::shared_ptr<stream>> streams;
+	uint64_t last_id = 0;
+	speak_fn speak;
+	std::thread timer;
+	bool running = false;
+	std::atomic<uint32_t> idle_timeout_ms{ default_idle_timeout_ms };
+	std::atomic<uint64_t> discard_epoch{ 0 };
+
+	std::shared_ptr<stream> find(uint64_t id);
+// These require the stream lock.
+	void sync_epoch(stream& target);
+	void emit(stream& target, size_t length);
+	void arm(stream& target);
+	void run();
+};
@@ -0,0 +1,173 @@
+#include "Tracer.h"
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+// Fixed size ring of events. Each slot is a small seqlock, so writers never wait and a reader
+// dumping the ring simply skips slots that are being overwritten.
+struct Tracer::trace_ring {
+	struct slot {
+		std::atomic<uint64_t> sequence{ 0 };
+		std::atomic<uint32_t> type{ 0 };
+		std::atomic<uint32_t> thread{ 0 };
+		std::atomic<uint64_t> timestamp_ns{ 0 };
+		std::atomic<uint64_t> utterance{ 0 };
+		std::atomic<const wchar_t*> driver{ nullptr };
+	};
+
+	size_t capacity;
+	std::unique_ptr<slot[]> slots;
+	std::atomic<uint64_t> head{ 0 };
+
+	explicit trace_ring(size_t _capacity) : capacity(_capacity), slots(new slot[_capacity]) {}
+
+	void write(const sc_trace_event& event) {
+		uint64_t position = head.fetch_add(1, std::memory_order_relaxed);
+		slot& target = slots[position % capacity];
+		target.sequence.store(position * 2 + 1, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_release);
+		target.type.store(event.type, std::memory_order_relaxed);
+		target.thread.store(event.thread, std::memory_order_relaxed);
+		target.timestamp_ns.store(event.timestamp_ns, std::memory_order_relaxed);
+		target.utterance.store(event.utterance, std::memory_order_relaxed);
+		target.driver.store(event.driver, std::memory_order_relaxed);
+		target.sequence.store(position * 2 + 2, std::memory_order_release);
+	}
+
+	bool read(uint64_t position, sc_trace_event& event) const {
+		const slot& source = slots[position % capacity];
+		uint64_t before = source.sequence.load(std::memory_order_acquire);
+		event.type = source.type.load(std::memory_order_relaxed);
+		event.thread = source.thread.load(std::memory_order_relaxed);
+		event.timestamp_ns = source.timestamp_ns.load(std::memory_order_relaxed);
+		event.utterance = source.utterance.load(std::memory_order_relaxed);
+		event.driver = source.driver.load(std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_acquire);
+		uint64_t after = source.sequence.load(std::memory_order_relaxed);
+		return before == position * 2 + 2 && after == before;
+	}
+};
+
+static thread_local uint64_t dispatching_utterance = 0;
+
+static uint32_t thread_number() {
+	static std::atomic<uint32_t> next_thread{ 0 };
+	static thread_local uint32_t number = next_thread.fetch_add(1, std::memory_order_relaxed) + 1;
+	return number;
+}
+
+Tracer::~Tracer() {
+	delete sink.load(std::memory_order_relaxed);
+	delete ring.load(std::memory_order_relaxed);
+}
+
+void Tracer::emit(uint32_t type, uint64_t utterance, const wchar_t* driver) {
+	if (!active()) {
+		return;
+	}
+	auto now = std::chrono::steady_clock::now().time_since_epoch();
+	sc_trace_event event{ type, thread_number(), static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(now).count()), utterance, driver };
+	Rcu::read_guard guard(rcu);
+	if (trace_sink* current = sink.load(std::memory_order_acquire)) {
+		current->callback(&event, current->userdata);
+	}
+	if (trace_ring* current = ring.load(std::memory_order_acquire)) {
+		current->write(event);
+	}
+}
+
+uint64_t Tracer::current_utterance() {
+	return dispatching_utterance;
+}
+
+void Tracer::set_callback(sc_trace_callback callback, void* userdata) {
+	std::lock_guard<std::mutex> lock(writer);
+	trace_sink* previous = sink.exchange(callback ? new trace_sink{ callback, userdata } : nullptr, std::memory_order_acq_rel);
+	update_enabled();
+	rcu.synchronize();
+	delete previous;
+}
+
+void Tracer::set_buffer(size_t capacity) {
+	std::lock_guard<std::mutex> lock(writer);
+	trace_ring* previous = ring.exchange(capacity ? new trace_ring(capacity) : nullptr, std::memory_order_acq_rel);
+	update_enabled();
+	rcu.synchronize();
+	delete previous;
+}
+
+void Tracer::update_enabled() {
+	enabled.store(sink.load(std::memory_order_relaxed) != nullptr || ring.load(std::memory_order_relaxed) != nullptr, std::memory_order_relaxed);
+}
+
+static const char* event_name(uint32_t type) {
+	static const char* names[] = { "output", "queued", "dispatch", "dispatch", "speech_start", "speech_end", "interrupt", "stop", "detect" };
+	return (type < sizeof(names) / sizeof(names[0])) ? names[type] : "unknown";
+}
+
+// Driver names are plain ASCII, anything else is replaced so the JSON stays valid.
+static std::string ascii_name(const wchar_t* name) {
+	std::string result;
+	for (; name && *name; name++) {
+		result += (*name >= 0x20 && *name < 0x7f && *name != L'"' && *name != L'\\') ? static_cast<char>(*name) : '?';
+	}
+	return result;
+}
+
+bool Tracer::write_chrome_trace(const char* path) {
+	std::vector<sc_trace_event> events;
+	{
+		std::lock_guard<std::mutex> lock(writer);
+		Rcu::read_guard guard(rcu);
+		trace_ring* current = ring.load(std::memory_order_acquire);
+		if (current == nullptr) {
+			return false;
+		}
+		uint64_t end = current->head.load(std::memory_order_acquire);
+		uint64_t begin = (end > current->capacity) ? end - current->capacity : 0;
+		events.reserve(static_cast<size_t>(end - begin));
+		for (uint64_t position = begin; position < end; position++) {
+			sc_trace_event event;
+			if (current->read(position, event)) {
+				events.push_back(event);
+			}
+		}
+	}
+
+	FILE* file = fopen(path, "w");
+	if (file == nullptr) {
+		return false;
+	}
+	fprintf(file, "{\"traceEvents\": [\n");
+	for (size_t i = 0; i < events.size(); i++) {
+		const sc_trace_event& event = events[i];
+		const char* phase = (event.type == SC_TRACE_DISPATCH_BEGIN) ? "B" : (event.type == SC_TRACE_DISPATCH_END) ? "E" : "i";
+		fprintf(file, "  {\"name\": \"%s\", \"cat\": \"speech\", \"ph\": \"%s\", \"ts\": %.3f, \"pid\": 1, \"tid\": %u%s, \"args\": {\"utterance\": %llu",
+			event_name(event.type), phase, event.timestamp_ns / 1000.0, event.thread, (*phase == 'i') ? ", \"s\": \"t\"" : "",
+			static_cast<unsigned long long>(event.utterance));
+		if (event.driver != nullptr) {
+			fprintf(file, ", \"driver\": \"%s\"", ascii_name(event.driver).c_str());
+		}
+		fprintf(file, "}}%s\n", (i + 1 < events.size()) ? "," : "");
+	}
+	fprintf(file, "], \"displayTimeUnit\": \"ms\"}\n");
+	fclose(file);
+	return true;
+}
+
+Tracer::dispatch_scope::dispatch_scope(Tracer& tracer, uint64_t _utterance, const wchar_t* _driver, bool interrupt) :
+	owner(tracer), utterance(_utterance), driver(_driver), previous(dispatching_utterance) {
+	dispatching_utterance = utterance;
+	if (owner.active()) {
+		if (interrupt) {
+			owner.emit(SC_TRACE_INTERRUPT, utterance, driver);
+		}
+		owner.emit(SC_TRACE_DISPATCH_BEGIN, utterance, driver);
+	}
+}
+
+Tracer::dispatch_scope::~dispatch_scope() {
+	owner.emit(SC_TRACE_DISPATCH_END, utterance, driver);
+	dispatching_utterance = previous;
+}
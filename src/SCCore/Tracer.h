@@ -0,0 +1,61 @@
+// Event tracing for the life of an utterance: API entry, queueing, driver dispatch, start and end of speech, interruption.
+// Events go to an optional user callback and an optional in-memory ring buffer that can be written out as a Chrome trace.
+// Both are swapped under an RCU domain, so emitting never takes a lock. While neither is set, emit() is a single relaxed load.
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include "Rcu.h"
+#include "../../include/SpeechCore.h"
+
+class Tracer {
+public:
+	Tracer() = default;
+	~Tracer();
+	Tracer(const Tracer&) = delete;
+	Tracer& operator=(const Tracer&) = delete;
+
+	bool active() const { return enabled.load(std::memory_order_relaxed); }
+	void emit(uint32_t type, uint64_t utterance, const wchar_t* driver = nullptr);
+// The utterance being dispatched on this thread, for drivers that emit events from their speak path.
+	static uint64_t current_utterance();
+
+// The callback is called on the emitting thread and must not change tracing settings itself.
+	void set_callback(sc_trace_callback callback, void* userdata);
+// A capacity of 0 removes the buffer. Setting a buffer always starts it empty.
+	void set_buffer(size_t capacity);
+	bool write_chrome_trace(const char* path);
+
+// Emits DISPATCH_BEGIN/END around a driver speak call and makes the utterance visible to current_utterance().
+	class dispatch_scope {
+	public:
+		dispatch_scope(Tracer& tracer, uint64_t utterance, const wchar_t* driver, bool interrupt);
+		~dispatch_scope();
+		dispatch_scope(const dispatch_scope&) = delete;
+		dispatch_scope& operator=(const dispatch_scope&) = delete;
+
+	private:
+		Tracer& owner;
+		uint64_t utterance;
+		const wchar_t* driver;
+		uint64_t previous;
+	};
+
+private:
+	struct trace_sink {
+		sc_trace_callback callback;
+		void* userdata;
+	};
+	struct trace_ring;
+
+	std::atomic<bool> enabled{ false };
+	std::atomic<trace_sink*> sink{ nullptr };
+	std::atomic<trace_ring*> ring{ nullptr };
+	std::mutex writer;
+	Rcu rcu;
+
+	void update_enabled();
+};
+
+extern Tracer tracer;
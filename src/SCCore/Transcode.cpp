@@ -0,0 +1,600 @@
+#include <cstdint>
+#include <cstring>
+#include <cwchar>
+#include <type_traits>
+#include "Transcode.h"
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define TRANSCODE_X86
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define TARGET_SSE2
+#define TARGET_AVX2
+#else
+#define TARGET_SSE2 __attribute__((target("sse2")))
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#endif // _MSC_VER
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#define TRANSCODE_NEON
+#include <arm_neon.h>
+#endif
+
+#ifdef _WIN32
+#include <Windows.h>
+#endif // _WIN32
+
+using wide_unit = std::make_unsigned_t<wchar_t>;
+constexpr bool wide_is_utf16 = sizeof(wchar_t) == 2;
+
+// After a block that was not all ASCII, the scalar path goes on until it converted this many ASCII code units in a row.
+// Only then is SIMD tried again: on CJK or accented text a probe right away would almost always fail at once.
+constexpr size_t ascii_run = 8;
+// Thread buffers grown past this are given back once a smaller conversion comes along.
+constexpr size_t retained_limit = 64 * 1024;
+
+// The SIMD kernels convert whole blocks of ASCII and return how many code units they did,
+// stopping at the first block holding anything else.
+struct kernels {
+	size_t (*encode_ascii)(const wchar_t* text, size_t count, char* out);
+	size_t (*decode_ascii)(const char* text, size_t count, wchar_t* out);
+};
+
+static size_t encode_ascii_scalar(const wchar_t*, size_t, char*) {
+	return 0;
+}
+
+static size_t decode_ascii_scalar(const char*, size_t, wchar_t*) {
+	return 0;
+}
+
+#ifdef TRANSCODE_X86
+TARGET_SSE2 static size_t encode_ascii_sse2(const wchar_t* text, size_t count, char* out) {
+	size_t done = 0;
+	const __m128i zero = _mm_setzero_si128();
+	if constexpr (wide_is_utf16) {
+		const __m128i high = _mm_set1_epi16(static_cast<short>(0xFF80));
+		for (; done + 16 <= count; done += 16) {
+			__m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(text + done));
+			__m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(text + done + 8));
+			if (_mm_movemask_epi8(_mm_cmpeq_epi16(_mm_and_si128(_mm_or_si128(a, b), high), zero)) != 0xFFFF) {
+				break;
+			}
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(out + done), _mm_packus_epi16(a, b));
+		}
+	}
+	else {
+		const __m128i high = _mm_set1_epi32(~0x7F);
+		for (; done + 16 <= count; done += 16) {
+			const __m128i* block = reinterpret_cast<const __m128i*>(text + done);
+			__m128i a = _mm_loadu_si128(block);
+			__m128i b = _mm_loadu_si128(block + 1);
+			__m128i c = _mm_loadu_si128(block + 2);
+			__m128i d = _mm_loadu_si128(block + 3);
+			__m128i any = _mm_or_si128(_mm_or_si128(a, b), _mm_or_si128(c, d));
+			if (_mm_movemask_epi8(_mm_cmpeq_epi32(_mm_and_si128(any, high), zero)) != 0xFFFF) {
+				break;
+			}
+			// All below 0x80, so the signed saturation of packs never kicks in.
+			__m128i low = _mm_packs_epi32(a, b);
+			__m128i upper = _mm_packs_epi32(c, d);
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(out + done), _mm_packus_epi16(low, upper));
+		}
+	}
+	return done;
+}
+
+TARGET_SSE2 static size_t decode_ascii_sse2(const char* text, size_t count, wchar_t* out) {
+	size_t done = 0;
+	const __m128i zero = _mm_setzero_si128();
+	for (; done + 16 <= count; done += 16) {
+		__m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(text + done));
+		if (_mm_movemask_epi8(bytes) != 0) {
+			break;
+		}
+		__m128i low = _mm_unpacklo_epi8(bytes, zero);
+		__m128i upper = _mm_unpackhi_epi8(bytes, zero);
+		__m128i* target = reinterpret_cast<__m128i*>(out + done);
+		if constexpr (wide_is_utf16) {
+			_mm_storeu_si128(target, low);
+			_mm_storeu_si128(target + 1, upper);
+		}
+		else {
+			_mm_storeu_si128(target, _mm_unpacklo_epi16(low, zero));
+			_mm_storeu_si128(target + 1, _mm_unpackhi_epi16(low, zero));
+			_mm_storeu_si128(target + 2, _mm_unpacklo_epi16(upper, zero));
+			_mm_storeu_si128(target + 3, _mm_unpackhi_epi16(upper, zero));
+		}
+	}
+	return done;
+}
+
+TARGET_AVX2 static size_t encode_ascii_avx2(const wchar_t* text, size_t count, char* out) {
+	size_t done = 0;
+	if constexpr (wide_is_utf16) {
+		const __m256i high = _mm256_set1_epi16(static_cast<short>(0xFF80));
+		for (; done + 32 <= count; done += 32) {
+			__m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(text + done));
+			__m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(text + done + 16));
+			if (!_mm256_testz_si256(_mm256_or_si256(a, b), high)) {
+				break;
+			}
+			// packus works per 128 bit lane, the permute puts the quarters back in order.
+			__m256i packed = _mm256_permute4x64_epi64(_mm256_packus_epi16(a, b), 0xD8);
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(out + done), packed);
+		}
+	}
+	else {
+		const __m256i high = _mm256_set1_epi32(~0x7F);
+		for (; done + 16 <= count; done += 16) {
+			__m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(text + done));
+			__m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(text + done + 8));
+			if (!_mm256_testz_si256(_mm256_or_si256(a, b), high)) {
+				break;
+			}
+			__m256i words = _mm256_permute4x64_epi64(_mm256_packus_epi32(a, b), 0xD8);
+			__m128i bytes = _mm_packus_epi16(_mm256_castsi256_si128(words), _mm256_extracti128_si256(words, 1));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(out + done), bytes);
+		}
+	}
+	return done;
+}
+
+TARGET_AVX2 static size_t decode_ascii_avx2(const char* text, size_t count, wchar_t* out) {
+	size_t done = 0;
+	for (; done + 16 <= count; done += 16) {
+		__m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(text + done));
+		if (_mm_movemask_epi8(bytes) != 0) {
+			break;
+		}
+		__m256i* target = reinterpret_cast<__m256i*>(out + done);
+		if constexpr (wide_is_utf16) {
+			_mm256_storeu_si256(target, _mm256_cvtepu8_epi16(bytes));
+		}
+		else {
+			_mm256_storeu_si256(target, _mm256_cvtepu8_epi32(bytes));
+			_mm256_storeu_si256(target + 1, _mm256_cvtepu8_epi32(_mm_srli_si128(bytes, 8)));
+		}
+	}
+	return done;
+}
+
+static bool has_avx2() {
+#ifdef _MSC_VER
+	int info[4];
+	__cpuid(info, 0);
+	if (info[0] < 7) {
+		return false;
+	}
+	// The OS has to save the YMM registers too.
+	__cpuid(info, 1);
+	if ((info[2] & (1 << 27)) == 0 || (_xgetbv(0) & 6) != 6) {
+		return false;
+	}
+	__cpuidex(info, 7, 0);
+	return (info[1] & (1 << 5)) != 0;
+#else
+	return __builtin_cpu_supports("avx2");
+#endif // _MSC_VER
+}
+
+static bool has_sse2() {
+#if defined(__x86_64__) || defined(_M_X64) || defined(_M_IX86)
+	return true;
+#else
+	return __builtin_cpu_supports("sse2");
+#endif
+}
+#endif // TRANSCODE_X86
+
+#ifdef TRANSCODE_NEON
+static size_t encode_ascii_neon(const wchar_t* text, size_t count, char* out) {
+	size_t done = 0;
+	for (; done + 16 <= count; done += 16) {
+		uint8x16_t bytes;
+		if constexpr (wide_is_utf16) {
+			const uint16_t* block = reinterpret_cast<const uint16_t*>(text + done);
+			uint16x8_t a = vld1q_u16(block);
+			uint16x8_t b = vld1q_u16(block + 8);
+			if (vmaxvq_u16(vorrq_u16(a, b)) >= 0x80) {
+				break;
+			}
+			bytes = vcombine_u8(vmovn_u16(a), vmovn_u16(b));
+		}
+		else {
+			const uint32_t* block = reinterpret_cast<const uint32_t*>(text + done);
+			uint32x4_t a = vld1q_u32(block);
+			uint32x4_t b = vld1q_u32(block + 4);
+			uint32x4_t c = vld1q_u32(block + 8);
+			uint32x4_t d = vld1q_u32(block + 12);
+			if (vmaxvq_u32(vorrq_u32(vorrq_u32(a, b), vorrq_u32(c, d))) >= 0x80) {
+				break;
+			}
+			uint16x8_t low = vcombine_u16(vmovn_u32(a), vmovn_u32(b));
+			uint16x8_t upper = vcombine_u16(vmovn_u32(c), vmovn_u32(d));
+			bytes = vcombine_u8(vmovn_u16(low), vmovn_u16(upper));
+		}
+		vst1q_u8(reinterpret_cast<uint8_t*>(out + done), bytes);
+	}
+	return done;
+}
+
+static size_t decode_ascii_neon(const char* text, size_t count, wchar_t* out) {
+	size_t done = 0;
+	for (; done + 16 <= count; done += 16) {
+		uint8x16_t bytes = vld1q_u8(reinterpret_cast<const uint8_t*>(text + done));
+		if (vmaxvq_u8(bytes) >= 0x80) {
+			break;
+		}
+		uint16x8_t low = vmovl_u8(vget_low_u8(bytes));
+		uint16x8_t upper = vmovl_u8(vget_high_u8(bytes));
+		if constexpr (wide_is_utf16) {
+			uint16_t* target = reinterpret_cast<uint16_t*>(out + done);
+			vst1q_u16(target, low);
+			vst1q_u16(target + 8, upper);
+		}
+		else {
+			uint32_t* target = reinterpret_cast<uint32_t*>(out + done);
+			vst1q_u32(target, vmovl_u16(vget_low_u16(low)));
+			vst1q_u32(target + 4, vmovl_u16(vget_high_u16(low)));
+			vst1q_u32(target + 8, vmovl_u16(vget_low_u16(upper)));
+			vst1q_u32(target + 12, vmovl_u16(vget_high_u16(upper)));
+		}
+	}
+	return done;
+}
+#endif // TRANSCODE_NEON
+
+static kernels pick_kernels() {
+#if defined(TRANSCODE_X86)
+	if (has_avx2()) {
+		return { encode_ascii_avx2, decode_ascii_avx2 };
+	}
+	if (has_sse2()) {
+		return { encode_ascii_sse2, decode_ascii_sse2 };
+	}
+#elif defined(TRANSCODE_NEON)
+	return { encode_ascii_neon, decode_ascii_neon };
+#endif
+	return { encode_ascii_scalar, decode_ascii_scalar };
+}
+
+static const kernels& simd() {
+	static const kernels selected = pick_kernels();
+	return selected;
+}
+
+static char* put_utf8(char* out, uint32_t code_point) {
+	if (code_point < 0x80) {
+		*out++ = static_cast<char>(code_point);
+	}
+	else if (code_point < 0x800) {
+		*out++ = static_cast<char>(0xC0 | (code_point >> 6));
+		*out++ = static_cast<char>(0x80 | (code_point & 0x3F));
+	}
+	else if (code_point < 0x10000 || code_point > 0x10FFFF) {
+		if (code_point > 0xFFFF || (code_point >= 0xD800 && code_point <= 0xDFFF)) {
+			code_point = 0xFFFD;
+		}
+		*out++ = static_cast<char>(0xE0 | (code_point >> 12));
+		*out++ = static_cast<char>(0x80 | ((code_point >> 6) & 0x3F));
+		*out++ = static_cast<char>(0x80 | (code_point & 0x3F));
+	}
+	else {
+		*out++ = static_cast<char>(0xF0 | (code_point >> 18));
+		*out++ = static_cast<char>(0x80 | ((code_point >> 12) & 0x3F));
+		*out++ = static_cast<char>(0x80 | ((code_point >> 6) & 0x3F));
+		*out++ = static_cast<char>(0x80 | (code_point & 0x3F));
+	}
+	return out;
+}
+
+static wchar_t* put_wide(wchar_t* out, uint32_t code_point) {
+	if (wide_is_utf16 && code_point >= 0x10000) {
+		code_point -= 0x10000;
+		*out++ = static_cast<wchar_t>(0xD800 + (code_point >> 10));
+		*out++ = static_cast<wchar_t>(0xDC00 + (code_point & 0x3FF));
+	}
+	else {
+		*out++ = static_cast<wchar_t>(code_point);
+	}
+	return out;
+}
+
+static bool continuation(unsigned char byte) {
+	return (byte & 0xC0) == 0x80;
+}
+
+namespace transcode {
+	size_t utf8_capacity(size_t count) {
+		// A surrogate pair takes two UTF-16 units for four bytes, anything else at most three bytes per unit.
+		return count * (wide_is_utf16 ? 3 : 4);
+	}
+
+	size_t encode_utf8(const wchar_t* text, size_t count, char* out) {
+		const kernels& kernel = simd();
+		char* start = out;
+		size_t i = 0;
+		while (i < count) {
+			size_t ascii = kernel.encode_ascii(text + i, count - i, out);
+			i += ascii;
+			out += ascii;
+			for (size_t run = 0; i < count && run < ascii_run;) {
+				uint32_t unit = static_cast<wide_unit>(text[i++]);
+				if (unit < 0x80) {
+					*out++ = static_cast<char>(unit);
+					run++;
+					continue;
+				}
+				run = 0;
+				if (wide_is_utf16 && unit >= 0xD800 && unit <= 0xDBFF && i < count) {
+					uint32_t low = static_cast<wide_unit>(text[i]);
+					if (low >= 0xDC00 && low <= 0xDFFF) {
+						unit = 0x10000 + ((unit - 0xD800) << 10) + (low - 0xDC00);
+						i++;
+					}
+				}
+				out = put_utf8(out, unit); // An unpaired surrogate ends up as U+FFFD.
+			}
+		}
+		return static_cast<size_t>(out - start);
+	}
+
+	size_t decode_utf8(const char* text, size_t count, wchar_t* out) {
+		const kernels& kernel = simd();
+		const unsigned char* bytes = reinterpret_cast<const unsigned char*>(text);
+		wchar_t* start = out;
+		size_t i = 0;
+		while (i < count) {
+			size_t ascii = kernel.decode_ascii(text + i, count - i, out);
+			i += ascii;
+			out += ascii;
+			for (size_t run = 0; i < count && run < ascii_run;) {
+				unsigned char lead = bytes[i];
+				if (lead < 0x80) {
+					*out++ = static_cast<wchar_t>(lead);
+					i++;
+					run++;
+					continue;
+				}
+				run = 0;
+				uint32_t code_point = 0xFFFD;
+				size_t length = 1;
+				if (lead >= 0xC2 && lead <= 0xDF && i + 1 < count && continuation(bytes[i + 1])) {
+					code_point = ((lead & 0x1Fu) << 6) | (bytes[i + 1] & 0x3Fu);
+					length = 2;
+				}
+				else if (lead >= 0xE0 && lead <= 0xEF && i + 2 < count && continuation(bytes[i + 1]) && continuation(bytes[i + 2])) {
+					uint32_t value = ((lead & 0x0Fu) << 12) | ((bytes[i + 1] & 0x3Fu) << 6) | (bytes[i + 2] & 0x3Fu);
+					if (value >= 0x800 && (value < 0xD800 || value > 0xDFFF)) {
+						code_point = value;
+						length = 3;
+					}
+				}
+				else if (lead >= 0xF0 && lead <= 0xF4 && i + 3 < count && continuation(bytes[i + 1]) && continuation(bytes[i + 2]) && continuation(bytes[i + 3])) {
+					uint32_t value = ((lead & 0x07u) << 18) | ((bytes[i + 1] & 0x3Fu) << 12) | ((bytes[i + 2] & 0x3Fu) << 6) | (bytes[i + 3] & 0x3Fu);
+					if (value >= 0x10000 && value <= 0x10FFFF) {
+						code_point = value;
+						length = 4;
+					}
+				}
+				// Anything malformed costs its lead byte, the bytes after it are looked at on their own.
+				i += length;
+				out = put_wide(out, code_point);
+			}
+		}
+		return static_cast<size_t>(out - start);
+	}
+}
+
+namespace transcode {
+	size_t encode_utf8(const char16_t* text, size_t count, char* out) {
+		if constexpr (wide_is_utf16) {
+			return encode_utf8(reinterpret_cast<const wchar_t*>(text), count, out);
+		}
+		else {
+			char* start = out;
+			size_t i = 0;
+			while (i < count) {
+				// Four ASCII units at a time, read as one word. There are no UTF-16 kernels where wchar_t is UTF-32.
+				while (i + 4 <= count) {
+					uint64_t word;
+					memcpy(&word, text + i, sizeof(word));
+					if ((word & 0xFF80FF80FF80FF80ull) != 0) {
+						break;
+					}
+					out[0] = static_cast<char>(text[i]);
+					out[1] = static_cast<char>(text[i + 1]);
+					out[2] = static_cast<char>(text[i + 2]);
+					out[3] = static_cast<char>(text[i + 3]);
+					i += 4;
+					out += 4;
+				}
+				if (i == count) {
+					break;
+				}
+				uint32_t unit = text[i++];
+				if (unit >= 0xD800 && unit <= 0xDBFF && i < count && text[i] >= 0xDC00 && text[i] <= 0xDFFF) {
+					unit = 0x10000 + ((unit - 0xD800) << 10) + (text[i++] - 0xDC00u);
+				}
+				out = put_utf8(out, unit);
+			}
+			return static_cast<size_t>(out - start);
+		}
+	}
+
+	size_t decode_utf16(const char16_t* text, size_t count, wchar_t* out) {
+		if constexpr (wide_is_utf16) {
+			if (count > 0) {
+				memcpy(out, text, count * sizeof(wchar_t));
+			}
+			return count;
+		}
+		else {
+			wchar_t* start = out;
+			for (size_t i = 0; i < count;) {
+				uint32_t unit = text[i++];
+				if (unit >= 0xD800 && unit <= 0xDFFF) {
+					if (unit <= 0xDBFF && i < count && text[i] >= 0xDC00 && text[i] <= 0xDFFF) {
+						unit = 0x10000 + ((unit - 0xD800) << 10) + (text[i++] - 0xDC00u);
+					}
+					else {
+						unit = 0xFFFD;
+					}
+				}
+				*out++ = static_cast<wchar_t>(unit);
+			}
+			return static_cast<size_t>(out - start);
+		}
+	}
+
+	size_t encode_utf16(const wchar_t* text, size_t count, char16_t* out) {
+		if constexpr (wide_is_utf16) {
+			if (count > 0) {
+				memcpy(out, text, count * sizeof(char16_t));
+			}
+			return count;
+		}
+		else {
+			char16_t* start = out;
+			for (size_t i = 0; i < count; i++) {
+				uint32_t code_point = static_cast<wide_unit>(text[i]);
+				if (code_point > 0x10FFFF || (code_point >= 0xD800 && code_point <= 0xDFFF)) {
+					code_point = 0xFFFD;
+				}
+				if (code_point >= 0x10000) {
+					code_point -= 0x10000;
+					*out++ = static_cast<char16_t>(0xD800 + (code_point >> 10));
+					*out++ = static_cast<char16_t>(0xDC00 + (code_point & 0x3FF));
+				}
+				else {
+					*out++ = static_cast<char16_t>(code_point);
+				}
+			}
+			return static_cast<size_t>(out - start);
+		}
+	}
+}
+
+template<typename T>
+static T* reserve(std::basic_string<T>& buffer, size_t size) {
+	if (buffer.size() > retained_limit && size <= retained_limit) {
+		std::basic_string<T>().swap(buffer);
+	}
+	if (buffer.size() < size) {
+		buffer.resize(size);
+	}
+	return buffer.data();
+}
+
+static thread_local std::string utf8_buffer;
+static thread_local std::wstring wide_buffer;
+static thread_local std::u16string utf16_buffer;
+
+namespace transcode {
+	const char* to_utf8(const wchar_t* text, size_t* length) {
+		return to_utf8(text, text ? wcslen(text) : 0, length);
+	}
+
+	const char* to_utf8(const wchar_t* text, size_t count, size_t* length) {
+		char* out = reserve(utf8_buffer, utf8_capacity(count) + 1);
+		size_t written = (text != nullptr) ? encode_utf8(text, count, out) : 0;
+		out[written] = '\0';
+		if (length) {
+			*length = written;
+		}
+		return out;
+	}
+
+	const wchar_t* to_wide(const char* text, size_t* length) {
+		return to_wide(text, text ? strlen(text) : 0, length);
+	}
+
+	const wchar_t* to_wide(const char* text, size_t count, size_t* length) {
+		wchar_t* out = reserve(wide_buffer, count + 1);
+		size_t written = (text != nullptr) ? decode_utf8(text, count, out) : 0;
+		out[written] = L'\0';
+		if (length) {
+			*length = written;
+		}
+		return out;
+	}
+
+	const char* to_utf8(const char16_t* text, size_t count, size_t* length) {
+		char* out = reserve(utf8_buffer, count * 3 + 1);
+		size_t written = (text != nullptr) ? encode_utf8(text, count, out) : 0;
+		out[written] = '\0';
+		if (length) {
+			*length = written;
+		}
+		return out;
+	}
+
+	const wchar_t* to_wide(const char16_t* text, size_t count, size_t* length) {
+		wchar_t* out = reserve(wide_buffer, count + 1);
+		size_t written = (text != nullptr) ? decode_utf16(text, count, out) : 0;
+		out[written] = L'\0';
+		if (length) {
+			*length = written;
+		}
+		return out;
+	}
+
+	const char16_t* to_utf16(const wchar_t* text, size_t* length) {
+		size_t count = text ? wcslen(text) : 0;
+		char16_t* out = reserve(utf16_buffer, count * 2 + 1);
+		size_t written = encode_utf16(text, count, out);
+		out[written] = u'\0';
+		if (length) {
+			*length = written;
+		}
+		return out;
+	}
+
+	const char* terminated(const char* text, size_t count) {
+		char* out = reserve(utf8_buffer, count + 1);
+		if (count > 0) {
+			memcpy(out, text, count);
+		}
+		out[count] = '\0';
+		return out;
+	}
+
+	const wchar_t* terminated(const wchar_t* text, size_t count) {
+		wchar_t* out = reserve(wide_buffer, count + 1);
+		if (count > 0) {
+			wmemcpy(out, text, count);
+		}
+		out[count] = L'\0';
+		return out;
+	}
+
+	std::string utf8_string(const wchar_t* text) {
+		size_t length;
+		const char* utf8 = to_utf8(text, &length);
+		return std::string(utf8, length);
+	}
+
+	std::wstring wide_string(const char* text, size_t count) {
+		size_t length;
+		const wchar_t* wide = to_wide(text, count, &length);
+		return std::wstring(wide, length);
+	}
+
+#ifdef _WIN32
+	const char* to_codepage(const wchar_t* text, unsigned int codepage, size_t* length) {
+		size_t count = text ? wcslen(text) : 0;
+		// Four bytes per unit covers every code page, double byte ones like CP932 need two.
+		char* out = reserve(utf8_buffer, count * 4 + 1);
+		int written = (count > 0) ? WideCharToMultiByte(codepage, 0, text, static_cast<int>(count), out, static_cast<int>(count * 4), nullptr, nullptr) : 0;
+		if (written < 0) {
+			written = 0;
+		}
+		out[written] = '\0';
+		if (length) {
+			*length = static_cast<size_t>(written);
+		}
+		return out;
+	}
+#endif // _WIN32
+}
@@ -0,0 +1,48 @@
+// Conversion between wchar_t text and UTF-8, shared by the drivers and the bindings. wchar_t is UTF-16 on Windows and
+// UTF-32 elsewhere, both are handled. Runs of ASCII are converted 16 code units at a time with AVX2 or SSE2 on x86
+// and NEON on ARM, everything else goes through the scalar path. AVX2 is picked at runtime.
+// Only ASCII gets a SIMD path. Non-ASCII text is converted one code point at a time, and in unoptimized builds that is
+// two to three times slower than the wcstombs/mbstowcs calls it replaced (transcode_bench, Latin-1, CJK and emoji).
+// With -O2 it is about as fast as those calls or faster on every corpus.
+// Invalid input (unpaired surrogates, out of range code points, malformed UTF-8) becomes U+FFFD instead of failing,
+// so one bad character never costs the whole utterance. Unlike wcstombs, nothing depends on the C locale.
+#pragma once
+#include <cstddef>
+#include <string>
+
+namespace transcode {
+	// Convert up to the terminator, or count code units. length receives the size of the result without its terminator.
+	// The result lives in a buffer owned by the calling thread and is only valid until its next conversion.
+	const char* to_utf8(const wchar_t* text, size_t* length = nullptr);
+	const char* to_utf8(const wchar_t* text, size_t count, size_t* length);
+	const wchar_t* to_wide(const char* text, size_t* length = nullptr);
+	const wchar_t* to_wide(const char* text, size_t count, size_t* length);
+
+	// UTF-16 as Java and .NET hold it. Where wchar_t is UTF-16 too these are plain copies.
+	const char* to_utf8(const char16_t* text, size_t count, size_t* length);
+	const wchar_t* to_wide(const char16_t* text, size_t count, size_t* length);
+	const char16_t* to_utf16(const wchar_t* text, size_t* length = nullptr);
+
+	// For results that have to outlive the next conversion.
+	std::string utf8_string(const wchar_t* text);
+	std::wstring wide_string(const char* text, size_t count);
+
+	// Copies text that has no terminator into the same buffer as the conversions, with one.
+	const char* terminated(const char* text, size_t count);
+	const wchar_t* terminated(const wchar_t* text, size_t count);
+
+	// The converters underneath. encode_utf8 needs utf8_capacity(count) bytes, decode_utf8 count wchar_t.
+	// Both return the code units written, no terminator is added.
+	size_t utf8_capacity(size_t count);
+	size_t encode_utf8(const wchar_t* text, size_t count, char* out);
+	size_t decode_utf8(const char* text, size_t count, wchar_t* out);
+	// UTF-16 needs 3 bytes per unit as UTF-8 and at most one wchar_t, wchar_t at most two UTF-16 units.
+	size_t encode_utf8(const char16_t* text, size_t count, char* out);
+	size_t decode_utf16(const char16_t* text, size_t count, wchar_t* out);
+	size_t encode_utf16(const wchar_t* text, size_t count, char16_t* out);
+
+#ifdef _WIN32
+	// For drivers taking a legacy code page (PC Talker wants CP932). Same buffer rules as to_utf8.
+	const char* to_codepage(const wchar_t* text, unsigned int codepage, size_t* length = nullptr);
+#endif // _WIN32
+}
@@ -0,0 +1,202 @@
+#include <vector>
+#include "Tracer.h"
+#include "Utterances.h"
+
+static bool is_final(uint32_t state) {
+	return state == SC_UTTERANCE_DONE || state == SC_UTTERANCE_CANCELLED || state == SC_UTTERANCE_FAILED;
+}
+
+uint64_t UtteranceTracker::track() {
+	uint64_t id = allocate();
+	std::lock_guard<std::mutex> lock(mutex);
+	states[id] = SC_UTTERANCE_QUEUED;
+	pending.fetch_add(1, std::memory_order_relaxed);
+	return id;
+}
+
+bool UtteranceTracker::transition_begin(uint64_t id) {
+	std::lock_guard<std::mutex> lock(mutex);
+	if (claim(id)) {
+		return false;
+	}
+	auto it = states.find(id);
+	if (it == states.end()) {
+		return true; // Not a tracked utterance.
+	}
+	if (it->second == SC_UTTERANCE_QUEUED) {
+		it->second = SC_UTTERANCE_SPEAKING;
+	}
+	return it->second == SC_UTTERANCE_SPEAKING;
+}
+
+void UtteranceTracker::finish_dispatch(uint64_t id, bool spoken, bool reports_end) {
+	if (!spoken) {
+		finish(id, SC_UTTERANCE_FAILED, SC_UTTERANCE_SPEAKING);
+	}
+	else if (!reports_end) {
+		finish(id, SC_UTTERANCE_DONE, SC_UTTERANCE_SPEAKING);
+	}
+}
+
+void UtteranceTracker::finish(uint64_t id, uint32_t state, uint32_t expected) {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		if (expected == SC_UTTERANCE_QUEUED) {
+			claim(id); // Taken out of the queue, whether it was cancelled meanwhile or not.
+		}
+		auto it = states.find(id);
+		if (it == states.end() || it->second != expected) {
+			return;
+		}
+		if (!settle(id, it->second, state)) {
+			return;
+		}
+	}
+	notify(id, state);
+}
+
+void UtteranceTracker::speech_started(uint64_t id, const wchar_t* driver) {
+	tracer.emit(SC_TRACE_SPEECH_START, id, driver);
+}
+
+void UtteranceTracker::speech_ended(uint64_t id, const wchar_t* driver) {
+	tracer.emit(SC_TRACE_SPEECH_END, id, driver);
+	if (id == 0 || !busy()) {
+		return;
+	}
+	// Marks arrive in order, so anything older still speaking was interrupted before reaching its own.
+	std::vector<std::pair<uint64_t, uint32_t>> changed;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		for (auto& entry : states) {
+			if (entry.second != SC_UTTERANCE_SPEAKING || entry.first > id) {
+				continue;
+			}
+			uint32_t state = (entry.first == id) ? SC_UTTERANCE_DONE : SC_UTTERANCE_CANCELLED;
+			if (settle(entry.first, entry.second, state)) {
+				changed.emplace_back(entry.first, state);
+			}
+		}
+	}
+	for (auto& change : changed) {
+		notify(change.first, change.second);
+	}
+}
+
+void UtteranceTracker::speech_finished(uint64_t id, const wchar_t* driver) {
+	tracer.emit(SC_TRACE_SPEECH_END, id, driver);
+	if (id != 0 && busy()) {
+		finish(id, SC_UTTERANCE_DONE, SC_UTTERANCE_SPEAKING);
+	}
+}
+
+void UtteranceTracker::speech_cancelled(uint64_t id, const wchar_t* driver) {
+	tracer.emit(SC_TRACE_SPEECH_END, id, driver);
+	if (id != 0 && busy()) {
+		finish(id, SC_UTTERANCE_CANCELLED, SC_UTTERANCE_SPEAKING);
+	}
+}
+
+void UtteranceTracker::cancel_all(bool queued) {
+	if (!busy()) {
+		return;
+	}
+	std::vector<uint64_t> changed;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		for (auto& entry : states) {
+			bool was_queued = entry.second == SC_UTTERANCE_QUEUED;
+			if (entry.second == SC_UTTERANCE_SPEAKING || (queued && was_queued)) {
+				if (settle(entry.first, entry.second, SC_UTTERANCE_CANCELLED)) {
+					changed.push_back(entry.first);
+				}
+				if (was_queued) {
+					unclaimed.insert(entry.first);
+				}
+			}
+		}
+		unclaimed_count.store(unclaimed.size(), std::memory_order_relaxed);
+	}
+	for (uint64_t id : changed) {
+		notify(id, SC_UTTERANCE_CANCELLED);
+	}
+}
+
+uint32_t UtteranceTracker::cancel(uint64_t id) {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		auto it = states.find(id);
+		if (it == states.end()) {
+			return SC_UTTERANCE_UNKNOWN;
+		}
+		if (it->second != SC_UTTERANCE_QUEUED) {
+			return it->second;
+		}
+		settle(id, it->second, SC_UTTERANCE_CANCELLED);
+		unclaimed.insert(id);
+		unclaimed_count.store(unclaimed.size(), std::memory_order_relaxed);
+	}
+	notify(id, SC_UTTERANCE_CANCELLED);
+	return SC_UTTERANCE_QUEUED;
+}
+
+uint32_t UtteranceTracker::state(uint64_t id) {
+	std::lock_guard<std::mutex> lock(mutex);
+	auto it = states.find(id);
+	return (it != states.end()) ? it->second : SC_UTTERANCE_UNKNOWN;
+}
+
+uint32_t UtteranceTracker::wait(uint64_t id, uint32_t timeout_ms) {
+	std::unique_lock<std::mutex> lock(mutex);
+	uint32_t result = SC_UTTERANCE_UNKNOWN;
+	finished.wait_for(lock, std::chrono::milliseconds(timeout_ms), [&] {
+		auto it = states.find(id);
+		result = (it != states.end()) ? it->second : SC_UTTERANCE_UNKNOWN;
+		return result == SC_UTTERANCE_UNKNOWN || is_final(result);
+	});
+	return result;
+}
+
+void UtteranceTracker::set_callback(sc_utterance_callback _callback, void* _userdata) {
+	std::lock_guard<std::mutex> lock(mutex);
+	callback = _callback;
+	userdata = _userdata;
+}
+
+bool UtteranceTracker::settle(uint64_t id, uint32_t& current, uint32_t state) {
+	if (is_final(current)) {
+		return false;
+	}
+	current = state;
+	if (is_final(state)) {
+		pending.fetch_sub(1, std::memory_order_relaxed);
+		history.push_back(id);
+		if (history.size() > history_limit) {
+			states.erase(history.front());
+			history.pop_front();
+		}
+	}
+	return true;
+}
+
+bool UtteranceTracker::claim(uint64_t id) {
+	if (unclaimed.erase(id) == 0) {
+		return false;
+	}
+	unclaimed_count.store(unclaimed.size(), std::memory_order_relaxed);
+	return true;
+}
+
+void UtteranceTracker::notify(uint64_t id, uint32_t state) {
+	sc_utterance_callback target;
+	void* target_userdata;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		target = callback;
+		target_userdata = userdata;
+	}
+	finished.notify_all();
+	if (target != nullptr) {
+		target(id, state, target_userdata);
+	}
+}
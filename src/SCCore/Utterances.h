@@ -0,0 +1,93 @@
+// Lifecycle of the utterances handed out by Speech_Output_Ex: queued, speaking, then done, cancelled or failed.
+// Drivers that can tell when speech finished (NVDA's SSML marks) report it through speech_ended(), for the others an
+// utterance is done once the driver accepted it. Every other output path only pays a relaxed load per hook, the
+// tracker is skipped entirely while no tracked utterance is in flight.
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <unordered_map>
+#include <unordered_set>
+#include "../../include/SpeechCore.h"
+
+class UtteranceTracker {
+public:
+	UtteranceTracker() = default;
+	UtteranceTracker(const UtteranceTracker&) = delete;
+	UtteranceTracker& operator=(const UtteranceTracker&) = delete;
+
+// Returns a new utterance id. Ids are shared with the tracer, so trace events and handles agree.
+	uint64_t allocate() { return counter.fetch_add(1, std::memory_order_relaxed) + 1; }
+// Returns a new id in the queued state.
+	uint64_t track();
+
+// Called right before the utterance is handed to the driver. Returns false if it was cancelled meanwhile.
+	bool begin(uint64_t id) { return (id == 0 || !busy()) ? true : transition_begin(id); }
+// Called once the driver call returned. Without end of speech reports from the driver the utterance is done now.
+	void dispatched(uint64_t id, bool spoken, bool reports_end) {
+		if (id != 0 && busy()) {
+			finish_dispatch(id, spoken, reports_end);
+		}
+	}
+// A queued utterance never reached a driver: none was available, or it was dropped from the queue.
+	void dropped(uint64_t id, uint32_t state) {
+		if (id != 0 && busy()) {
+			finish(id, state, SC_UTTERANCE_QUEUED);
+		}
+	}
+
+// A queued utterance was merged into another one and spoken with it: it takes the outcome of that one's dispatch.
+	void settle_merged(uint64_t id, uint32_t state) {
+		if (id != 0 && busy()) {
+			finish(id, state, SC_UTTERANCE_QUEUED);
+		}
+	}
+
+// For drivers: the driver started or finished speaking an utterance. Also emits the matching trace event.
+	void speech_started(uint64_t id, const wchar_t* driver);
+// For drivers that speak in order and report no cancels (NVDA): older utterances still speaking were interrupted.
+	void speech_ended(uint64_t id, const wchar_t* driver);
+// For drivers that report every utterance on its own, possibly out of order (Speech Dispatcher): finishes only this one.
+	void speech_finished(uint64_t id, const wchar_t* driver);
+	void speech_cancelled(uint64_t id, const wchar_t* driver);
+// Speech was stopped or interrupted: everything speaking is cancelled, and with queued also everything still queued.
+	void cancel_all(bool queued);
+
+// Cancels the utterance if it is queued. Returns the state it was in, only a queued one is cancelled here.
+	uint32_t cancel(uint64_t id);
+	uint32_t state(uint64_t id);
+	uint32_t wait(uint64_t id, uint32_t timeout_ms);
+
+// The callback is called on the thread completing the utterance, without any lock held.
+	void set_callback(sc_utterance_callback callback, void* userdata);
+
+private:
+	std::atomic<uint64_t> counter{ 0 };
+	std::atomic<size_t> pending{ 0 }; // Tracked utterances not finished yet.
+	std::atomic<size_t> unclaimed_count{ 0 }; // Size of unclaimed, readable without the lock.
+	std::mutex mutex;
+	std::condition_variable finished;
+	std::unordered_map<uint64_t, uint32_t> states;
+	std::unordered_set<uint64_t> unclaimed; // Cancelled while queued, and not yet taken out of the queue.
+	std::deque<uint64_t> history; // Finished ids, oldest first. Forgotten past history_limit.
+	sc_utterance_callback callback = nullptr;
+	void* userdata = nullptr;
+
+	static constexpr size_t history_limit = 4096;
+
+// A cancelled utterance no longer counts as pending, but its message may still be queued: begin has to refuse it.
+	bool busy() const { return pending.load(std::memory_order_relaxed) != 0 || unclaimed_count.load(std::memory_order_relaxed) != 0; }
+	bool transition_begin(uint64_t id);
+	void finish_dispatch(uint64_t id, bool spoken, bool reports_end);
+	void finish(uint64_t id, uint32_t state, uint32_t expected);
+// Requires the lock. Returns whether the state changed.
+	bool settle(uint64_t id, uint32_t& current, uint32_t state);
+// Requires the lock. Returns whether the utterance was cancelled while queued.
+	bool claim(uint64_t id);
+	void notify(uint64_t id, uint32_t state);
+};
+
+extern UtteranceTracker utterances;
@@ -1,19 +1,16 @@
 #include "AVTts.h"
 #include <algorithm>
-#include <codecvt>
-#include <locale>
 #include <string>
 #include <vector>
+#include "../SCCore/Transcode.h"
 
 namespace utils {
     std::wstring convertToWide(const std::string& str) {
-        std::wstring_convert<std::codecvt_utf8_utf16<wchar_t>> converter;
-        return converter.from_bytes(str);
+        return transcode::wide_string(str.data(), str.size());
     }
 
     std::string convertToUTF8(const wchar_t* text) {
-        std::wstring_convert<std::codecvt_utf8_utf16<wchar_t>> converter;
-        return converter.to_bytes(text);
+        return transcode::utf8_string(text);
     }
 }
 
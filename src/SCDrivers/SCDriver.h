@@ -1,11 +1,54 @@
 // ScreenReader abstract class. Override this class to implement new screen readers.
 #pragma once
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <cwchar>
+#include <thread>
 #include "../../include/SpeechCore.h"
+#include "../SCCore/Transcode.h"
+
+// A single utterance as handed to ScreenReader::speak_request. The text comes as wchar_t or as UTF-8, whichever
+// the caller had, and is only converted once a driver asks for the other form through wide() or narrow().
+struct speech_request {
+	const wchar_t* text; // Null when the text came as UTF-8.
+	uint32_t priority = SC_PRIORITY_NORMAL;
+	size_t length = SC_TEXT_TERMINATED; // In code units of text or utf8.
+	const char* utf8 = nullptr;
+	bool terminated = true; // Whether a terminator follows the length code units.
+
+	size_t count() const {
+		if (length != SC_TEXT_TERMINATED) {
+			return length;
+		}
+		return utf8 ? strlen(utf8) : wcslen(text);
+	}
+// The text as a terminated wchar_t string. A conversion or copy lives in the calling thread's transcode buffer.
+	const wchar_t* wide() const {
+		if (utf8) {
+			return transcode::to_wide(utf8, count(), nullptr);
+		}
+		return terminated ? text : transcode::terminated(text, length);
+	}
+// The text as terminated UTF-8, size receives its length in bytes. Same buffer rules as wide().
+	const char* narrow(size_t* size) const {
+		if (!utf8) {
+			return transcode::to_utf8(text, count(), size);
+		}
+		if (!terminated) {
+			*size = length;
+			return transcode::terminated(utf8, length);
+		}
+		*size = count();
+		return utf8;
+	}
+};
 
 class ScreenReader {
 protected:
 	const wchar_t* screen_reader_name;
-	uint32_t speech_flags; // These flags indicate the abilities of the screen reader.
+	std::atomic<uint32_t> speech_flags; // These flags indicate the abilities of the screen reader. Some drivers only learn them once connected, on their own threads.
+	std::atomic<uint32_t> last_priority{ SC_PRIORITY_CRITICAL }; // Class of the last request spoken through the emulation below.
 
 public:
 	ScreenReader(const wchar_t* name, uint32_t flags = 0):
@@ -23,7 +66,44 @@ public:
 	virtual bool is_speaking() = 0;
 
 	virtual bool speak_text(const wchar_t* text,bool interrupt=false) =0;
+// Speaks a request with a priority class. Override when the screen reader has native priorities.
+// The default emulates them with interrupt, see the SC_PRIORITY_* values for the semantics.
+// Low and progress speech can only be dropped while speaking if the driver has SC_HAS_SPEECH_STATE. Without it,
+// the class of the last request stands in for whatever may still be speaking.
+	virtual bool speak_request(const speech_request& request) {
+		bool has_state = (speech_flags.load(std::memory_order_relaxed) & SC_HAS_SPEECH_STATE) != 0;
+		bool speaking = has_state && is_speaking();
+		if (request.priority >= SC_PRIORITY_LOW && speaking) {
+			return true; // Dropped, like speech-dispatcher does for notifications.
+		}
+		uint32_t previous = last_priority.exchange(request.priority, std::memory_order_relaxed);
+		bool preempts = (speaking || !has_state) && ((previous >= SC_PRIORITY_NORMAL && request.priority < previous)
+			|| (request.priority == SC_PRIORITY_PROGRESS && previous == SC_PRIORITY_PROGRESS));
+		return speak_text(request.wide(), request.priority == SC_PRIORITY_CRITICAL || preempts);
+	}
 	virtual bool stop_speech() =0;
+// Blocks until the driver finished speaking or the timeout elapsed, and returns whether it finished.
+// The default polls is_speaking(), drivers with speech events override it to wait on them.
+// Without SC_HAS_SPEECH_STATE there is nothing to wait for and it returns true right away.
+	virtual bool wait_until_done(uint32_t timeout_ms) {
+		if (!(speech_flags.load(std::memory_order_relaxed) & SC_HAS_SPEECH_STATE)) {
+			return true;
+		}
+		auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms);
+		while (is_speaking()) {
+			if (std::chrono::steady_clock::now() >= deadline) {
+				return false;
+			}
+			std::this_thread::sleep_for(std::chrono::milliseconds(10));
+		}
+		return true;
+	}
+// Whether the driver calls UtteranceTracker::speech_ended once an utterance finished speaking.
+// Otherwise an utterance counts as done as soon as speak_text returned.
+	virtual bool reports_end() const { return false; }
+// Whether the engine synthesizes a whole request before any of it plays. Long text then reaches speak_request
+// in segments, each one queued behind the one before, see Segmenter.
+	virtual bool synthesizes_whole() const { return false; }
 	virtual bool output_braille(const wchar_t* text) { return false; }
 	virtual void output_file(const char* filePath, const wchar_t* text) {}
 
@@ -43,5 +123,5 @@ public:
 
 // Default methods for retrieving screen reader info.
 	const wchar_t* get_name() const { return this->screen_reader_name; }
-	uint32_t get_speech_flags() const { return this->speech_flags; }
+	uint32_t get_speech_flags() const { return this->speech_flags.load(std::memory_order_relaxed); }
 };
\ No newline at end of file
@@ -2,24 +2,217 @@
 #include "SpeechDispatcher.h"
 #if defined(__linux__) || defined(__unix__)
 #include <dlfcn.h>
+#include <poll.h>
 #endif // __linux__ || __unix__
 
 #include <cstring>
 #include <cwchar>
 #include <vector>
+#include "../SCCore/Tracer.h"
+#include "../SCCore/Utterances.h"
 
-SpeechDispatcher::SpeechDispatcher()
+std::atomic<SpeechDispatcher*> SpeechDispatcher::current_instance{ nullptr };
+
+// SC_PRIORITY_* value -> SSIP priority name, for the in-tree client.
+static const char* const ssip_priorities[] = { "text", "important", "message", "text", "notification", "progress" };
+
+// Replies to GET carry the value on their data line. Waited for without link_mutex, the reader thread fills it in.
+static bool ssip_value(const SsipClient::reply_handle& reply, int& value) {
+    std::vector<std::string> lines;
+    if (SsipClient::await_reply(reply, &lines, 1000) / 100 != 2 || lines.empty()) {
+        return false;
+    }
+    value = atoi(lines[0].c_str());
+    return true;
+}
+
+SpeechDispatcher::SpeechDispatcher(bool _native_ssip)
     : ScreenReader(L"Speech Dispatcher", SC_HAS_SPEECH | SC_SPEECH_PARAMETER_CONTROL),
-    speech_connection(nullptr), lib_handle(nullptr) {}
+    speech_connection(nullptr), lib_handle(nullptr), native_ssip(_native_ssip), link_up(false), recovering(false),
+    stopping(false), notifications(false), unacknowledged(0), speaking(false), paused(false) {}
 
 SpeechDispatcher::~SpeechDispatcher() {
     release();
 }
 
 void SpeechDispatcher::init() {
+    std::lock_guard<std::mutex> lock(link_mutex);
+    stopping = false;
+    link_up.store(open_connection(), std::memory_order_release);
+}
+
+void SpeechDispatcher::release() {
+    {
+        std::lock_guard<std::mutex> lock(link_mutex);
+        stopping = true;
+        recovering = false;
+        link_up.store(false, std::memory_order_release);
+    }
+    link_changed.notify_all();
+    if (reconnector.joinable()) {
+        reconnector.join();
+    }
+    // Closing fails the replies the SSIP client still awaited, so nothing is left unacknowledged below.
+    close_connection();
+    report_list reports;
+    {
+        std::lock_guard<std::mutex> lock(link_mutex);
+        drop_held(reports);
+    }
+    // Kept while reconnecting, held messages are still waited for.
+    notifications = false;
+    speech_flags.fetch_and(~SC_HAS_SPEECH_STATE, std::memory_order_relaxed);
+    clear_state(reports);
+    report_all(reports);
+    if (lib_handle) {
+        dlclose(lib_handle);
+        lib_handle = nullptr;
+    }
+}
+
+// Also how a lost connection is noticed when nothing is spoken: the health monitor calls this periodically.
+bool SpeechDispatcher::is_running() {
+    if (!link_up.load(std::memory_order_acquire)) {
+        return false;
+    }
+    report_list reports;
+    bool running;
+    {
+        std::lock_guard<std::mutex> lock(link_mutex);
+        if (link_up.load(std::memory_order_relaxed) && !connection_alive()) {
+            connection_lost(reports);
+        }
+        running = link_up.load(std::memory_order_relaxed);
+    }
+    report_all(reports);
+    return running;
+}
+
+bool SpeechDispatcher::is_speaking() {
+    return speaking.load(std::memory_order_acquire);
+}
+
+bool SpeechDispatcher::wait_until_done(uint32_t timeout_ms) {
+    if (!notifications) {
+        return ScreenReader::wait_until_done(timeout_ms);
+    }
+    std::unique_lock<std::mutex> lock(state_mutex);
+    return idle.wait_for(lock, std::chrono::milliseconds(timeout_ms), [this] {
+        return outstanding.empty() && unacknowledged == 0 && held.empty();
+    });
+}
+
+bool SpeechDispatcher::speak_text(const wchar_t* text, bool interrupt) {
+    return speak_request({ text, static_cast<uint32_t>(interrupt ? SC_PRIORITY_CRITICAL : SC_PRIORITY_NORMAL) });
+}
+
+// While the connection is down the message is held and counts as spoken, it goes out once reconnected.
+bool SpeechDispatcher::speak_request(const speech_request& request) {
+    // UTF-8 requests come through untouched, wchar_t ones are converted here.
+    size_t length;
+    const char* utf8_text = request.narrow(&length);
+
+    uint64_t utterance = Tracer::current_utterance();
+    report_list reports;
+    bool spoken = false;
+    {
+        std::lock_guard<std::mutex> lock(link_mutex);
+        // The SSIP client knows for free whether its socket is still open, libspeechd only tells by failing.
+        if (link_up.load(std::memory_order_relaxed) && ssip && !ssip->is_connected()) {
+            connection_lost(reports);
+        }
+        if (link_up.load(std::memory_order_relaxed)) {
+            spoken = send_message(utf8_text, length, request.priority, utterance, reports);
+            if (!spoken && !connection_alive()) {
+                connection_lost(reports);
+            }
+        }
+        if (!spoken && recovering) {
+            hold(utf8_text, length, request.priority, utterance, reports);
+            spoken = true;
+        }
+    }
+    report_all(reports);
+    return spoken;
+}
+
+bool SpeechDispatcher::stop_speech() {
+    report_list reports;
+    bool stopped;
+    {
+        std::lock_guard<std::mutex> lock(link_mutex);
+        // Held messages were never spoken, stopping just drops them.
+        drop_held(reports);
+        stopped = link_up.load(std::memory_order_relaxed) ? stop_connection() : recovering;
+    }
+    report_all(reports);
+    return stopped;
+}
+
+float SpeechDispatcher::get_volume() const {
+    SsipClient::reply_handle reply;
+    {
+        std::lock_guard<std::mutex> lock(link_mutex);
+        if (!link_up.load(std::memory_order_relaxed)) {
+            return volume_setting ? static_cast<float>(*volume_setting) / 100.0f : 0.0f;
+        }
+        if (!ssip) {
+            return static_cast<float>(spd_get_volume(speech_connection)) / 100.0f;
+        }
+        reply = ssip->send_request("GET VOLUME");
+    }
+    int volume = 0;
+    return ssip_value(reply, volume) ? static_cast<float>(volume) / 100.0f : 0.0f;
+}
+
+void SpeechDispatcher::set_volume(float offset) {
+    int volume = static_cast<int>(offset * 100.0f);
+    std::lock_guard<std::mutex> lock(link_mutex);
+    volume_setting = volume;
+    if (!link_up.load(std::memory_order_relaxed)) {
+        return;
+    }
+    if (ssip) {
+        ssip->set_parameter("VOLUME", volume);
+        return;
+    }
+    spd_set_volume(speech_connection, volume);
+}
+
+float SpeechDispatcher::get_rate() const {
+    SsipClient::reply_handle reply;
+    {
+        std::lock_guard<std::mutex> lock(link_mutex);
+        if (!link_up.load(std::memory_order_relaxed)) {
+            return rate_setting ? static_cast<float>(*rate_setting) / 100.0f : 0.0f;
+        }
+        if (!ssip) {
+            return static_cast<float>(spd_get_voice_rate(speech_connection)) / 100.0f;
+        }
+        reply = ssip->send_request("GET RATE");
+    }
+    int rate = 0;
+    return ssip_value(reply, rate) ? static_cast<float>(rate) / 100.0f : 0.0f;
+}
+
+void SpeechDispatcher::set_rate(float offset) {
+    int rate = static_cast<int>(offset * 100.0f);
+    std::lock_guard<std::mutex> lock(link_mutex);
+    rate_setting = rate;
+    if (!link_up.load(std::memory_order_relaxed)) {
+        return;
+    }
+    if (ssip) {
+        ssip->set_parameter("RATE", rate);
+        return;
+    }
+    spd_set_voice_rate(speech_connection, rate);
+}
+
+bool SpeechDispatcher::load_library() {
     lib_handle = dlopen("libspeechd.so", RTLD_LAZY);
     if (!lib_handle) {
-        return;
+        return false;
     }
 
     load_function(spd_get_default_address, "spd_get_default_address");
@@ -31,6 +224,18 @@ void SpeechDispatcher::init() {
     load_function(spd_get_volume, "spd_get_volume");
     load_function(spd_set_voice_rate, "spd_set_voice_rate");
     load_function(spd_get_voice_rate, "spd_get_voice_rate");
+    load_function(spd_set_notification_on, "spd_set_notification_on");
+    return true;
+}
+
+// Used for the first connection and every reconnect. libspeechd is only loaded once the SSIP client is not used.
+bool SpeechDispatcher::open_connection() {
+    if (native_ssip && connect_native()) {
+        return true;
+    }
+    if (!lib_handle && !load_library()) {
+        return false;
+    }
 
     if (spd_get_default_address && spd_open2) {
         const auto* address = spd_get_default_address(nullptr);
@@ -38,65 +243,317 @@ void SpeechDispatcher::init() {
             speech_connection = spd_open2("SPEECH_C", nullptr, nullptr, SPD_MODE_THREADED, address, true, nullptr);
         }
     }
+
+    // The connection is threaded, so events arrive on libspeechd's own thread. Its callbacks carry no user data.
+    if (speech_connection && spd_set_notification_on) {
+        current_instance.store(this, std::memory_order_release);
+        speech_connection->callback_begin = on_event;
+        speech_connection->callback_end = on_event;
+        speech_connection->callback_cancel = on_event;
+        speech_connection->callback_pause = on_event;
+        speech_connection->callback_resume = on_event;
+        notifications = spd_set_notification_on(speech_connection, SPD_BEGIN) == 0
+            && spd_set_notification_on(speech_connection, SPD_END) == 0
+            && spd_set_notification_on(speech_connection, SPD_CANCEL) == 0
+            && spd_set_notification_on(speech_connection, SPD_PAUSE) == 0
+            && spd_set_notification_on(speech_connection, SPD_RESUME) == 0;
+        if (notifications) {
+            speech_flags.fetch_or(SC_HAS_SPEECH_STATE, std::memory_order_relaxed);
+        }
+    }
+    return speech_connection != nullptr;
 }
 
-void SpeechDispatcher::release() {
+void SpeechDispatcher::close_connection() {
+    if (ssip) {
+        ssip->close();
+        ssip.reset();
+    }
     if (speech_connection) {
         spd_close(speech_connection);
         speech_connection = nullptr;
     }
-    if (lib_handle) {
-        dlclose(lib_handle);
-        lib_handle = nullptr;
+    SpeechDispatcher* self = this;
+    current_instance.compare_exchange_strong(self, nullptr, std::memory_order_acq_rel);
+}
+
+// Requires link_mutex.
+bool SpeechDispatcher::connection_alive() {
+    if (ssip) {
+        return ssip->is_connected();
+    }
+    if (!speech_connection) {
+        return false;
     }
+    // libspeechd's own thread reads the socket, so only look for the hangup without consuming anything.
+    pollfd descriptor{ speech_connection->socket, POLLRDHUP, 0 };
+    return poll(&descriptor, 1, 0) == 0 || (descriptor.revents & (POLLRDHUP | POLLHUP | POLLERR | POLLNVAL)) == 0;
 }
 
-bool SpeechDispatcher::is_running() {
-    return speech_connection != nullptr;
+// Requires link_mutex. Whatever was in flight on the old connection is lost with it.
+void SpeechDispatcher::connection_lost(report_list& reports) {
+    link_up.store(false, std::memory_order_release);
+    recovering = true;
+    clear_state(reports);
+    if (!reconnector.joinable()) {
+        reconnector = std::thread(&SpeechDispatcher::reconnect_loop, this);
+    }
+    link_changed.notify_all();
 }
 
-bool SpeechDispatcher::is_speaking() {
-    return false;
+// Requires link_mutex. The SC_PRIORITY_* values are speech-dispatcher's own classes, so they are passed through as is.
+bool SpeechDispatcher::send_message(const char* text, size_t length, uint32_t priority, uint64_t utterance, report_list& reports) {
+    if (priority == SC_PRIORITY_CRITICAL) {
+        stop_connection();
+    }
+    if (ssip) {
+        return speak_native(std::string_view(text, length), priority, utterance);
+    }
+
+    // spd_say returns the message id on success.
+    int message = spd_say(speech_connection, static_cast<SPDPriority>(priority), text);
+    if (message == -1) {
+        return false;
+    }
+    if (notifications) {
+        std::lock_guard<std::mutex> lock(state_mutex);
+        auto it = finished_early.find(static_cast<size_t>(message));
+        if (it != finished_early.end()) {
+            reports.emplace_back(utterance, it->second);
+            finished_early.erase(it);
+        }
+        else {
+            outstanding[static_cast<size_t>(message)] = utterance;
+            speaking.store(!paused, std::memory_order_release);
+        }
+    }
+    return true;
 }
 
-bool SpeechDispatcher::speak_text(const wchar_t* text, bool interrupt) {
-    if (!speech_connection) return false;
+// Requires link_mutex.
+bool SpeechDispatcher::stop_connection() {
+    if (ssip) return ssip->command("STOP SELF");
+    return spd_stop(speech_connection) == 0;
+}
 
-    std::vector<char> utf8_text(wcslen(text) * 4 + 1);
-    wcstombs(utf8_text.data(), text, utf8_text.size());
+// Requires link_mutex. Bounded like the startup buffer: the oldest message goes when full, a critical one replaces all.
+void SpeechDispatcher::hold(const char* text, size_t length, uint32_t priority, uint64_t utterance, report_list& reports) {
+    if (priority == SC_PRIORITY_CRITICAL) {
+        drop_held(reports);
+    }
+    std::lock_guard<std::mutex> lock(state_mutex);
+    if (held.size() >= held_limit) {
+        reports.emplace_back(held.front().utterance, SPD_EVENT_CANCEL);
+        held.pop_front();
+    }
+    held.push_back({ std::string(text, length), priority, utterance });
+}
 
-    if (interrupt) {
-        stop_speech();
+// Requires link_mutex.
+void SpeechDispatcher::drop_held(report_list& reports) {
+    {
+        std::lock_guard<std::mutex> lock(state_mutex);
+        for (const held_message& message : held) {
+            reports.emplace_back(message.utterance, SPD_EVENT_CANCEL);
+        }
+        held.clear();
     }
+    idle.notify_all();
+}
 
-    return spd_say(speech_connection, interrupt ? SPD_IMPORTANT : SPD_TEXT, utf8_text.data()) == 0;
+// Requires link_mutex, with a new connection open. Restores the settings, then sends what was held in order.
+// Stops at the first failure, the rest stays held for the next attempt.
+bool SpeechDispatcher::replay(report_list& reports) {
+    if (volume_setting) {
+        ssip ? ssip->set_parameter("VOLUME", *volume_setting) : void(spd_set_volume(speech_connection, *volume_setting));
+    }
+    if (rate_setting) {
+        ssip ? ssip->set_parameter("RATE", *rate_setting) : void(spd_set_voice_rate(speech_connection, *rate_setting));
+    }
+    while (true) {
+        held_message message;
+        {
+            std::lock_guard<std::mutex> lock(state_mutex);
+            if (held.empty()) {
+                break;
+            }
+            message = held.front();
+        }
+        if (!send_message(message.text.c_str(), message.text.size(), message.priority, message.utterance, reports)) {
+            return false;
+        }
+        std::lock_guard<std::mutex> lock(state_mutex);
+        held.pop_front();
+    }
+    idle.notify_all();
+    return true;
 }
 
-bool SpeechDispatcher::stop_speech() {
-    if (!speech_connection) return false;
-    return spd_stop(speech_connection) == 0;
+// Started on the first loss and kept until release(). While recovering it waits backoff_min_ms before the first
+// attempt and doubles the wait after every failed one, up to backoff_max_ms, so a restarting daemon is picked up
+// quickly without being hammered while it is gone for longer.
+void SpeechDispatcher::reconnect_loop() {
+    std::unique_lock<std::mutex> lock(link_mutex);
+    while (!stopping) {
+        link_changed.wait(lock, [this] { return stopping || recovering; });
+        uint32_t delay_ms = backoff_min_ms;
+        while (recovering && !stopping) {
+            if (link_changed.wait_for(lock, std::chrono::milliseconds(delay_ms), [this] { return stopping; })) {
+                break;
+            }
+            // Speakers only hold messages while the link is down, so the connection can change without the lock.
+            lock.unlock();
+            close_connection();
+            bool opened = open_connection();
+            lock.lock();
+            report_list reports;
+            if (opened && !stopping && replay(reports)) {
+                recovering = false;
+                link_up.store(true, std::memory_order_release);
+            }
+            else {
+                delay_ms = (delay_ms * 2 < backoff_max_ms) ? delay_ms * 2 : backoff_max_ms;
+            }
+            if (!reports.empty()) {
+                lock.unlock();
+                report_all(reports);
+                lock.lock();
+            }
+        }
+    }
 }
 
-float SpeechDispatcher::get_volume() const {
-    if (!speech_connection) return 0.0f;
-    return static_cast<float>(spd_get_volume(speech_connection)) / 100.0f;
+void SpeechDispatcher::on_event(size_t msg_id, size_t client_id, SPDNotificationType type) {
+    SpeechDispatcher* instance = current_instance.load(std::memory_order_acquire);
+    if (instance) {
+        instance->handle_event(msg_id, type);
+    }
 }
 
-void SpeechDispatcher::set_volume(float offset) {
-    if (!speech_connection) return;
-    int volume = static_cast<int>(offset * 100.0f);
-    spd_set_volume(speech_connection, volume);
+void SpeechDispatcher::handle_event(size_t msg_id, SPDNotificationType type) {
+    uint64_t utterance = 0;
+    bool finished = type == SPD_EVENT_END || type == SPD_EVENT_CANCEL;
+    {
+        std::lock_guard<std::mutex> lock(state_mutex);
+        auto it = outstanding.find(msg_id);
+        if (it != outstanding.end()) {
+            utterance = it->second;
+            if (finished) {
+                outstanding.erase(it);
+            }
+        }
+        else if (finished) {
+            // spd_say has not returned this id yet, it picks the event up from here.
+            if (finished_early.size() >= 256) {
+                finished_early.clear();
+            }
+            finished_early[msg_id] = type;
+            return;
+        }
+        if (type == SPD_EVENT_PAUSE || type == SPD_EVENT_RESUME) {
+            paused = type == SPD_EVENT_PAUSE;
+        }
+        speaking.store((!outstanding.empty() || unacknowledged != 0) && !paused, std::memory_order_release);
+    }
+    if (finished) {
+        idle.notify_all();
+    }
+    report(utterance, type);
 }
 
-float SpeechDispatcher::get_rate() const {
-    if (!speech_connection) return 0.0f;
-    return static_cast<float>(spd_get_voice_rate(speech_connection)) / 100.0f;
+void SpeechDispatcher::report(uint64_t utterance, SPDNotificationType type) {
+    switch (type) {
+    case SPD_EVENT_BEGIN:
+        utterances.speech_started(utterance, get_name());
+        break;
+    case SPD_EVENT_END:
+        // Priorities reorder messages and cancels are reported, so an end says nothing about older ones.
+        utterances.speech_finished(utterance, get_name());
+        break;
+    case SPD_EVENT_CANCEL:
+        utterances.speech_cancelled(utterance, get_name());
+        break;
+    default:
+        break;
+    }
 }
 
-void SpeechDispatcher::set_rate(float offset) {
-    if (!speech_connection) return;
-    int rate = static_cast<int>(offset * 100.0f);
-    spd_set_voice_rate(speech_connection, rate);
+void SpeechDispatcher::report_all(const report_list& reports) {
+    for (const auto& entry : reports) {
+        report(entry.first, entry.second);
+    }
+}
+
+// Speech still outstanding will never be reported on, it is cancelled.
+void SpeechDispatcher::clear_state(report_list& reports) {
+    {
+        std::lock_guard<std::mutex> lock(state_mutex);
+        for (const auto& entry : outstanding) {
+            reports.emplace_back(entry.second, SPD_EVENT_CANCEL);
+        }
+        outstanding.clear();
+        finished_early.clear();
+        unacknowledged = 0;
+        paused = false;
+        speaking.store(false, std::memory_order_release);
+    }
+    idle.notify_all();
+}
+
+bool SpeechDispatcher::connect_native() {
+    ssip = std::make_unique<SsipClient>();
+    bool connected = ssip->connect("", "SPEECH_C", [this](size_t msg_id, int code) {
+        static const SPDNotificationType types[] = { SPD_EVENT_BEGIN, SPD_EVENT_END, SPD_EVENT_CANCEL, SPD_EVENT_PAUSE, SPD_EVENT_RESUME };
+        if (code >= 701 && code <= 705) {
+            handle_event(msg_id, types[code - 701]);
+        }
+    });
+    // The round trip also makes sure speech-dispatcher is really listening before libspeechd is skipped.
+    int code = connected ? ssip->request("SET SELF NOTIFICATION ALL on", nullptr, 1000) : -1;
+    if (code < 0) {
+        ssip.reset();
+        return false;
+    }
+    notifications = code / 100 == 2;
+    if (notifications) {
+        speech_flags.fetch_or(SC_HAS_SPEECH_STATE, std::memory_order_relaxed);
+    }
+    return true;
+}
+
+// The message id only arrives with the reply, acknowledge() maps it to the utterance. Events for a message always
+// follow its reply on the socket, so they never need finished_early.
+bool SpeechDispatcher::speak_native(std::string_view text, uint32_t priority, uint64_t utterance) {
+    const char* name = ssip_priorities[(priority <= SC_PRIORITY_PROGRESS) ? priority : 0];
+    if (!notifications) {
+        return ssip->speak(text, name, nullptr);
+    }
+    {
+        std::lock_guard<std::mutex> lock(state_mutex);
+        unacknowledged++;
+        speaking.store(!paused, std::memory_order_release);
+    }
+    return ssip->speak(text, name, [this, utterance](int code, const std::vector<std::string>& lines) {
+        acknowledge(code, lines, utterance);
+    });
+}
+
+void SpeechDispatcher::acknowledge(int code, const std::vector<std::string>& lines, uint64_t utterance) {
+    bool queued = code / 100 == 2 && !lines.empty();
+    {
+        std::lock_guard<std::mutex> lock(state_mutex);
+        if (unacknowledged > 0) {
+            unacknowledged--;
+        }
+        if (queued) {
+            outstanding[static_cast<size_t>(strtoull(lines[0].c_str(), nullptr, 10))] = utterance;
+        }
+        speaking.store((!outstanding.empty() || unacknowledged != 0) && !paused, std::memory_order_release);
+    }
+    if (!queued) {
+        idle.notify_all();
+        utterances.dispatched(utterance, false, true);
+    }
 }
 
 template<typename T>
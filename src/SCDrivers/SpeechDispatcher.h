@@ -1,10 +1,24 @@
 #pragma once
 #include "SCDriver.h"
+#include "../wrappers/SsipClient.h"
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
 #include <speech-dispatcher/libspeechd.h>
 
 class SpeechDispatcher : public ScreenReader {
 public:
-    SpeechDispatcher();
+    // With native_ssip the driver talks SSIP to the socket itself and only falls back to libspeechd when that fails.
+    explicit SpeechDispatcher(bool native_ssip = false);
     virtual ~SpeechDispatcher();
 
     void init() override;
@@ -12,7 +26,10 @@ public:
     bool is_running() override;
     bool is_speaking() override;
     bool speak_text(const wchar_t* text, bool interrupt = false) override;
+    bool speak_request(const speech_request& request) override;
     bool stop_speech() override;
+    bool wait_until_done(uint32_t timeout_ms) override;
+    bool reports_end() const override { return notifications; }
     float get_volume() const override;
     void set_volume(float offset) override;
     float get_rate() const override;
@@ -21,6 +38,62 @@ public:
 private:
     SPDConnection* speech_connection;
     void* lib_handle;
+    bool native_ssip;
+    std::unique_ptr<SsipClient> ssip; // Set while connected through the in-tree client instead of libspeechd.
+
+    // Connection recovery. When speech-dispatcher goes away, a background thread reconnects with exponential backoff
+    // and messages spoken meanwhile are held, then sent in order once the connection is back.
+    // link_mutex guards the connection while it is up; while it is down only the reconnect thread touches it.
+    struct held_message {
+        std::string text;
+        uint32_t priority;
+        uint64_t utterance;
+    };
+    using report_list = std::vector<std::pair<uint64_t, SPDNotificationType>>; // Reported once no lock is held.
+    mutable std::mutex link_mutex;
+    std::condition_variable link_changed;
+    std::atomic<bool> link_up;
+    bool recovering; // Lost and not given up on, messages are held.
+    bool stopping;
+    std::thread reconnector;
+    std::optional<int> volume_setting; // Restored on a new connection.
+    std::optional<int> rate_setting;
+    static constexpr size_t held_limit = 64;
+    static constexpr uint32_t backoff_min_ms = 100;
+    static constexpr uint32_t backoff_max_ms = 5000;
+
+    // Speech state maintained from the SSIP events delivered on libspeechd's thread.
+    std::atomic<bool> notifications; // Whether begin/end/cancel/pause/resume events were enabled.
+    std::mutex state_mutex;
+    std::condition_variable idle;
+    std::unordered_map<size_t, uint64_t> outstanding; // Message id -> utterance id, for speech not finished yet.
+    std::unordered_map<size_t, SPDNotificationType> finished_early; // Events that beat spd_say returning the message id.
+    size_t unacknowledged; // Messages written by the SSIP client whose id has not come back yet.
+    std::deque<held_message> held; // Written to with link_mutex held as well, so replaying is never interleaved.
+    std::atomic<bool> speaking;
+    bool paused;
+
+    static std::atomic<SpeechDispatcher*> current_instance;
+    static void on_event(size_t msg_id, size_t client_id, SPDNotificationType type);
+    void handle_event(size_t msg_id, SPDNotificationType type);
+    void report(uint64_t utterance, SPDNotificationType type);
+    void report_all(const report_list& reports);
+    void clear_state(report_list& reports);
+    bool load_library();
+    bool open_connection();
+    void close_connection();
+    // These require link_mutex.
+    bool connection_alive();
+    void connection_lost(report_list& reports);
+    bool send_message(const char* text, size_t length, uint32_t priority, uint64_t utterance, report_list& reports);
+    bool stop_connection();
+    void hold(const char* text, size_t length, uint32_t priority, uint64_t utterance, report_list& reports);
+    void drop_held(report_list& reports);
+    bool replay(report_list& reports);
+    void reconnect_loop();
+    bool connect_native();
+    bool speak_native(std::string_view text, uint32_t priority, uint64_t utterance);
+    void acknowledge(int code, const std::vector<std::string>& lines, uint64_t utterance);
 
     // Function pointers for dynamically loaded library functions
     SPDConnectionAddress* (*spd_get_default_address)(char**);
@@ -32,6 +105,7 @@ private:
     int (*spd_get_volume)(SPDConnection*);
     int (*spd_set_voice_rate)(SPDConnection*, signed int);
     int (*spd_get_voice_rate)(SPDConnection*);
+    int (*spd_set_notification_on)(SPDConnection*, SPDNotification);
 
     // Helper function to load library functions
     template<typename T>
@@ -1,4 +1,5 @@
 #pragma once
+#include "loopback.h"
 #ifdef _WIN32
 #include "jaws.h"
 #include "nvda.h"
@@ -14,30 +14,58 @@ ScreenReaderJaws::~ScreenReaderJaws() {
 	this->release();
 	}
 	void ScreenReaderJaws::init() {
-		auto result = CoInitializeEx(NULL, COINIT_MULTITHREADED);
-		if (FAILED(result)) {
-			CoUninitialize();
+		if (!this->apartment.joinable()) {
+			this->apartment_ready = false;
+			this->apartment_leaving = false;
+			this->apartment = std::thread(&ScreenReaderJaws::run_apartment, this);
+			std::unique_lock<std::mutex> lock(this->apartment_mutex);
+			this->apartment_changed.wait(lock, [this] { return this->apartment_ready; });
 		}
-		if (!this->loaded || this->module == nullptr) {
-			auto res = CoCreateInstance(CLSID_JawsApi, NULL, CLSCTX_ALL, IID_IJawsApi, (void**)&this->module);
-			if (SUCCEEDED(res)) {
-				this->loaded = true;
-}
-			if (this->loaded && !this->Is_Active) {
-				this->is_running();
-}
+		if (!this->loaded) {
+			this->apartment.join(); // JAWS is not installed, the thread already left COM. A later init tries again.
+			return;
+		}
+		if (!this->Is_Active) {
+			this->is_running();
+		}
+	}
+
+	void ScreenReaderJaws::run_apartment() {
+		HRESULT initialized = CoInitializeEx(NULL, COINIT_MULTITHREADED);
+		IJawsApi* created = nullptr;
+		if (SUCCEEDED(initialized) && FAILED(CoCreateInstance(CLSID_JawsApi, NULL, CLSCTX_ALL, IID_IJawsApi, (void**)&created))) {
+			created = nullptr;
+		}
+		{
+			std::lock_guard<std::mutex> lock(this->apartment_mutex);
+			this->module = created;
+			this->loaded = created != nullptr;
+			this->apartment_ready = true;
+		}
+		this->apartment_changed.notify_all();
+		if (created != nullptr) {
+			std::unique_lock<std::mutex> lock(this->apartment_mutex);
+			this->apartment_changed.wait(lock, [this] { return this->apartment_leaving; });
+			VARIANT_BOOL bool_var;
+			created->Disable(&bool_var);
+			created->Release();
+		}
+		if (SUCCEEDED(initialized)) {
+			CoUninitialize();
 		}
 	}
 
 	void ScreenReaderJaws::release() {
 		this->loaded = false;
 		this->Is_Active = false;
-		if (this->module != nullptr) {
-			VARIANT_BOOL bool_var;
-			this->module->Disable(&bool_var);
-			this->module->Release();
-			this->module = nullptr;
-			CoUninitialize();
+		if (this->apartment.joinable()) {
+			{
+				std::lock_guard<std::mutex> lock(this->apartment_mutex);
+				this->module = nullptr;
+				this->apartment_leaving = true;
+			}
+			this->apartment_changed.notify_all();
+			this->apartment.join();
 		}
 	}
 
@@ -1,6 +1,9 @@
 #pragma once
 #include <Windows.h>
 #include <comdef.h>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
 #include "SCDriver.h"
 #include "../ThirdParty/fsapi.h"
 #ifdef _WIN64
@@ -14,6 +17,14 @@ private:
 	IJawsApi* module;
 	bool loaded;
 	bool Is_Active;
+	// COM is initialized, the API object created and released, and COM uninitialized again on this one thread, which
+	// stays in the multithreaded apartment from init to release. init() may run on a short lived loader thread, and
+	// release() on whichever thread calls Speech_Free, so neither can own the apartment.
+	std::thread apartment;
+	std::mutex apartment_mutex;
+	std::condition_variable apartment_changed;
+	bool apartment_ready = false;
+	bool apartment_leaving = false;
 
 public:
 	ScreenReaderJaws();
@@ -29,4 +40,5 @@ public:
 
 private:
     bool run_jaws_function(const wchar_t* functionName);
+	void run_apartment();
 };
\ No newline at end of file
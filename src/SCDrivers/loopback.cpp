@@ -0,0 +1,163 @@
+#include "loopback.h"
+#include "../SCCore/HealthMonitor.h"
+#include "../SCCore/Tracer.h"
+#include "../SCCore/Utterances.h"
+#include <cwchar>
+#include <thread>
+
+ScreenReaderLoopback::ScreenReaderLoopback() :
+	ScreenReader(L"Loopback", SC_HAS_SPEECH | SC_HAS_SPEECH_STATE) {
+}
+
+ScreenReaderLoopback::~ScreenReaderLoopback() {
+	release();
+}
+
+void ScreenReaderLoopback::init() {
+	reset();
+}
+
+void ScreenReaderLoopback::release() {
+}
+
+bool ScreenReaderLoopback::is_running() {
+	clock::time_point start = clock::now();
+	simulate(draw_delay_us(SC_LOOPBACK_IS_RUNNING));
+	// Background probes come at any time, recording them would make the records depend on timing.
+	if (!HealthMonitor::on_monitor_thread()) {
+		record(SC_LOOPBACK_IS_RUNNING, false, start, nullptr);
+	}
+	return true;
+}
+
+bool ScreenReaderLoopback::is_speaking() {
+	std::lock_guard<std::mutex> guard(lock);
+	return clock::now() < speaking_until;
+}
+
+bool ScreenReaderLoopback::speak_text(const wchar_t* text, bool interrupt) {
+	clock::time_point start = clock::now();
+	// Synthesis blocks the call for the whole text, playback below does not.
+	uint64_t synthesis_us = static_cast<uint64_t>(synthesis_rate_us.load(std::memory_order_relaxed)) * wcslen(text);
+	simulate(draw_delay_us(SC_LOOPBACK_SPEAK) + synthesis_us);
+	record(SC_LOOPBACK_SPEAK, interrupt, start, text);
+	utterances.speech_started(Tracer::current_utterance(), get_name());
+	std::lock_guard<std::mutex> guard(lock);
+	// Queued speech starts once the current utterance is done, unless it interrupts it.
+	clock::time_point now = clock::now();
+	clock::time_point begin = (interrupt || speaking_until < now) ? now : speaking_until;
+	speaking_until = begin + std::chrono::microseconds(static_cast<uint64_t>(speech_rate_us) * wcslen(text));
+	return true;
+}
+
+bool ScreenReaderLoopback::stop_speech() {
+	clock::time_point start = clock::now();
+	simulate(draw_delay_us(SC_LOOPBACK_STOP));
+	record(SC_LOOPBACK_STOP, false, start, nullptr);
+	std::lock_guard<std::mutex> guard(lock);
+	speaking_until = clock::time_point();
+	return true;
+}
+
+bool ScreenReaderLoopback::synthesizes_whole() const {
+	return synthesis_rate_us.load(std::memory_order_relaxed) != 0;
+}
+
+bool ScreenReaderLoopback::set_latency(uint32_t call, uint32_t model, uint32_t a_us, uint32_t b_us) {
+	if (call >= SC_LOOPBACK_CALLS || model > SC_LATENCY_EXPONENTIAL) {
+		return false;
+	}
+	std::lock_guard<std::mutex> guard(lock);
+	latency[call] = { model, a_us, b_us };
+	return true;
+}
+
+void ScreenReaderLoopback::set_seed(uint64_t seed) {
+	std::lock_guard<std::mutex> guard(lock);
+	random.seed(seed);
+}
+
+void ScreenReaderLoopback::set_speech_rate(uint32_t us_per_char) {
+	std::lock_guard<std::mutex> guard(lock);
+	speech_rate_us = us_per_char;
+}
+
+void ScreenReaderLoopback::set_synthesis_rate(uint32_t us_per_char) {
+	synthesis_rate_us.store(us_per_char, std::memory_order_relaxed);
+}
+
+uint64_t ScreenReaderLoopback::get_calls(uint32_t call) {
+	std::lock_guard<std::mutex> guard(lock);
+	return (call < SC_LOOPBACK_CALLS) ? calls[call] : 0;
+}
+
+size_t ScreenReaderLoopback::get_records() {
+	std::lock_guard<std::mutex> guard(lock);
+	return records.size();
+}
+
+bool ScreenReaderLoopback::get_record(size_t index, sc_loopback_record* record) {
+	std::lock_guard<std::mutex> guard(lock);
+	if (record == nullptr || index >= records.size()) {
+		return false;
+	}
+	const call_record& source = records[index];
+	record->call = source.call;
+	record->interrupt = source.interrupt;
+	record->start_ns = source.start_ns;
+	record->end_ns = source.end_ns;
+	record->text = source.text.c_str();
+	return true;
+}
+
+void ScreenReaderLoopback::reset() {
+	std::lock_guard<std::mutex> guard(lock);
+	records.clear();
+	for (auto& count : calls) {
+		count = 0;
+	}
+	speaking_until = clock::time_point();
+}
+
+uint64_t ScreenReaderLoopback::draw_delay_us(uint32_t call) {
+	std::lock_guard<std::mutex> guard(lock);
+	const latency_model& model = latency[call];
+	switch (model.model) {
+	case SC_LATENCY_FIXED:
+		return model.a_us;
+	case SC_LATENCY_UNIFORM:
+		return (model.b_us > model.a_us) ? std::uniform_int_distribution<uint64_t>(model.a_us, model.b_us)(random) : model.a_us;
+	case SC_LATENCY_EXPONENTIAL:
+		return model.a_us + ((model.b_us > 0) ? static_cast<uint64_t>(std::exponential_distribution<double>(1.0 / model.b_us)(random)) : 0);
+	default:
+		return 0;
+	}
+}
+
+// Short delays are spun so they stay accurate, longer ones sleep.
+void ScreenReaderLoopback::simulate(uint64_t delay_us) {
+	if (delay_us == 0) {
+		return;
+	}
+	clock::time_point until = clock::now() + std::chrono::microseconds(delay_us);
+	if (delay_us >= 1000) {
+		std::this_thread::sleep_until(until);
+		return;
+	}
+	while (clock::now() < until) {
+		std::this_thread::yield();
+	}
+}
+
+void ScreenReaderLoopback::record(uint32_t call, bool interrupt, clock::time_point start, const wchar_t* text) {
+	uint64_t end_ns = to_ns(clock::now());
+	std::lock_guard<std::mutex> guard(lock);
+	calls[call]++;
+	if (records.size() < record_limit) {
+		records.push_back({ call, interrupt, to_ns(start), end_ns, text ? std::wstring(text) : std::wstring() });
+	}
+}
+
+uint64_t ScreenReaderLoopback::to_ns(clock::time_point time) {
+	return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(time.time_since_epoch()).count());
+}
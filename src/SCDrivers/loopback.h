@@ -0,0 +1,69 @@
+// Loopback driver. Speaks nowhere: every call is recorded with timestamps and delayed according to a
+// configurable latency model, so SpeechCore's own overhead can be measured without a speech stack.
+// Never picked by detection, select it with Speech_Set_Driver. Only registered in builds with SPEECHCORE_LOOPBACK,
+// and liveness probes from the health monitor are not recorded.
+#pragma once
+#include "SCDriver.h"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <random>
+#include <string>
+
+class ScreenReaderLoopback : public ScreenReader {
+public:
+	static constexpr size_t record_limit = 1 << 16; // Calls past this are still counted, but not recorded.
+
+	struct latency_model {
+		uint32_t model = SC_LATENCY_NONE;
+		uint32_t a_us = 0;
+		uint32_t b_us = 0;
+	};
+	struct call_record {
+		uint32_t call;
+		bool interrupt;
+		uint64_t start_ns;
+		uint64_t end_ns;
+		std::wstring text;
+	};
+
+	ScreenReaderLoopback();
+	~ScreenReaderLoopback();
+	void init() override;
+	void release() override;
+	bool is_running() override;
+	bool is_speaking() override;
+	bool speak_text(const wchar_t* text, bool interrupt = false) override;
+	bool stop_speech() override;
+// Only while a synthesis rate is set, the loopback driver then stands in for engines like SAPI.
+	bool synthesizes_whole() const override;
+
+	bool set_latency(uint32_t call, uint32_t model, uint32_t a_us, uint32_t b_us);
+	void set_seed(uint64_t seed);
+	void set_speech_rate(uint32_t us_per_char);
+	void set_synthesis_rate(uint32_t us_per_char);
+	uint64_t get_calls(uint32_t call);
+	size_t get_records();
+// Copies a record out. The text pointer stays valid until reset().
+	bool get_record(size_t index, sc_loopback_record* record);
+	void reset();
+
+private:
+	using clock = std::chrono::steady_clock;
+
+	std::mutex lock;
+	latency_model latency[SC_LOOPBACK_CALLS];
+	uint64_t calls[SC_LOOPBACK_CALLS] = {};
+	std::deque<call_record> records; // A deque keeps handed out text pointers stable while it grows.
+	std::mt19937_64 random;
+	uint32_t speech_rate_us = 0;
+	std::atomic<uint32_t> synthesis_rate_us{ 0 };
+	clock::time_point speaking_until;
+
+	uint64_t draw_delay_us(uint32_t call);
+	static void simulate(uint64_t delay_us);
+	void record(uint32_t call, bool interrupt, clock::time_point start, const wchar_t* text);
+	static uint64_t to_ns(clock::time_point time);
+};
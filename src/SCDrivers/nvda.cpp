@@ -2,7 +2,7 @@
 
 ScreenReaderNVDA* ScreenReaderNVDA::currentInstance = nullptr;
 
-ScreenReaderNVDA::ScreenReaderNVDA() : ScreenReader(L"NVDA", SC_HAS_SPEECH | SC_HAS_SPEECH_STATE | SC_HAS_BRAILLE), module(NULL), nvdaController_testIfRunning_fn(NULL), nvdaController_speakText_fn(NULL), nvdaController_brailleMessage_fn(NULL), nvdaController_cancelSpeech_fn(NULL), nvdaController_speakSsml_fn(NULL), nvdaController_setOnSsmlMarkReachedCallback_fn(NULL), loaded(false), Is_Active(false), IsSpeaking(false) {
+ScreenReaderNVDA::ScreenReaderNVDA() : ScreenReader(L"NVDA", SC_HAS_SPEECH | SC_HAS_SPEECH_STATE | SC_HAS_BRAILLE), module(NULL), nvdaController_testIfRunning_fn(NULL), nvdaController_speakText_fn(NULL), nvdaController_brailleMessage_fn(NULL), nvdaController_cancelSpeech_fn(NULL), nvdaController_speakSsml_fn(NULL), nvdaController_setOnSsmlMarkReachedCallback_fn(NULL), loaded(false), Is_Active(false), IsSpeaking(false), speaking_utterance(0) {
     currentInstance = this;
 }
 
@@ -61,9 +61,15 @@ bool ScreenReaderNVDA::speak_text(const wchar_t* text, bool interrupt) {
             wchar_t* ssmlText = new wchar_t[length + 100];
             SPEECH_PRIORITY priority = interrupt ? SPEECH_PRIORITY_NOW : SPEECH_PRIORITY_NORMAL;
 
-            swprintf(ssmlText, L"<speak>%s<mark name='end_of_speech'/></speak>", text);
+            // The end mark carries the utterance id, so the callback knows which utterance finished.
+            uint64_t utterance = Tracer::current_utterance();
+            swprintf(ssmlText, L"<speak>%s<mark name='end_of_speech_%llu'/></speak>", text, static_cast<unsigned long long>(utterance));
+            this->speaking_utterance = utterance;
             auto state = nvdaController_speakSsml_fn(ssmlText, SYMBOL_LEVEL_UNCHANGED, priority, true);
             delete ssmlText;
+            if (state == 0) {
+                utterances.speech_started(utterance, this->get_name());
+            }
             return (state == 0) ? true : false;
         } else {
             auto state = nvdaController_speakText_fn(text, interrupt);
@@ -91,8 +97,14 @@ bool ScreenReaderNVDA::stop_speech() {
 }
 
 error_status_t __stdcall ScreenReaderNVDA::markReachedCallback(const wchar_t* mark) {
-    if (wcscmp(mark, L"end_of_speech") == 0 && currentInstance) {
-        currentInstance->IsSpeaking = false;
+    const wchar_t prefix[] = L"end_of_speech_";
+    if (currentInstance && wcsncmp(mark, prefix, wcslen(prefix)) == 0) {
+        uint64_t utterance = wcstoull(mark + wcslen(prefix), nullptr, 10);
+        // Earlier utterances report their own marks, only the last one queued ends the speech.
+        if (utterance == currentInstance->speaking_utterance) {
+            currentInstance->IsSpeaking = false;
+        }
+        utterances.speech_ended(utterance, currentInstance->get_name());
     }
     return 0;
 }
\ No newline at end of file
@@ -1,6 +1,8 @@
 #pragma once
 #include <Windows.h>
 #include "SCDriver.h"
+#include "../SCCore/Tracer.h"
+#include "../SCCore/Utterances.h"
 #include "../ThirdParty/nvdaController.h"
 #ifdef _WIN64
 #define NVDA_MODULE L"nvdaControllerClient64.dll"
@@ -21,6 +23,7 @@ private:
 	bool loaded;
 	bool Is_Active;
 	bool IsSpeaking;
+	std::atomic<uint64_t> speaking_utterance; // Id of the last utterance sent with an end mark.
 
 	NvdaController_testIfRunning_t nvdaController_testIfRunning_fn;
 	NvdaController_speakText_t nvdaController_speakText_fn;
@@ -39,6 +42,7 @@ public:
 
 	bool is_speaking() override { return IsSpeaking; }
 	bool is_running() override;
+	bool reports_end() const override { return this->module && nvdaController_speakSsml_fn && nvdaController_setOnSsmlMarkReachedCallback_fn; }
 
 	bool speak_text(const wchar_t* text, bool interrupt = false) override;
 	bool output_braille(const wchar_t* text) override;
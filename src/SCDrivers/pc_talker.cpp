@@ -1,4 +1,5 @@
 
+#include "../SCCore/Transcode.h"
 #include "pc_talker.h"
 
 ScreenReaderPCTalker::ScreenReaderPCTalker() :
@@ -58,8 +59,7 @@ bool ScreenReaderPCTalker::speak_text(const wchar_t* text, bool interrupt) {
             this->stop_speech();
         }
         
-        std::string cp932_text = wstring_to_cp932(text);        
-        int result = pctk_read_fn(cp932_text.c_str(), 0, 1);
+        int result = pctk_read_fn(transcode::to_codepage(text, 932), 0, 1);
                
         return result == 0;
     }
@@ -73,18 +73,3 @@ bool ScreenReaderPCTalker::stop_speech() {
     }
     return false;
 }
-
-std::string ScreenReaderPCTalker::wstring_to_cp932(const wchar_t* wstr) {
-    if (!wstr) return "";    
-    int size = WideCharToMultiByte(932, 0, wstr, -1, NULL, 0, NULL, NULL);
-    if (size <= 0) return "";
-    
-    std::string result(size, 0);
-    WideCharToMultiByte(932, 0, wstr, -1, &result[0], size, NULL, NULL);
-
-        if (!result.empty() && result.back() == '\0') {
-        result.pop_back();
-    }
-    
-    return result;
-}
\ No newline at end of file
@@ -34,7 +34,4 @@ public:
 	bool is_speaking() override { return false; }
     bool speak_text(const wchar_t* text, bool interrupt = false) override;
     bool stop_speech() override;
-
-private:
-    std::string wstring_to_cp932(const wchar_t* wstr);
 };
\ No newline at end of file
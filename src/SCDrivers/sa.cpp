@@ -17,9 +17,11 @@ ScreenReaderSystemAccess::~ScreenReaderSystemAccess() {
 		}
 	}
 	void ScreenReaderSystemAccess::release() {
+		if (this->loaded) {
+			sa_cleanup();
+		}
 		this->loaded = false;
 		this->Is_Active = false;
-		sa_cleanup();
 	}
 	bool ScreenReaderSystemAccess::is_running() {
 		this->Is_Active = (sa_is_active() == true) ? true : false;
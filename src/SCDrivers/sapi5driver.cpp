@@ -51,6 +51,10 @@ ScreenReaderSapi5::~ScreenReaderSapi5() {
 		}
 		return false;
 }
+	// Every message is rendered to memory in full before playback starts.
+	bool ScreenReaderSapi5::synthesizes_whole() const {
+		return true;
+	}
 	float ScreenReaderSapi5::get_volume() const {
 		if (this->module != nullptr) {
 			return static_cast<float> (this->module->get_volume());
@@ -17,6 +17,7 @@ public:
 	bool is_running() override;
 	bool speak_text(const wchar_t* text, bool interrupt = false) override;
 	bool stop_speech() override;
+	bool synthesizes_whole() const override;
 	void output_file(const char* filePath, const wchar_t* text) override;
 	float get_volume() const override;
 	void set_volume(float offset) override;
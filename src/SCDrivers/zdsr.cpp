@@ -20,9 +20,11 @@ void ScreenReaderZhengdu::init() {
 	void ScreenReaderZhengdu::release() {
 		this->loaded = false;
 		this->Is_Active = false;
-		this->module->unloadLibrary();
-		delete this->module;
-		this->module = nullptr;
+		if (this->module != nullptr) {
+			this->module->unloadLibrary();
+			delete this->module;
+			this->module = nullptr;
+		}
 	}
 	bool ScreenReaderZhengdu::is_running() {
 		if (this->module->InitTTS) {
@@ -1,6 +1,11 @@
 #define __SPEECH_C_EXPORT
 
+#include <atomic>
+#include <chrono>
 #include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
 #include <vector>
 
 #ifdef _WIN32
@@ -12,10 +17,20 @@
 #include "../include/SpeechCore.h"
 #include "SCDrivers/drivers.h"
 #include "SCDrivers/SCDriver.h"
+#include "SCCore/DedupCache.h"
+#include "SCCore/DriverLoader.h"
+#include "SCCore/DriverRegistry.h"
+#include "SCCore/HealthMonitor.h"
+#include "SCCore/OutputWorker.h"
+#include "SCCore/Segmenter.h"
+#include "SCCore/StartupBuffer.h"
+#include "SCCore/TextStreams.h"
+#include "SCCore/Tracer.h"
+#include "SCCore/Utterances.h"
 
 using namespace std;
 
-extern bool IS_LOADED = false;
+atomic<bool> IS_LOADED{ false };
 extern bool PREFER_SAPI = false;
 
 #ifdef _WIN32
@@ -23,8 +38,93 @@ extern Sapi5Speech* sapi5 = nullptr;
 extern ScreenReaderSapi5* sapi5_driver = nullptr;
 #endif // _WIN32
 
-extern ScreenReader* current_driver = nullptr;
-vector<ScreenReader*> drivers;
+// Declared before everything that can own queued messages, so it outlives them at exit.
+UtteranceTracker utterances;
+DriverRegistry registry;
+OutputWorker output_worker;
+HealthMonitor health_monitor;
+DriverLoader driver_loader;
+StartupBuffer startup_buffer;
+Segmenter segmenter;
+DedupCache dedup;
+TextStreams text_streams;
+mutex init_mutex; // Guards init_thread.
+thread init_thread;
+Tracer tracer;
+uint32_t PROBE_INTERVAL = 1000;
+uint32_t INIT_TIMEOUT = 3000;
+bool LAZY_LOADING = false;
+bool NATIVE_SSIP = false;
+size_t STARTUP_BUFFER_SIZE = 64;
+// Lazy loads running outside a read guard. Speech_Free waits for them before it deletes the entries they hold.
+atomic<uint32_t> lazy_loads{ 0 };
+
+// The loopback driver while it is registered, so a pointer read under a read guard stays valid even against Speech_Free.
+// It is always registered last. Requires a read guard.
+static ScreenReaderLoopback* find_loopback() {
+	const driver_list* list = registry.list();
+	if (list == nullptr) {
+		return nullptr;
+	}
+	for (auto it = list->entries.rbegin(); it != list->entries.rend(); ++it) {
+		if (auto loopback = dynamic_cast<ScreenReaderLoopback*>((*it)->driver)) {
+			return loopback;
+		}
+	}
+	return nullptr;
+}
+
+extern "C" SPEECH_C_API bool Loopback_Set_Latency(uint32_t call, uint32_t model, uint32_t a_us, uint32_t b_us) {
+	DriverRegistry::read_guard guard(registry.domain());
+	ScreenReaderLoopback* loopback = find_loopback();
+	return (loopback != nullptr) ? loopback->set_latency(call, model, a_us, b_us) : false;
+}
+
+extern "C" SPEECH_C_API void Loopback_Set_Seed(uint64_t seed) {
+	DriverRegistry::read_guard guard(registry.domain());
+	if (ScreenReaderLoopback* loopback = find_loopback()) {
+		loopback->set_seed(seed);
+	}
+}
+
+extern "C" SPEECH_C_API void Loopback_Set_Speech_Rate(uint32_t us_per_char) {
+	DriverRegistry::read_guard guard(registry.domain());
+	if (ScreenReaderLoopback* loopback = find_loopback()) {
+		loopback->set_speech_rate(us_per_char);
+	}
+}
+
+extern "C" SPEECH_C_API void Loopback_Set_Synthesis_Rate(uint32_t us_per_char) {
+	DriverRegistry::read_guard guard(registry.domain());
+	if (ScreenReaderLoopback* loopback = find_loopback()) {
+		loopback->set_synthesis_rate(us_per_char);
+	}
+}
+
+extern "C" SPEECH_C_API uint64_t Loopback_Get_Calls(uint32_t call) {
+	DriverRegistry::read_guard guard(registry.domain());
+	ScreenReaderLoopback* loopback = find_loopback();
+	return (loopback != nullptr) ? loopback->get_calls(call) : 0;
+}
+
+extern "C" SPEECH_C_API size_t Loopback_Get_Records() {
+	DriverRegistry::read_guard guard(registry.domain());
+	ScreenReaderLoopback* loopback = find_loopback();
+	return (loopback != nullptr) ? loopback->get_records() : 0;
+}
+
+extern "C" SPEECH_C_API bool Loopback_Get_Record(size_t index, sc_loopback_record* record) {
+	DriverRegistry::read_guard guard(registry.domain());
+	ScreenReaderLoopback* loopback = find_loopback();
+	return (loopback != nullptr) ? loopback->get_record(index, record) : false;
+}
+
+extern "C" SPEECH_C_API void Loopback_Reset() {
+	DriverRegistry::read_guard guard(registry.domain());
+	if (ScreenReaderLoopback* loopback = find_loopback()) {
+		loopback->reset();
+	}
+}
 
 #ifdef _WIN32
 extern "C" SPEECH_C_API void Sapi_Init() {
@@ -57,12 +157,14 @@ extern "C" SPEECH_C_API const wchar_t* Sapi_Get_Voice(int index) {
 extern "C" SPEECH_C_API void Sapi_Set_Voice(const wchar_t* voice) {
 	if (sapi5 != nullptr) {
 		sapi5->set_voice(std::wstring(voice));
+		dedup.parameters_changed();
 	}
 }
 
 extern "C" SPEECH_C_API void Sapi_Set_Voice_By_Index(int index) {
 	if (sapi5 != nullptr) {
 		sapi5->set_voice_by_index(index);
+		dedup.parameters_changed();
 	}
 }
 
@@ -79,6 +181,7 @@ extern "C" SPEECH_C_API void Sapi_Voice_Set_Volume(float volume) {
 	if (sapi5 != nullptr) {
 		auto value = static_cast<USHORT>(volume);
 		sapi5->set_volume(value);
+		dedup.parameters_changed();
 	}
 }
 
@@ -90,6 +193,7 @@ extern "C" SPEECH_C_API void Sapi_Voice_Set_Rate(float rate) {
 	if (sapi5 != nullptr) {
 		auto value = static_cast<long>(rate);
 		sapi5->set_rate(value);
+		dedup.parameters_changed();
 	}
 }
 
@@ -125,105 +229,327 @@ extern "C" SPEECH_C_API void Sapi_Stop() {
 #endif // _WIN32
 
 
-extern "C" SPEECH_C_API void Speech_Init() {
+static void probe_drivers() {
+	DriverRegistry::read_guard guard(registry.domain());
+	const driver_list* list = registry.list();
+	if (list == nullptr) {
+		return;
+	}
+	for (auto entry : list->entries) {
+		// Drivers registered lazily stay unloaded until detection or selection needs them.
+		if (entry->is_loaded()) {
+			entry->probe();
+		}
+	}
+	if (list->fallback != nullptr) {
+		list->fallback->probe();
+	}
+}
+
+// Reads the liveness flag published by the health monitor, or probes directly when the monitor is disabled.
+static bool driver_alive(driver_entry* entry) {
+	return (health_monitor.is_running() && entry->is_loaded()) ? entry->is_alive() : entry->probe();
+}
+
+// Switching drivers ends every dedup window: what the previous screen reader spoke was never heard on this one.
+static void select_driver(driver_entry* entry) {
+	driver_entry* previous = registry.current();
+	registry.select(entry);
+	if (previous != entry) {
+		dedup.clear();
+	}
+}
+
+static bool select_driver_if(driver_entry* expected, driver_entry* entry) {
+	if (!registry.select_if(expected, entry)) {
+		return false;
+	}
+	if (expected != entry) {
+		dedup.clear();
+	}
+	return true;
+}
+
+// Called by the driver loader once a driver finished initializing, on its init thread.
+static bool driver_ready(ScreenReader* driver, bool detectable, uint32_t rank) {
+	driver_entry* entry = new driver_entry(driver, detectable, rank);
+	bool running = entry->probe();
+	registry.insert(entry);
+	if (running && detectable) {
+		// Take over unless a running screen reader is already selected.
+		DriverRegistry::read_guard guard(registry.domain());
+		driver_entry* current = registry.current();
+		const driver_list* list = registry.list();
+		if (current == nullptr || (current == list->fallback && !PREFER_SAPI) || !driver_alive(current)) {
+			select_driver_if(current, entry);
+		}
+	}
+	return running;
+}
+
+static void release_held(speech_message* message);
+
+// Registers the drivers that are set up synchronously and starts initializing the screen readers.
+static void init_begin() {
+	driver_list* list = new driver_list();
 #ifdef _WIN32
 	Sapi_Init();
-	ScreenReaderNVDA* nvda_driver(new ScreenReaderNVDA());
-	ScreenReaderJaws* jaws_driver(new ScreenReaderJaws());
-	ScreenReaderPCTalker* pct_driver = new ScreenReaderPCTalker();
-	ScreenReaderSystemAccess* sa_driver(new ScreenReaderSystemAccess());
 	sapi5_driver = new ScreenReaderSapi5(sapi5);
-	ScreenReaderZhengdu* zdsr_driver(new ScreenReaderZhengdu());
-	nvda_driver->init();
-	jaws_driver->init();
-	pct_driver->init();
-	sa_driver->init();
-	zdsr_driver->init();
-	drivers.push_back(nvda_driver);
-	drivers.push_back(jaws_driver);
-	drivers.push_back(pct_driver);
-	//drivers.push_back(sapi5_driver);
-	drivers.push_back(sa_driver);
-	drivers.push_back(zdsr_driver);
+	list->fallback = new driver_entry(sapi5_driver);
+#endif // _WIN32
+#ifdef SPEECHCORE_LOOPBACK
+	ScreenReaderLoopback* loopback = new ScreenReaderLoopback();
+	loopback->init();
+	list->entries.push_back(new driver_entry(loopback, false, UINT32_MAX));
+#endif // SPEECHCORE_LOOPBACK
+	registry.publish(list);
+
+	// Screen readers, in preference order. Constructing them is cheap, their modules are only loaded by init().
+	vector<ScreenReader*> drivers;
+#ifdef _WIN32
+	drivers.push_back(new ScreenReaderNVDA());
+	drivers.push_back(new ScreenReaderJaws());
+	drivers.push_back(new ScreenReaderPCTalker());
+	drivers.push_back(new ScreenReaderSystemAccess());
+	drivers.push_back(new ScreenReaderZhengdu());
 #elif defined(__APPLE__)
-	AVTTSVoiceDriver* av_tts = new AVTTSVoiceDriver();
-	av_tts->init();
-	drivers.push_back(av_tts);
+	drivers.push_back(new AVTTSVoiceDriver());
 #elif defined(__linux__) || defined(__unix__)
-	SpeechDispatcher* speech_dispatcher = new SpeechDispatcher();
-	speech_dispatcher->init();
-	drivers.push_back(speech_dispatcher);
+	drivers.push_back(new SpeechDispatcher(NATIVE_SSIP));
 #endif // _WIN32
-	
 
-	Speech_Detect_Driver();
-	IS_LOADED = true;
+	// Eagerly, they are initialized in parallel and join the registry whenever they are ready.
+	// Lazily, they are registered right away and initialized on first probe or selection.
+	driver_loader.begin(driver_ready);
+	for (size_t rank = 0; rank < drivers.size(); rank++) {
+		if (LAZY_LOADING) {
+			registry.insert(new driver_entry(drivers[rank], true, static_cast<uint32_t>(rank), false));
+		}
+		else {
+			driver_loader.add(drivers[rank], true, INIT_TIMEOUT);
+		}
+	}
 }
 
+// Runs once a screen reader is ready or the deadlines passed.
+static void init_finish() {
+	probe_drivers();
+	Speech_Detect_Driver();
+	health_monitor.start(probe_drivers, PROBE_INTERVAL);
+	IS_LOADED.store(true, memory_order_release);
+}
 
-extern "C" SPEECH_C_API void Speech_Free() {
-	if (!drivers.empty()) {
-		/*auto ittr_driver = drivers.begin();
-		while (ittr_driver != drivers.end()) {
-			auto driver = *(ittr_driver);
-			driver->release();
-			//ittr_driver = drivers.erase(ittr_driver);
-		}*/
-		if (drivers.size() > 0) {
-		drivers.clear();
-		drivers.shrink_to_fit();
+extern "C" SPEECH_C_API void Speech_Init() {
+	init_begin();
+	driver_loader.wait();
+	init_finish();
 }
+
+extern "C" SPEECH_C_API void Speech_Init_Async(sc_init_callback callback, void* userdata) {
+	lock_guard<mutex> lock(init_mutex);
+	if (init_thread.joinable()) {
+		return; // Initialized asynchronously already, Speech_Free has to come first.
+	}
+	startup_buffer.open(STARTUP_BUFFER_SIZE);
+	init_begin();
+	init_thread = thread([callback, userdata] {
+		if (!driver_loader.wait()) {
+			startup_buffer.close(nullptr); // Speech_Free was called meanwhile.
+			return;
+		}
+		init_finish();
+		startup_buffer.close(release_held);
+		if (callback != nullptr) {
+			const wchar_t* name = nullptr;
+			{
+				DriverRegistry::read_guard guard(registry.domain());
+				driver_entry* current = registry.current();
+				name = (current != nullptr) ? current->driver->get_name() : nullptr;
+			}
+			// Without a read guard, the callback may call Speech_Free. Driver names are literals and outlive it.
+			callback(name, userdata);
+		}
+	});
 }
 
 
+extern "C" SPEECH_C_API void Speech_Free() {
+	// An asynchronous init still waiting for drivers gives up first, so it never starts anything after this point.
+	driver_loader.cancel();
+	{
+		lock_guard<mutex> lock(init_mutex);
+		if (init_thread.joinable()) {
+			if (init_thread.get_id() == this_thread::get_id()) {
+				init_thread.detach(); // Called from the init callback, the thread ends once it returns.
+			}
+			else {
+				init_thread.join();
+			}
+		}
+	}
+	text_streams.stop();
+	output_worker.stop(false);
+	health_monitor.stop();
+	driver_loader.abandon();
+
+	// Once retire() returns no other thread can reach the drivers, so they can be torn down as soon as lazy loads
+	// that began before it finished.
+	driver_list* list = registry.retire();
+	while (lazy_loads.load(memory_order_acquire) != 0) {
+		this_thread::sleep_for(chrono::milliseconds(1));
+	}
+	if (list != nullptr) {
+		for (auto entry : list->entries) {
+			delete entry->driver;
+			delete entry;
+		}
 #ifdef _WIN32
-	//Sapi_Release();
-	sapi5_driver->release();
-	sapi5_driver = nullptr;
+		//Sapi_Release();
+		sapi5_driver->release();
+		sapi5_driver = nullptr;
+		delete list->fallback;
 #endif // _WIN32
+		delete list;
+	}
+	// A driver created by the next Speech_Init may get the address of one deleted here, so its keys would match.
+	dedup.clear();
 
-	IS_LOADED = false;
-	current_driver = nullptr;
+	IS_LOADED.store(false, memory_order_release);
 }
 
-void set_driver() {
-	for (auto driver : drivers) {
-		if (driver->is_running()) {
-			current_driver = driver;
+// Picks the running driver, keeping the original preference for the last running one in the list.
+// Walks the list backwards and stops at the first hit, so lazily registered drivers before it are never loaded.
+// Stops at a lazily registered driver that was never loaded too, and hands it back: it has to be loaded first.
+static driver_entry* find_running(const driver_list* list, driver_entry** unloaded) {
+	for (auto it = list->entries.rbegin(); it != list->entries.rend(); ++it) {
+		if (!(*it)->detectable) {
+			continue;
+		}
+		if (!(*it)->is_loaded()) {
+			*unloaded = *it;
+			return nullptr;
+		}
+		if (driver_alive(*it)) {
+			return *it;
 		}
 	}
+	return nullptr;
 }
 
-extern "C" SPEECH_C_API void Speech_Detect_Driver() {
-	if (current_driver == nullptr) {
+// Returns the driver output should go to, selecting a new one if the current driver is gone. Requires a read guard.
+// Returns null with unloaded set when detection needs a lazily registered driver loaded, see with_detected.
+static driver_entry* detect_driver(driver_entry** unloaded) {
+	const driver_list* list = registry.list();
+	driver_entry* current = registry.current();
+	if (list == nullptr || (current != nullptr && driver_alive(current))) {
+		return current;
+	}
+
+	driver_entry* found = nullptr;
 #ifdef _WIN32
-		if (PREFER_SAPI) {
-			current_driver = sapi5_driver;
-		}
-		else {
-			set_driver();
-		}
-#else
-		set_driver();
+	if (current == nullptr && PREFER_SAPI) {
+		found = list->fallback;
+	}
 #endif // _WIN32
-		if (current_driver == nullptr) {
-#ifdef _WIN32
-			if (sapi5_driver != nullptr) {
-				current_driver = sapi5_driver;
+	if (found == nullptr) {
+		found = find_running(list, unloaded);
+		if (*unloaded != nullptr) {
+			return nullptr;
+		}
+	}
+	if (found == nullptr && current == nullptr) {
+		found = list->fallback;
+	}
+	if (found != nullptr && !select_driver_if(current, found)) {
+		// Another thread switched drivers meanwhile; its choice wins.
+		return registry.current();
+	}
+	return (found != nullptr) ? found : current;
 }
-#else
-set_driver();
-#endif // _WIN32
 
+// Loads a lazily registered driver that was found under a read guard, once the caller released it. The caller counted
+// the load in lazy_loads while it still held the guard, so the entry outlives a concurrent Speech_Free.
+static void load_unguarded(driver_entry* entry) {
+	entry->load();
+	lazy_loads.fetch_sub(1, memory_order_release);
+}
+
+// Calls fn with the detected driver, or null, under a read guard. Drivers detection needs loaded are loaded in between
+// without the guard, so a slow init() never holds up driver switches or Speech_Free.
+template<typename Fn>
+static auto with_detected(Fn fn) {
+	for (;;) {
+		driver_entry* unloaded = nullptr;
+		{
+			DriverRegistry::read_guard guard(registry.domain());
+			driver_entry* current = detect_driver(&unloaded);
+			if (unloaded == nullptr) {
+				return fn(current);
+			}
+			lazy_loads.fetch_add(1, memory_order_relaxed);
 		}
+		load_unguarded(unloaded);
 	}
-	else if (current_driver != nullptr) {
-		if (!current_driver->is_running()) {
-			set_driver();
 }
+
+extern "C" SPEECH_C_API void Speech_Detect_Driver() {
+	with_detected([](driver_entry* current) {
+		tracer.emit(SC_TRACE_DETECT, 0, (current != nullptr) ? current->driver->get_name() : nullptr);
+	});
+}
+
+extern "C" SPEECH_C_API void Speech_Refresh_Drivers() {
+	probe_drivers();
+	Speech_Detect_Driver();
+}
+
+extern "C" SPEECH_C_API void Speech_Set_Probe_Interval(uint32_t interval_ms) {
+	PROBE_INTERVAL = interval_ms;
+	if (!IS_LOADED.load(memory_order_acquire)) {
+		return;
+	}
+	if (interval_ms == 0) {
+		health_monitor.stop();
+	}
+	else if (health_monitor.is_running()) {
+		health_monitor.set_interval(interval_ms);
+	}
+	else {
+		health_monitor.start(probe_drivers, interval_ms);
 	}
 }
 
+extern "C" SPEECH_C_API uint32_t Speech_Get_Probe_Interval() {
+	return PROBE_INTERVAL;
+}
+
+extern "C" SPEECH_C_API void Speech_Set_Init_Timeout(uint32_t timeout_ms) {
+	INIT_TIMEOUT = timeout_ms;
+}
+
+extern "C" SPEECH_C_API uint32_t Speech_Get_Init_Timeout() {
+	return INIT_TIMEOUT;
+}
+
+extern "C" SPEECH_C_API void Speech_Set_Lazy_Loading(bool lazy) {
+	LAZY_LOADING = lazy;
+}
+
+extern "C" SPEECH_C_API bool Speech_Get_Lazy_Loading() {
+	return LAZY_LOADING;
+}
+
+extern "C" SPEECH_C_API int Speech_Get_Init_Drivers() {
+	return static_cast<int>(driver_loader.count());
+}
+
+extern "C" SPEECH_C_API bool Speech_Get_Init_Info(int index, sc_driver_init* init) {
+	if (index < 0 || init == nullptr) {
+		return false;
+	}
+	return driver_loader.info(static_cast<size_t>(index), *init);
+}
+
 extern "C" SPEECH_C_API void Speech_Prefer_Sapi(bool prefer_sapi) {
 	PREFER_SAPI = prefer_sapi;
 }
@@ -233,145 +559,769 @@ extern "C" SPEECH_C_API bool Speech_Sapi_Loaded() {
 }
 
 #endif // _WIN32
+#ifdef __linux__
+extern "C" SPEECH_C_API void Speech_Set_Native_Ssip(bool native_ssip) {
+	NATIVE_SSIP = native_ssip;
+}
+
+extern "C" SPEECH_C_API bool Speech_Get_Native_Ssip() {
+	return NATIVE_SSIP;
+}
+
+#endif // __linux__
 
 extern "C" SPEECH_C_API bool Speech_Is_Speaking() {
-	if (current_driver != nullptr && !current_driver->is_running()) {
-		return current_driver->is_speaking();
+	DriverRegistry::read_guard guard(registry.domain());
+	driver_entry* current = registry.current();
+	if (current != nullptr && driver_alive(current)) {
+		return current->stats.time(SC_STAT_IS_SPEAKING, [&] { return current->driver->is_speaking(); });
 	}
 	return false;
 }
 
+extern "C" SPEECH_C_API bool Speech_Wait_Until_Done(uint32_t timeout_ms) {
+	// Waits in slices, so the read guard never holds up a driver switch or Speech_Free for long.
+	const uint32_t slice_ms = 50;
+	auto deadline = chrono::steady_clock::now() + chrono::milliseconds(timeout_ms);
+	for (;;) {
+		int64_t remaining = chrono::duration_cast<chrono::milliseconds>(deadline - chrono::steady_clock::now()).count();
+		uint32_t wait_ms = (remaining <= 0) ? 0 : (remaining < slice_ms) ? static_cast<uint32_t>(remaining) : slice_ms;
+		{
+			DriverRegistry::read_guard guard(registry.domain());
+			driver_entry* current = registry.current();
+			if (current == nullptr || current->driver->wait_until_done(wait_ms)) {
+				return true;
+			}
+		}
+		if (remaining <= 0) {
+			return false;
+		}
+	}
+}
+
 extern "C" SPEECH_C_API const wchar_t* Speech_Current_Driver() {
-	if (current_driver != nullptr &&current_driver->is_running()) {
-		
-		return current_driver->get_name();
+	DriverRegistry::read_guard guard(registry.domain());
+	driver_entry* current = registry.current();
+	if (current != nullptr && driver_alive(current)) {
+		return current->driver->get_name();
 	}
 	return L"";
 }
 
 extern "C" SPEECH_C_API const wchar_t* Speech_Get_Driver(int index) {
-	return (!drivers.empty() && index>=0 && index < static_cast<int> (drivers.size())) ? drivers[index]->get_name() : L"";
+	DriverRegistry::read_guard guard(registry.domain());
+	const driver_list* list = registry.list();
+	return (list != nullptr && index >= 0 && index < static_cast<int> (list->entries.size())) ? list->entries[index]->driver->get_name() : L"";
 }
 
 extern "C" SPEECH_C_API void Speech_Set_Driver(int index) {
-	if (!drivers.empty() && index>=0 && index < static_cast<int> (drivers.size())) {
-		current_driver = drivers[index];
-}
+	driver_entry* entry;
+	{
+		DriverRegistry::read_guard guard(registry.domain());
+		const driver_list* list = registry.list();
+		if (list == nullptr || index < 0 || index >= static_cast<int> (list->entries.size())) {
+			return;
+		}
+		entry = list->entries[index];
+		if (entry->is_loaded()) {
+			select_driver(entry);
+			return;
+		}
+		lazy_loads.fetch_add(1, memory_order_relaxed);
+	}
+	entry->load();
+	{
+		// Selected only while still registered, Speech_Free may have retired the registry meanwhile.
+		DriverRegistry::read_guard guard(registry.domain());
+		if (registry.list() != nullptr) {
+			select_driver(entry);
+		}
+	}
+	lazy_loads.fetch_sub(1, memory_order_release);
 }
 
 extern "C" SPEECH_C_API int Speech_Get_Drivers() {
-	int length = static_cast<int> (drivers.size());
-	return (!drivers.empty() ) ? length : 0;
+	DriverRegistry::read_guard guard(registry.domain());
+	const driver_list* list = registry.list();
+	return (list != nullptr) ? static_cast<int> (list->entries.size()) : 0;
 }
 
 extern "C" SPEECH_C_API bool Speech_Is_Loaded() {
-	return IS_LOADED;
+	return IS_LOADED.load(memory_order_acquire);
+}
+
+// Hands long text to a driver that synthesizes whole requests one segment at a time, see Segmenter.
+// Later segments queue behind the first instead of interrupting it, and are given up once an interrupt or stop came in.
+static bool speak_segments(driver_entry* current, const speech_request& request, uint64_t utterance) {
+	// The text may live in this thread's transcode buffer, which converting the segments reuses.
+	static thread_local wstring wide_copy;
+	static thread_local string utf8_copy;
+	size_t count = request.count();
+	speech_request part = request;
+	if (request.utf8) {
+		utf8_copy.assign(request.utf8, count);
+	}
+	else {
+		wide_copy.assign(request.text, count);
+	}
+	uint64_t epoch = segmenter.epoch();
+	size_t offset = 0;
+	size_t segments = 0;
+	bool spoken = true;
+	while (offset < count && spoken) {
+		lock_guard<mutex> lock(segmenter.feed_lock());
+		if (segments > 0 && segmenter.epoch() != epoch) {
+			break;
+		}
+		size_t length;
+		if (request.utf8) {
+			part.utf8 = utf8_copy.data() + offset;
+			length = segmenter.next(part.utf8, count - offset);
+		}
+		else {
+			part.text = wide_copy.data() + offset;
+			length = segmenter.next(part.text, count - offset);
+		}
+		part.length = length;
+		part.terminated = offset + length == count;
+		spoken = current->stats.time(SC_STAT_SPEAK, [&] { return current->driver->speak_request(part); });
+		part.priority = SC_PRIORITY_NORMAL; // Critical and high only interrupt with the first segment.
+		offset += length;
+		segments++;
+	}
+	bool cut_short = offset < count && spoken;
+	segmenter.count(segments, cut_short);
+	if (cut_short) {
+		utterances.speech_cancelled(utterance, current->driver->get_name());
+	}
+	return spoken;
+}
+
+// Whether a request goes through speak_segments. Low and progress requests are dropped while speech goes on,
+// which would drop every segment after the first.
+static bool should_segment(driver_entry* current, const speech_request& request) {
+	return segmenter.enabled() && request.priority < SC_PRIORITY_LOW && current->driver->synthesizes_whole()
+		&& request.count() > segmenter.get_limit();
+}
+
+// Dedup key of the request, see DedupCache, or 0 if it is never suppressed.
+// Interrupting requests always go through: they stop what is speaking, so a repeat of it has to be heard again.
+static uint64_t dedup_key(driver_entry* current, const speech_request& request) {
+	if (!dedup.enabled() || request.priority == SC_PRIORITY_CRITICAL) {
+		return 0;
+	}
+	size_t count = request.count();
+	uint64_t hash = request.utf8 ? DedupCache::hash(request.utf8, count) : DedupCache::hash(request.text, count);
+	return dedup.key(hash, current->driver, request.priority);
+}
+
+// Hands one request to a driver, timing and tracing the call. Requires a read guard.
+static bool speak(driver_entry* current, const speech_request& request, uint64_t utterance) {
+	uint64_t key = dedup_key(current, request);
+	uint64_t cleared = dedup.clear_count();
+	if (key != 0 && dedup.repeated(key)) {
+		utterances.dropped(utterance, SC_UTTERANCE_CANCELLED);
+		return true; // Checked first, a suppressed repeat does not interrupt anything either.
+	}
+	if (request.priority == SC_PRIORITY_CRITICAL) {
+		utterances.cancel_all(false);
+		dedup.clear(); // What it interrupts was not heard to the end.
+	}
+	if (!utterances.begin(utterance)) {
+		return false; // Cancelled while queued.
+	}
+	bool spoken;
+	{
+		Tracer::dispatch_scope scope(tracer, utterance, current->driver->get_name(), request.priority == SC_PRIORITY_CRITICAL);
+		if (should_segment(current, request)) {
+			spoken = speak_segments(current, request, utterance);
+		}
+		else {
+			spoken = current->stats.time(SC_STAT_SPEAK, [&] { return current->driver->speak_request(request); });
+		}
+	}
+	utterances.dispatched(utterance, spoken, current->driver->reports_end());
+	if (spoken && key != 0) {
+		dedup.spoken(key, cleared);
+	}
+	return spoken;
+}
+
+static bool output_text(const speech_request& request, uint64_t utterance) {
+	return with_detected([&](driver_entry* current) {
+		if (current != nullptr && (request.text || request.utf8)) {
+			return speak(current, request, utterance);
+		}
+		utterances.dropped(utterance, SC_UTTERANCE_FAILED);
+		return false;
+	});
+}
+
+// Hands a message held back during startup to the output path it would have taken.
+static void release_held(speech_message* message) {
+	if (output_worker.push(message)) {
+		return;
+	}
+	output_text(message->request(), message->utterance);
+	delete message;
+}
+
+// Assigns an utterance id and emits the API entry event while tracing is active.
+static uint64_t trace_output() {
+	uint64_t utterance = tracer.active() ? utterances.allocate() : 0;
+	tracer.emit(SC_TRACE_OUTPUT, utterance);
+	return utterance;
+}
+
+// Holds, queues or speaks one utterance, depending on the output mode.
+static bool output_utterance(const speech_request& request, uint64_t utterance) {
+	bool has_text = request.text || request.utf8;
+	if (request.priority == SC_PRIORITY_CRITICAL) {
+		segmenter.interrupt(); // Right away, even if the request itself waits in a queue.
+	}
+	if (startup_buffer.is_open() && has_text) {
+		speech_message* message = new speech_message(request);
+		message->utterance = utterance;
+		if (startup_buffer.add(message)) {
+			tracer.emit(SC_TRACE_QUEUED, utterance);
+			return true;
+		}
+		message->utterance = 0; // Ready meanwhile, the utterance goes on below.
+		delete message;
+	}
+	if (output_worker.is_running()) {
+		if (!has_text) {
+			return false;
+		}
+		speech_message* message = new speech_message(request);
+		message->utterance = utterance;
+		// Emitted before the push: once queued, the worker owns the message and may speak it at any time.
+		tracer.emit(SC_TRACE_QUEUED, utterance);
+		if (output_worker.push(message)) {
+			return true;
+		}
+		message->utterance = 0; // The worker stopped meanwhile, the utterance goes on below.
+		delete message;
+	}
+	return output_text(request, utterance);
+}
+
+// Reads the priority class out of SC_OUTPUT_* flags.
+static bool output_flags_priority(uint32_t flags, uint32_t& priority) {
+	priority = (flags >> 8) & 0xff;
+	if (priority == 0) {
+		priority = SC_PRIORITY_NORMAL;
+	}
+	return Scheduler::valid_priority(priority);
+}
+
+extern "C" SPEECH_C_API bool Speech_Output_Priority(const wchar_t* text, uint32_t priority) {
+	if (!Scheduler::valid_priority(priority)) {
+		return false;
+	}
+	return output_utterance({ text, priority }, trace_output());
 }
 
 extern "C" SPEECH_C_API bool Speech_Output(const wchar_t* text, bool _interrupt) {
-	if (current_driver == nullptr) {
-		Speech_Detect_Driver();
+	return Speech_Output_Priority(text, _interrupt ? SC_PRIORITY_CRITICAL : SC_PRIORITY_NORMAL);
+}
+
+extern "C" SPEECH_C_API bool Speech_Output_N(const wchar_t* text, size_t length, bool _interrupt) {
+	uint32_t priority = _interrupt ? SC_PRIORITY_CRITICAL : SC_PRIORITY_NORMAL;
+	return output_utterance({ text, priority, length, nullptr, length == SC_TEXT_TERMINATED }, trace_output());
+}
+
+extern "C" SPEECH_C_API bool Speech_Output_Utf8(const char* text, size_t length, bool _interrupt) {
+	uint32_t priority = _interrupt ? SC_PRIORITY_CRITICAL : SC_PRIORITY_NORMAL;
+	return output_utterance({ nullptr, priority, length, text, length == SC_TEXT_TERMINATED }, trace_output());
+}
+
+// UTF-16 is wchar_t on Windows. Elsewhere it goes to UTF-8, which the calling thread's transcode buffer holds
+// terminated; nothing on the way to the driver converts into that buffer for a UTF-8 request.
+static speech_request utf16_request(const char16_t* text, size_t length, uint32_t priority) {
+	if (length == SC_TEXT_TERMINATED) {
+		length = text ? char_traits<char16_t>::length(text) : 0;
 	}
+#ifdef _WIN32
+	return { reinterpret_cast<const wchar_t*>(text), priority, length, nullptr, false };
+#else
+	size_t utf8_length;
+	const char* utf8 = transcode::to_utf8(text, length, &utf8_length);
+	return { nullptr, priority, utf8_length, utf8, true };
+#endif // _WIN32
+}
 
-	if (current_driver != nullptr && current_driver->is_running() && text) {
-		return current_driver->speak_text(text, _interrupt);
+extern "C" SPEECH_C_API bool Speech_Output_Utf16(const char16_t* text, size_t length, bool _interrupt) {
+	if (text == nullptr) {
+		return false;
 	}
-	else {
-		Speech_Detect_Driver();
+	uint32_t priority = _interrupt ? SC_PRIORITY_CRITICAL : SC_PRIORITY_NORMAL;
+	return output_utterance(utf16_request(text, length, priority), trace_output());
+}
 
-		if (current_driver != nullptr && !current_driver->is_running() && text) {
-			return current_driver->speak_text(text, _interrupt);
+extern "C" SPEECH_C_API bool Speech_Output_Batch(const wchar_t** texts, size_t count, uint32_t flags) {
+	if (texts == nullptr) {
+		return false;
+	}
+	bool interrupt = (flags & SC_OUTPUT_INTERRUPT) != 0;
+	uint32_t priority;
+	if (!output_flags_priority(flags, priority)) {
+		return false;
+	}
+	if (startup_buffer.is_open() || output_worker.is_running()) {
+		speech_message* first = nullptr;
+		speech_message* last = nullptr;
+		for (size_t i = 0; i < count; i++) {
+			if (!texts[i]) {
+				continue;
+			}
+			speech_message* message = new speech_message(texts[i], (interrupt && first == nullptr) ? SC_PRIORITY_CRITICAL : priority);
+			message->utterance = trace_output();
+			tracer.emit(SC_TRACE_QUEUED, message->utterance);
+			if (last != nullptr) {
+				last->next.store(message, memory_order_relaxed);
+			}
+			else {
+				first = message;
+			}
+			last = message;
+		}
+		if (first == nullptr) {
+			return false;
+		}
+		if (startup_buffer.add_chain(first, last)) {
+			return true;
+		}
+		if (output_worker.push_chain(first, last)) {
+			return true;
+		}
+		// The startup buffer closed meanwhile and output is synchronous, or the worker stopped meanwhile.
+		while (first != nullptr) {
+			speech_message* next = (first != last) ? first->next.load(memory_order_relaxed) : nullptr;
+			release_held(first);
+			first = next;
+		}
+		return true;
+	}
+	return with_detected([&](driver_entry* current) {
+		if (current == nullptr) {
+			return false;
+		}
+		bool result = false;
+		for (size_t i = 0; i < count; i++) {
+			if (!texts[i]) {
+				continue;
+			}
+			if (!speak(current, { texts[i], interrupt ? SC_PRIORITY_CRITICAL : priority }, trace_output())) {
+				return false;
+			}
+			interrupt = false;
+			result = true;
+		}
+		return result;
+	});
 }
+
+static uint64_t output_tracked(speech_request request, uint32_t flags) {
+	if (!output_flags_priority(flags, request.priority)) {
+		return 0;
+	}
+	if (flags & SC_OUTPUT_INTERRUPT) {
+		request.priority = SC_PRIORITY_CRITICAL;
+	}
+	uint64_t utterance = utterances.track();
+	tracer.emit(SC_TRACE_OUTPUT, utterance);
+	output_utterance(request, utterance);
+	return utterance;
+}
+
+extern "C" SPEECH_C_API uint64_t Speech_Output_Ex(const wchar_t* text, uint32_t flags) {
+	return text ? output_tracked({ text }, flags) : 0;
+}
+
+extern "C" SPEECH_C_API uint64_t Speech_Output_Ex_Utf16(const char16_t* text, size_t length, uint32_t flags) {
+	return text ? output_tracked(utf16_request(text, length, SC_PRIORITY_NORMAL), flags) : 0;
+}
+
+extern "C" SPEECH_C_API uint64_t Speech_Output_Ex_Utf8(const char* text, size_t length, uint32_t flags) {
+	return text ? output_tracked({ nullptr, SC_PRIORITY_NORMAL, length, text, length == SC_TEXT_TERMINATED }, flags) : 0;
+}
+
+extern "C" SPEECH_C_API uint32_t Speech_Get_Utterance_State(uint64_t id) {
+	return utterances.state(id);
+}
+
+extern "C" SPEECH_C_API uint32_t Speech_Wait(uint64_t id, uint32_t timeout_ms) {
+	return utterances.wait(id, timeout_ms);
+}
+
+extern "C" SPEECH_C_API bool Speech_Cancel(uint64_t id) {
+	uint32_t state = utterances.cancel(id);
+	if (state == SC_UTTERANCE_QUEUED) {
+		return true;
+	}
+	if (state != SC_UTTERANCE_SPEAKING) {
 		return false;
 	}
-	return false;
+	// Screen readers can only stop everything they are speaking.
+	segmenter.interrupt();
+	DriverRegistry::read_guard guard(registry.domain());
+	driver_entry* current = registry.current();
+	if (current != nullptr) {
+		current->stats.time(SC_STAT_STOP, [&] { return current->driver->stop_speech(); });
+	}
+	utterances.cancel_all(false);
+	dedup.clear();
+	return true;
 }
 
-extern "C" SPEECH_C_API bool Speech_Braille(const wchar_t* text) {
-	if (current_driver == nullptr) {
-		Speech_Detect_Driver();
+extern "C" SPEECH_C_API void Speech_Set_Utterance_Callback(sc_utterance_callback callback, void* userdata) {
+	utterances.set_callback(callback, userdata);
+}
+
+extern "C" SPEECH_C_API uint64_t Speech_Stream_Open(uint32_t flags) {
+	uint32_t priority;
+	if (!output_flags_priority(flags, priority)) {
+		return 0;
+	}
+	if (flags & SC_OUTPUT_INTERRUPT) {
+		priority = SC_PRIORITY_CRITICAL;
+	}
+	text_streams.start([](const speech_request& request) {
+		output_utterance(request, trace_output());
+	});
+	return text_streams.open(priority);
+}
+
+extern "C" SPEECH_C_API bool Speech_Stream_Append(uint64_t stream, const wchar_t* text) {
+	if (text == nullptr) {
+		return false;
+	}
+	size_t length;
+	const char* utf8 = transcode::to_utf8(text, &length);
+	return text_streams.append(stream, utf8, length);
+}
+
+extern "C" SPEECH_C_API bool Speech_Stream_Append_Utf8(uint64_t stream, const char* text, size_t length) {
+	if (text == nullptr) {
+		return false;
 	}
+	return text_streams.append(stream, text, (length == SC_TEXT_TERMINATED) ? strlen(text) : length);
+}
+
+extern "C" SPEECH_C_API bool Speech_Stream_Flush(uint64_t stream) {
+	return text_streams.flush(stream);
+}
+
+extern "C" SPEECH_C_API bool Speech_Stream_Close(uint64_t stream) {
+	return text_streams.close(stream);
+}
 
-	if (current_driver != nullptr && current_driver->is_running() && text) {
-		return (current_driver->get_speech_flags() & SC_HAS_BRAILLE) ? current_driver->output_braille(text) : false;
+extern "C" SPEECH_C_API void Speech_Set_Stream_Idle_Timeout(uint32_t timeout_ms) {
+	text_streams.set_idle_timeout(timeout_ms);
+}
+
+extern "C" SPEECH_C_API uint32_t Speech_Get_Stream_Idle_Timeout() {
+	return text_streams.get_idle_timeout();
+}
+
+extern "C" SPEECH_C_API void Speech_Set_Async(bool async_output) {
+	if (async_output) {
+		output_worker.start([](speech_message& message) {
+			message.settle_merged(output_text(message.request(), message.utterance));
+		});
 	}
 	else {
-		Speech_Detect_Driver();
-		if (current_driver != nullptr && !current_driver->is_running() && text) {
-			return (current_driver->get_speech_flags() & SC_HAS_BRAILLE) ? current_driver->output_braille(text) : false;
+		output_worker.stop(true);
+	}
+}
+
+extern "C" SPEECH_C_API bool Speech_Is_Async() {
+	return output_worker.is_running();
+}
+
+extern "C" SPEECH_C_API void Speech_Set_Coalesce_Window(uint32_t window_ms) {
+	output_worker.set_coalesce_window(window_ms);
+}
+
+extern "C" SPEECH_C_API uint32_t Speech_Get_Coalesce_Window() {
+	return output_worker.coalescing().get_window();
+}
+
+extern "C" SPEECH_C_API void Speech_Get_Coalesce_Stats(uint64_t* dropped, uint64_t* merged) {
+	if (dropped) {
+		*dropped = output_worker.coalescing().dropped_count();
+	}
+	if (merged) {
+		*merged = output_worker.coalescing().merged_count();
+	}
+}
+
+extern "C" SPEECH_C_API void Speech_Reset_Coalesce_Stats() {
+	output_worker.coalescing().reset_counters();
+}
+
+extern "C" SPEECH_C_API void Speech_Set_Dedup_Window(uint32_t window_ms) {
+	dedup.set_window(window_ms);
+}
+
+extern "C" SPEECH_C_API uint32_t Speech_Get_Dedup_Window() {
+	return dedup.get_window();
+}
+
+extern "C" SPEECH_C_API void Speech_Set_Dedup_Capacity(uint32_t entries) {
+	dedup.set_capacity(entries);
+}
+
+extern "C" SPEECH_C_API void Speech_Get_Dedup_Stats(uint64_t* hits, uint64_t* misses) {
+	if (hits) {
+		*hits = dedup.hit_count();
+	}
+	if (misses) {
+		*misses = dedup.miss_count();
+	}
+}
+
+extern "C" SPEECH_C_API void Speech_Reset_Dedup_Stats() {
+	dedup.reset_counters();
+}
+
+extern "C" SPEECH_C_API void Speech_Set_Segment_Limit(uint32_t units) {
+	segmenter.set_limit(units);
+}
+
+extern "C" SPEECH_C_API uint32_t Speech_Get_Segment_Limit() {
+	return segmenter.get_limit();
+}
+
+extern "C" SPEECH_C_API void Speech_Get_Segment_Stats(uint64_t* segmented, uint64_t* segments, uint64_t* interrupted) {
+	if (segmented) {
+		*segmented = segmenter.segmented_count();
+	}
+	if (segments) {
+		*segments = segmenter.segment_count();
+	}
+	if (interrupted) {
+		*interrupted = segmenter.interrupted_count();
+	}
+}
+
+extern "C" SPEECH_C_API void Speech_Reset_Segment_Stats() {
+	segmenter.reset_counters();
+}
+
+extern "C" SPEECH_C_API bool Speech_Get_Priority_Stats(uint32_t priority, uint64_t* delivered, uint64_t* preempted, uint64_t* mean_latency_us, uint64_t* max_latency_us) {
+	if (!Scheduler::valid_priority(priority)) {
+		return false;
+	}
+	const Scheduler::class_stats& stats = output_worker.scheduling().stats(priority);
+	uint64_t count = stats.delivered.load(memory_order_relaxed);
+	if (delivered) {
+		*delivered = count;
+	}
+	if (preempted) {
+		*preempted = stats.preempted.load(memory_order_relaxed);
+	}
+	if (mean_latency_us) {
+		*mean_latency_us = count ? stats.total_latency_us.load(memory_order_relaxed) / count : 0;
+	}
+	if (max_latency_us) {
+		*max_latency_us = stats.max_latency_us.load(memory_order_relaxed);
+	}
+	return true;
+}
+
+extern "C" SPEECH_C_API void Speech_Reset_Priority_Stats() {
+	output_worker.scheduling().reset_stats();
+}
+
+extern "C" SPEECH_C_API void Speech_Enable_Stats(bool enable) {
+	DriverStats::enabled.store(enable, memory_order_relaxed);
+}
+
+extern "C" SPEECH_C_API bool Speech_Stats_Enabled() {
+	return DriverStats::enabled.load(memory_order_relaxed);
+}
+
+extern "C" SPEECH_C_API bool Speech_Get_Stats(int index, sc_driver_stats* stats) {
+	DriverRegistry::read_guard guard(registry.domain());
+	const driver_list* list = registry.list();
+	if (stats == nullptr || list == nullptr) {
+		return false;
+	}
+	driver_entry* entry = nullptr;
+	if (index == -1) {
+		entry = registry.current();
+	}
+	else if (index >= 0 && index < static_cast<int> (list->entries.size())) {
+		entry = list->entries[index];
+	}
+	if (entry == nullptr) {
+		return false;
+	}
+	stats->name = entry->driver->get_name();
+	entry->stats.snapshot(*stats);
+	return true;
+}
+
+extern "C" SPEECH_C_API void Speech_Reset_Stats() {
+	DriverRegistry::read_guard guard(registry.domain());
+	const driver_list* list = registry.list();
+	if (list == nullptr) {
+		return;
+	}
+	for (auto entry : list->entries) {
+		entry->stats.reset();
+	}
+	if (list->fallback != nullptr) {
+		list->fallback->stats.reset();
+	}
+}
+
+extern "C" SPEECH_C_API void Speech_Set_Trace_Callback(sc_trace_callback callback, void* userdata) {
+	tracer.set_callback(callback, userdata);
+}
+
+extern "C" SPEECH_C_API void Speech_Set_Trace_Buffer(size_t capacity) {
+	tracer.set_buffer(capacity);
+}
+
+extern "C" SPEECH_C_API bool Speech_Write_Trace(const char* filePath) {
+	return (filePath != nullptr) ? tracer.write_chrome_trace(filePath) : false;
+}
+
+static bool output_braille(const speech_request& request) {
+	return with_detected([&](driver_entry* current) {
+		if (current != nullptr && (request.text || request.utf8)) {
+			ScreenReader* driver = current->driver;
+			return (driver->get_speech_flags() & SC_HAS_BRAILLE) ? current->stats.time(SC_STAT_BRAILLE, [&] { return driver->output_braille(request.wide()); }) : false;
 		}
 		return false;
+	});
+}
+
+extern "C" SPEECH_C_API bool Speech_Braille(const wchar_t* text) {
+	return output_braille({ text });
+}
+
+extern "C" SPEECH_C_API bool Speech_Braille_N(const wchar_t* text, size_t length) {
+	return output_braille({ text, SC_PRIORITY_NORMAL, length, nullptr, length == SC_TEXT_TERMINATED });
+}
+
+extern "C" SPEECH_C_API bool Speech_Braille_Utf8(const char* text, size_t length) {
+	return output_braille({ nullptr, SC_PRIORITY_NORMAL, length, text, length == SC_TEXT_TERMINATED });
+}
+
+extern "C" SPEECH_C_API bool Speech_Braille_Utf16(const char16_t* text, size_t length) {
+	if (text == nullptr) {
+		return false;
 	}
-	return false;
+	return output_braille(utf16_request(text, length, SC_PRIORITY_NORMAL));
 }
 
 extern "C" SPEECH_C_API bool Speech_Stop() {
-	if (current_driver != nullptr) {
-		return current_driver->stop_speech();
+	startup_buffer.discard();
+	output_worker.cancel_pending();
+	segmenter.interrupt();
+	text_streams.discard();
+	DriverRegistry::read_guard guard(registry.domain());
+	driver_entry* current = registry.current();
+	tracer.emit(SC_TRACE_STOP, 0, (current != nullptr) ? current->driver->get_name() : nullptr);
+	utterances.cancel_all(true);
+	dedup.clear();
+	if (current != nullptr) {
+		return current->stats.time(SC_STAT_STOP, [&] { return current->driver->stop_speech(); });
 	}
 	return false;
 }
 
 
 extern "C" SPEECH_C_API float Speech_Get_Volume() {
-	return (current_driver != nullptr) ? current_driver->get_volume() : -1;
+	DriverRegistry::read_guard guard(registry.domain());
+	driver_entry* current = registry.current();
+	return (current != nullptr) ? current->stats.time(SC_STAT_PARAMETERS, [&] { return current->driver->get_volume(); }) : -1;
 }
 
 extern "C" SPEECH_C_API void Speech_Set_Volume(float offset) {
-	if (current_driver != nullptr && offset >=0) {
-		current_driver->set_volume(offset);
+	DriverRegistry::read_guard guard(registry.domain());
+	driver_entry* current = registry.current();
+	if (current != nullptr && offset >=0) {
+		current->stats.time(SC_STAT_PARAMETERS, [&] { current->driver->set_volume(offset); });
+		dedup.parameters_changed();
 	}
 }
 
 extern "C" SPEECH_C_API float Speech_Get_Rate() {
-	return (current_driver != nullptr) ? current_driver->get_rate() : -1;
+	DriverRegistry::read_guard guard(registry.domain());
+	driver_entry* current = registry.current();
+	return (current != nullptr) ? current->stats.time(SC_STAT_PARAMETERS, [&] { return current->driver->get_rate(); }) : -1;
 }
 
 extern "C" SPEECH_C_API void Speech_Set_Rate(float offset) {
-	if (current_driver != nullptr && offset >=0 ) {
-		current_driver->set_rate(offset);
+	DriverRegistry::read_guard guard(registry.domain());
+	driver_entry* current = registry.current();
+	if (current != nullptr && offset >=0 ) {
+		current->stats.time(SC_STAT_PARAMETERS, [&] { current->driver->set_rate(offset); });
+		dedup.parameters_changed();
 	}
 }
 
 
 extern "C" SPEECH_C_API const wchar_t* Speech_Get_Current_Voice() {
-	return (current_driver != nullptr) ? current_driver->get_current_voice() : NULL;
+	DriverRegistry::read_guard guard(registry.domain());
+	driver_entry* current = registry.current();
+	return (current != nullptr) ? current->stats.time(SC_STAT_PARAMETERS, [&] { return current->driver->get_current_voice(); }) : NULL;
 }
 
 extern "C" SPEECH_C_API const wchar_t* Speech_Get_Voice(int index) {
-	return (current_driver != nullptr && index >= 0) ? current_driver->get_voice(index) : NULL;
+	DriverRegistry::read_guard guard(registry.domain());
+	driver_entry* current = registry.current();
+	return (current != nullptr && index >= 0) ? current->stats.time(SC_STAT_PARAMETERS, [&] { return current->driver->get_voice(index); }) : NULL;
 }
 
 extern "C" SPEECH_C_API void Speech_Set_Voice(int index) {
-	if (current_driver != nullptr && index >= 0) {
-		current_driver->set_voice(index);
+	DriverRegistry::read_guard guard(registry.domain());
+	driver_entry* current = registry.current();
+	if (current != nullptr && index >= 0) {
+		current->stats.time(SC_STAT_PARAMETERS, [&] { current->driver->set_voice(index); });
+		dedup.parameters_changed();
 	}
 }
 
 extern "C" SPEECH_C_API int Speech_Get_Voices() {
-	return (current_driver != nullptr) ? current_driver->get_voices() : 0;
+	DriverRegistry::read_guard guard(registry.domain());
+	driver_entry* current = registry.current();
+	return (current != nullptr) ? current->stats.time(SC_STAT_PARAMETERS, [&] { return current->driver->get_voices(); }) : 0;
 }
 
 
 extern "C" SPEECH_C_API void Speech_Output_File(const char* filePath, const wchar_t* text) {
-	if (current_driver != nullptr && filePath && text) {
-		current_driver->output_file(filePath, text);
+	DriverRegistry::read_guard guard(registry.domain());
+	driver_entry* current = registry.current();
+	if (current != nullptr && filePath && text) {
+		current->stats.time(SC_STAT_OUTPUT_FILE, [&] { current->driver->output_file(filePath, text); });
 	}
 }
 
 
 extern "C" SPEECH_C_API void Speech_Resume() {
-	if (current_driver != nullptr) {
-		current_driver->resume_speech();
+	DriverRegistry::read_guard guard(registry.domain());
+	driver_entry* current = registry.current();
+	if (current != nullptr) {
+		current->stats.time(SC_STAT_PAUSE_RESUME, [&] { current->driver->resume_speech(); });
 	}
 }
 
 extern "C" SPEECH_C_API void Speech_Pause() {
-	if (current_driver != nullptr) {
-		current_driver->pause_speech();
+	DriverRegistry::read_guard guard(registry.domain());
+	driver_entry* current = registry.current();
+	if (current != nullptr) {
+		current->stats.time(SC_STAT_PAUSE_RESUME, [&] { current->driver->pause_speech(); });
 	}
 }
 
 extern "C" SPEECH_C_API uint32_t Speech_Get_Flags() {
-	return (current_driver != nullptr) ? current_driver->get_speech_flags() : 0;
+	DriverRegistry::read_guard guard(registry.domain());
+	driver_entry* current = registry.current();
+	return (current != nullptr) ? current->driver->get_speech_flags() : 0;
 }
@@ -5,6 +5,7 @@
 #include <vector>
 #include <cstring> 
 #include "../include/SpeechCore.h"
+#include "SCCore/Transcode.h"
 #include "SpeechCore_JNI.h"
 
 extern bool IS_LOADED;
@@ -15,9 +16,36 @@ extern Sapi5Speech* sapi5;
 class ScreenReaderSapi5;  // Forward declaration
 extern ScreenReaderSapi5* sapi5_driver;
 #endif // _WIN32
-class ScreenReader;  // Forward declaration
-extern ScreenReader* current_driver;
-extern std::vector<ScreenReader*> drivers;
+
+// jchar is UTF-16 on every platform while wchar_t is UTF-32 outside Windows, so strings are never cast between the two.
+static jstring new_string(JNIEnv* env, const wchar_t* text) {
+    if (text == nullptr) {
+        return nullptr;
+    }
+    size_t length;
+    const char16_t* utf16 = transcode::to_utf16(text, &length);
+    return env->NewString(reinterpret_cast<const jchar*>(utf16), static_cast<jsize>(length));
+}
+
+// Copies a Java string into a buffer owned by the calling thread. Nothing stays pinned while a driver speaks,
+// which GetStringCritical would require, and after the first calls nothing is allocated either.
+static const char16_t* copy_string(JNIEnv* env, jstring text, size_t* length) {
+    static thread_local std::u16string buffer;
+    jsize count = env->GetStringLength(text);
+    if (buffer.size() < static_cast<size_t>(count)) {
+        buffer.resize(count);
+    }
+    env->GetStringRegion(text, 0, count, reinterpret_cast<jchar*>(&buffer[0]));
+    *length = static_cast<size_t>(count);
+    return buffer.data();
+}
+
+static const wchar_t* wide_string(JNIEnv* env, jstring text) {
+    size_t length;
+    const char16_t* utf16 = copy_string(env, text, &length);
+    return transcode::to_wide(utf16, length, nullptr);
+}
+
 extern "C" {
     JNIEXPORT void JNICALL Java_SpeechCore_Speech_1Init(JNIEnv*, jobject) {
         Speech_Init();
@@ -32,12 +60,10 @@ extern "C" {
     }
 
     JNIEXPORT jstring JNICALL Java_SpeechCore_Speech_1Current_1Driver(JNIEnv* env, jobject) {
-    const wchar_t* driver = Speech_Current_Driver();
-    return env->NewString(reinterpret_cast<const jchar*>(driver), wcslen(driver));
+        return new_string(env, Speech_Current_Driver());
     }
     JNIEXPORT jstring JNICALL Java_SpeechCore_Speech_1Get_1Driver(JNIEnv* env, jobject, jint index) {
-        const wchar_t* driver = Speech_Get_Driver(static_cast<int>(index));
-        return env->NewString(reinterpret_cast<const jchar*>(driver), wcslen(driver));
+        return new_string(env, Speech_Get_Driver(static_cast<int>(index)));
     }
 
     JNIEXPORT void JNICALL Java_SpeechCore_Speech_1Set_1Driver(JNIEnv*, jobject, jint index) {
@@ -61,24 +87,84 @@ extern "C" {
     }
 
     JNIEXPORT jboolean JNICALL Java_SpeechCore_Speech_1Output(JNIEnv* env, jobject, jstring text, jboolean _interrupt) {
-    const jchar* jtext = env->GetStringChars(text, nullptr);
-    if (jtext == nullptr) {
-        return JNI_FALSE;
+        if (text == nullptr) {
+            return JNI_FALSE;
+        }
+        size_t length;
+        const char16_t* utf16 = copy_string(env, text, &length);
+        return static_cast<jboolean>(Speech_Output_Utf16(utf16, length, static_cast<bool>(_interrupt)));
     }
-    const wchar_t* wtext = reinterpret_cast<const wchar_t*>(jtext);
-    bool result = Speech_Output(wtext, static_cast<bool>(_interrupt));
-    env->ReleaseStringChars(text, reinterpret_cast<const jchar*>(wtext));
-    return static_cast<jboolean>(result);
+    JNIEXPORT jboolean JNICALL Java_SpeechCore_Speech_1Output_1Batch(JNIEnv* env, jobject, jobjectArray texts, jint flags) {
+        if (texts == nullptr) {
+            return JNI_FALSE;
+        }
+        static thread_local std::vector<std::wstring> wtext_holder;
+        static thread_local std::vector<const wchar_t*> wtexts;
+        jsize count = env->GetArrayLength(texts);
+        wtext_holder.resize(count);
+        wtexts.assign(count, nullptr);
+        for (jsize i = 0; i < count; i++) {
+            jstring text = static_cast<jstring>(env->GetObjectArrayElement(texts, i));
+            if (text != nullptr) {
+                wtext_holder[i] = wide_string(env, text);
+                wtexts[i] = wtext_holder[i].c_str();
+                env->DeleteLocalRef(text);
+            }
+        }
+        return static_cast<jboolean>(Speech_Output_Batch(wtexts.data(), wtexts.size(), static_cast<uint32_t>(flags)));
     }
+
+    // The batch is packed by SpeechCore.putBatchText: per text a jint with its length in chars, the chars, a 0 char,
+    // then padding to 4 bytes, all in native byte order. size is the number of bytes written.
+    // On Windows the texts are spoken straight out of the buffer, elsewhere they are converted once.
+    JNIEXPORT jboolean JNICALL Java_SpeechCore_Speech_1Output_1Batch_1Direct(JNIEnv* env, jobject, jobject batch, jint size, jint count, jint flags) {
+        const char* data = (batch != nullptr) ? static_cast<const char*>(env->GetDirectBufferAddress(batch)) : nullptr;
+        if (data == nullptr || size < 0 || count < 0 || size > env->GetDirectBufferCapacity(batch)) {
+            return JNI_FALSE;
+        }
+        static thread_local std::vector<std::wstring> wtext_holder;
+        static thread_local std::vector<const wchar_t*> wtexts;
+        wtexts.resize(count);
+#ifndef _WIN32
+        wtext_holder.resize(count);
+#endif // _WIN32
+        size_t offset = 0;
+        for (jint i = 0; i < count; i++) {
+            jint length;
+            if (offset + sizeof(length) > static_cast<size_t>(size)) {
+                return JNI_FALSE;
+            }
+            memcpy(&length, data + offset, sizeof(length));
+            offset += sizeof(length);
+            size_t bytes = (static_cast<size_t>(length) + 1) * sizeof(char16_t);
+            if (length < 0 || offset + bytes > static_cast<size_t>(size)) {
+                return JNI_FALSE;
+            }
+            const char16_t* text = reinterpret_cast<const char16_t*>(data + offset);
+            // Speech_Output_Batch finds the end with wcslen, so the terminator has to be there inside the buffer.
+            if (text[length] != 0) {
+                return JNI_FALSE;
+            }
+#ifdef _WIN32
+            wtexts[i] = reinterpret_cast<const wchar_t*>(text);
+#else
+            size_t converted;
+            const wchar_t* wide = transcode::to_wide(text, static_cast<size_t>(length), &converted);
+            wtext_holder[i].assign(wide, converted);
+            wtexts[i] = wtext_holder[i].c_str();
+#endif // _WIN32
+            offset = (offset + bytes + 3) & ~static_cast<size_t>(3);
+        }
+        return static_cast<jboolean>(Speech_Output_Batch(wtexts.data(), wtexts.size(), static_cast<uint32_t>(flags)));
+    }
+
     JNIEXPORT jboolean JNICALL Java_SpeechCore_Speech_1Braille(JNIEnv* env, jobject, jstring text) {
-        const jchar* jtext = env->GetStringChars(text, nullptr);
-        if (jtext == nullptr) {
-            return JNI_FALSE; // String conversion failed
+        if (text == nullptr) {
+            return JNI_FALSE;
         }
-        const wchar_t* wtext = reinterpret_cast<const wchar_t*>(jtext);
-        bool result = Speech_Braille(wtext);
-        env->ReleaseStringChars(text, reinterpret_cast<const jchar*>(wtext));
-        return static_cast<jboolean>(result);
+        size_t length;
+        const char16_t* utf16 = copy_string(env, text, &length);
+        return static_cast<jboolean>(Speech_Braille_Utf16(utf16, length));
     }
 
     JNIEXPORT jboolean JNICALL Java_SpeechCore_Speech_1Stop(JNIEnv*, jobject) {
@@ -102,16 +188,14 @@ extern "C" {
     }
 
 JNIEXPORT jstring JNICALL Java_SpeechCore_Speech_1Get_1Current_1Voice(JNIEnv* env, jobject) {
-    const wchar_t* voice = Speech_Get_Current_Voice();
-    return env->NewString(reinterpret_cast<const jchar*>(voice), wcslen(voice));
+    return new_string(env, Speech_Get_Current_Voice());
 }
 
     JNIEXPORT void JNICALL Java_SpeechCore_Speech_1Set_1Voice(JNIEnv*, jobject, jint index) {
         Speech_Set_Voice(static_cast<int>(index));
     }
     JNIEXPORT jstring JNICALL Java_SpeechCore_Speech_1Get_1Voice(JNIEnv* env, jobject, jint index) {
-        const wchar_t* voice = Speech_Get_Voice(static_cast<int>(index));
-        return env->NewString(reinterpret_cast<const jchar*>(voice), wcslen(voice));
+        return new_string(env, Speech_Get_Voice(static_cast<int>(index)));
     }
 
     JNIEXPORT jint JNICALL Java_SpeechCore_Speech_1Get_1Voices(JNIEnv*, jobject) {
@@ -123,15 +207,12 @@ JNIEXPORT void JNICALL Java_SpeechCore_Speech_1Output_1File(JNIEnv* env, jobject
     if (cfilePath == nullptr) {
         return; // String conversion failed
     }
-    const jchar* jtext = env->GetStringChars(text, nullptr);
-    if (jtext == nullptr) {
+    if (text == nullptr) {
         env->ReleaseStringUTFChars(filePath, cfilePath);
-        return; // String conversion failed
+        return;
     }
-    const wchar_t* wtext = reinterpret_cast<const wchar_t*>(jtext);
-    Speech_Output_File(cfilePath, wtext);
+    Speech_Output_File(cfilePath, wide_string(env, text));
     env->ReleaseStringUTFChars(filePath, cfilePath);
-    env->ReleaseStringChars(text, reinterpret_cast<const jchar*>(wtext));
 }
 
     JNIEXPORT void JNICALL Java_SpeechCore_Speech_1Resume(JNIEnv*, jobject) {
@@ -160,23 +241,18 @@ JNIEXPORT void JNICALL Java_SpeechCore_Speech_1Output_1File(JNIEnv* env, jobject
     }
 
 JNIEXPORT jstring JNICALL Java_SpeechCore_Sapi_1Get_1Current_1Voice(JNIEnv* env, jobject) {
-    const wchar_t* voice = Sapi_Get_Current_Voice();
-    return env->NewString(reinterpret_cast<const jchar*>(voice), wcslen(voice));
+    return new_string(env, Sapi_Get_Current_Voice());
 }
 
 JNIEXPORT jstring JNICALL Java_SpeechCore_Sapi_1Get_1Voice(JNIEnv* env, jobject, jint index) {
-    const wchar_t* voice = Sapi_Get_Voice(static_cast<int>(index));
-    return env->NewString(reinterpret_cast<const jchar*>(voice), wcslen(voice));
+    return new_string(env, Sapi_Get_Voice(static_cast<int>(index)));
 }
 
 JNIEXPORT void JNICALL Java_SpeechCore_Sapi_1Set_1Voice(JNIEnv* env, jobject, jstring voice) {
-    const jchar* jvoice = env->GetStringChars(voice, nullptr);
-    if (jvoice == nullptr) {
-        return; // String conversion failed
+    if (voice == nullptr) {
+        return;
     }
-    const wchar_t* wvoice = reinterpret_cast<const wchar_t*>(jvoice);
-    Sapi_Set_Voice(wvoice);
-    env->ReleaseStringChars(voice, reinterpret_cast<const jchar*>(wvoice));
+    Sapi_Set_Voice(wide_string(env, voice));
 }
 
     JNIEXPORT void JNICALL Java_SpeechCore_Sapi_1Set_1Voice_1By_1Index(JNIEnv*, jobject, jint index) {
@@ -204,13 +280,10 @@ JNIEXPORT void JNICALL Java_SpeechCore_Sapi_1Set_1Voice(JNIEnv* env, jobject, js
     }
 
 JNIEXPORT void JNICALL Java_SpeechCore_Sapi_1Speak(JNIEnv* env, jobject, jstring text, jboolean _interrupt, jboolean _xml) {
-    const jchar* jtext = env->GetStringChars(text, nullptr);
-    if (jtext == nullptr) {
-        return; // String conversion failed
+    if (text == nullptr) {
+        return;
     }
-    const wchar_t* wtext = reinterpret_cast<const wchar_t*>(jtext);
-    Sapi_Speak(wtext, static_cast<bool>(_interrupt), static_cast<bool>(_xml));
-    env->ReleaseStringChars(text, reinterpret_cast<const jchar*>(wtext));
+    Sapi_Speak(wide_string(env, text), static_cast<bool>(_interrupt), static_cast<bool>(_xml));
 }
 
 JNIEXPORT void JNICALL Java_SpeechCore_Sapi_1Output_1File(JNIEnv* env, jobject, jstring filename, jstring text, jboolean _xml) {
@@ -218,15 +291,12 @@ JNIEXPORT void JNICALL Java_SpeechCore_Sapi_1Output_1File(JNIEnv* env, jobject,
     if (cfilename == nullptr) {
         return; // String conversion failed
     }
-    const jchar* jtext = env->GetStringChars(text, nullptr);
-    if (jtext == nullptr) {
+    if (text == nullptr) {
         env->ReleaseStringUTFChars(filename, cfilename);
-        return; // String conversion failed
+        return;
     }
-    const wchar_t* wtext = reinterpret_cast<const wchar_t*>(jtext);
-    Sapi_Output_File(cfilename, wtext, static_cast<bool>(_xml));
+    Sapi_Output_File(cfilename, wide_string(env, text), static_cast<bool>(_xml));
     env->ReleaseStringUTFChars(filename, cfilename);
-    env->ReleaseStringChars(text, reinterpret_cast<const jchar*>(wtext));
 }
     JNIEXPORT void JNICALL Java_SpeechCore_Sapi_1Pause(JNIEnv*, jobject) {
         Sapi_Pause();
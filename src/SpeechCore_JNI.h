@@ -107,6 +107,22 @@ JNIEXPORT jboolean JNICALL Java_SpeechCore_Speech_1Is_1Speaking
 JNIEXPORT jboolean JNICALL Java_SpeechCore_Speech_1Output
   (JNIEnv *, jobject, jstring, jboolean);
 
+/*
+ * Class:     SpeechCore
+ * Method:    Speech_Output_Batch
+ * Signature: ([Ljava/lang/String;I)Z
+ */
+JNIEXPORT jboolean JNICALL Java_SpeechCore_Speech_1Output_1Batch
+  (JNIEnv *, jobject, jobjectArray, jint);
+
+/*
+ * Class:     SpeechCore
+ * Method:    Speech_Output_Batch_Direct
+ * Signature: (Ljava/nio/ByteBuffer;III)Z
+ */
+JNIEXPORT jboolean JNICALL Java_SpeechCore_Speech_1Output_1Batch_1Direct
+  (JNIEnv *, jobject, jobject, jint, jint, jint);
+
 /*
  * Class:     SpeechCore
  * Method:    Speech_Braille
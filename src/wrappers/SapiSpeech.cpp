@@ -144,21 +144,70 @@ void Sapi5Speech::retreive_voice_tokens() {
 
 void Sapi5Speech::processMessages() {
     while (this->processing) {
+        TtsMsg message;
+        uint64_t started;
+        {
+            std::unique_lock<std::mutex> lock(msg_mutex);
+            msg_condition.wait(lock, [&]() { return !messages.empty() || !this->processing; });
+            if (!this->processing) {
+                break;
+            }
+            this->_is_speaking = true;
+            message = std::move(this->messages.front());
+            this->messages.pop_front();
+            started = this->generation;
+        }
+        this->speak_memory(message.text.c_str(), message.interrupt, message.xml);
+        trimSilence(audio_data);
+        if (!feed_audio(started)) {
+            continue; // Interrupted or stopped while it was synthesized or fed.
+        }
         std::unique_lock<std::mutex> lock(msg_mutex);
-        msg_condition.wait(lock, [&]() { return !messages.empty() || !this->processing; });
-        if (!this->processing) {
-            break;
+        // With more queued, the next message is synthesized while this one's tail still plays,
+        // so segments of long text follow each other without a gap.
+        if (this->messages.empty()) {
+            lock.unlock();
+            audio_playback->sync();
+            lock.lock();
+            if (this->messages.empty()) {
+                this->_is_speaking = false;
+            }
         }
-        this->_is_speaking = true;
+    }
+}
+
+// Feeds audio_data a slice at a time, checking under msg_mutex before every slice that no interrupt or stop came in.
+// A stop landing between a check and its feed is undone by the feed restarting playback, so the next check
+// catches it and stops playback again. Audio from before a stop then plays for one slice at most.
+bool Sapi5Speech::feed_audio(uint64_t started) {
+    const size_t slice = (this->format.nAvgBytesPerSec / 10 / this->format.nBlockAlign) * this->format.nBlockAlign;
+    size_t offset = 0;
+    while (true) {
+        {
+            std::lock_guard<std::mutex> lock(msg_mutex);
+            if (started != this->generation) {
+                break;
+            }
+        }
+        if (offset >= audio_data.size()) {
+            return true;
+        }
+        size_t size = (audio_data.size() - offset < slice) ? audio_data.size() - offset : slice;
         unsigned int id;
-        TtsMsg message = this->messages.front();
-        this->messages.pop_front();
-        this->speak_memory(message.text, message.interrupt, message.xml);
-        trimSilence(audio_data);
-        audio_playback->feed(audio_data.data(), static_cast<int>(audio_data.size()), &id);
-        audio_playback->sync();
-        this->_is_speaking = false;
+        audio_playback->feed(audio_data.data() + offset, static_cast<unsigned int>(size), &id);
+        offset += size;
     }
+    if (offset > 0) {
+        audio_playback->stop();
+    }
+    return false;
+}
+
+void Sapi5Speech::discard_messages() {
+    std::lock_guard<std::mutex> lock(msg_mutex);
+    this->messages.clear();
+    this->generation++;
+    this->_is_speaking = false;
 }
 
 long Sapi5Speech::get_rate() {
@@ -228,13 +277,12 @@ void Sapi5Speech::speak_text(const wchar_t* _text, bool interrupt, bool xml) {
     if (this->voice) {
         if (interrupt) {
             this->audio_playback->stop();
-            this->messages.clear();
-            this->_is_speaking = false;
+            this->discard_messages();
         }
-        if (!this->_is_speaking) {
+        {
             std::lock_guard<std::mutex> lock(msg_mutex);
+            messages.emplace_back(TtsMsg{ _text, interrupt, xml });
         }
-        messages.emplace_back(TtsMsg{L"text", true, true});
         msg_condition.notify_one();
     } else {
         throw std::runtime_error("Error voice not initialized");
@@ -295,5 +343,6 @@ void Sapi5Speech::resume_speach() {
     this->audio_playback->resume();
 }
 void Sapi5Speech::stop_speach() {
+    this->discard_messages();
     this->audio_playback->stop();
 }
@@ -17,7 +17,7 @@
 #include "../ThirdParty/wasapi.h"
 
 struct TtsMsg {
-	const wchar_t* text;
+	std::wstring text; // Owned, callers hand in segments of their own buffers.
 	bool interrupt;
 	bool xml;
 };
@@ -29,6 +29,9 @@ private:
 	bool processing;
 	bool _is_speaking;
 	std::deque<TtsMsg> messages;
+	uint64_t generation = 0; // Advanced under msg_mutex by interrupts and stops, so audio synthesized before them is dropped.
+	void discard_messages();
+	bool feed_audio(uint64_t started);
 	std::thread task_thread;
 	std::thread task_thread2;
 	WasapiPlayer* audio_playback;
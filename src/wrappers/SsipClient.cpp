@@ -0,0 +1,343 @@
+#include "SsipClient.h"
+#include <cerrno>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <condition_variable>
+#include <memory>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+SsipClient::SsipClient() : fd(-1), wake_fd(-1), epoll_fd(-1), connected(false) {}
+
+SsipClient::~SsipClient() {
+    close();
+}
+
+std::string SsipClient::default_path() {
+    const char* address = getenv("SPEECHD_ADDRESS");
+    if (address && strncmp(address, "unix_socket:", 12) == 0 && address[12] != '\0') {
+        return address + 12;
+    }
+    const char* runtime = getenv("XDG_RUNTIME_DIR");
+    if (runtime && *runtime) {
+        return std::string(runtime) + "/speech-dispatcher/speechd.sock";
+    }
+    // Where libspeechd looks without a runtime directory.
+    const char* cache = getenv("XDG_CACHE_HOME");
+    if (cache && *cache) {
+        return std::string(cache) + "/speech-dispatcher/speechd.sock";
+    }
+    const char* home = getenv("HOME");
+    return std::string(home ? home : "") + "/.cache/speech-dispatcher/speechd.sock";
+}
+
+bool SsipClient::connect(const std::string& path, const std::string& client_name, event_fn _on_event) {
+    close();
+    std::string target = path.empty() ? default_path() : path;
+    sockaddr_un address{};
+    if (target.size() >= sizeof(address.sun_path)) {
+        return false;
+    }
+    address.sun_family = AF_UNIX;
+    memcpy(address.sun_path, target.c_str(), target.size() + 1);
+
+    fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        return false;
+    }
+    if (::connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) {
+        close();
+        return false;
+    }
+    wake_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (wake_fd < 0 || epoll_fd < 0) {
+        close();
+        return false;
+    }
+    epoll_event event{};
+    event.events = EPOLLIN | EPOLLRDHUP;
+    event.data.fd = fd;
+    epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &event);
+    event.events = EPOLLIN;
+    event.data.fd = wake_fd;
+    epoll_ctl(epoll_fd, EPOLL_CTL_ADD, wake_fd, &event);
+
+    on_event = std::move(_on_event);
+    priority.clear();
+    parameters.clear();
+    connected.store(true, std::memory_order_release);
+    reader = std::thread(&SsipClient::read_loop, this);
+
+    const char* user = getenv("USER");
+    return command("SET SELF CLIENT_NAME " + std::string(user ? user : "unknown") + ":" + client_name + ":main");
+}
+
+void SsipClient::close() {
+    if (reader.joinable()) {
+        uint64_t value = 1;
+        ssize_t written = write(wake_fd, &value, sizeof(value));
+        (void)written;
+        reader.join();
+    }
+    connected.store(false, std::memory_order_release);
+    for (int* handle : { &fd, &wake_fd, &epoll_fd }) {
+        if (*handle >= 0) {
+            ::close(*handle);
+            *handle = -1;
+        }
+    }
+    fail_waiting();
+}
+
+// Requires write_mutex.
+void SsipClient::append_parameters() {
+    for (auto& parameter : parameters) {
+        buffer += "SET SELF ";
+        buffer += parameter.first;
+        buffer += ' ';
+        buffer += std::to_string(parameter.second);
+        buffer += "\r\n";
+    }
+}
+
+// Requires write_mutex. Queues the reply handlers before writing, the reader may see the replies before send returns.
+bool SsipClient::send_buffer(size_t replies, reply_fn* handlers) {
+    {
+        std::lock_guard<std::mutex> lock(reply_mutex);
+        for (size_t i = 0; i < replies; i++) {
+            waiting.push_back(std::move(handlers[i]));
+        }
+    }
+    parameters.clear();
+    size_t sent = 0;
+    while (sent < buffer.size()) {
+        ssize_t result = send(fd, buffer.data() + sent, buffer.size() - sent, MSG_NOSIGNAL);
+        if (result < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            connected.store(false, std::memory_order_release);
+            fail_waiting();
+            return false;
+        }
+        sent += static_cast<size_t>(result);
+    }
+    if (!is_connected()) {
+        // The reader saw the hangup while this was written, nothing will answer it.
+        fail_waiting();
+        return false;
+    }
+    return true;
+}
+
+bool SsipClient::speak(std::string_view text, const char* _priority, reply_fn on_queued) {
+    std::unique_lock<std::mutex> lock(write_mutex);
+    if (!is_connected()) {
+        lock.unlock();
+        if (on_queued) {
+            on_queued(-1, {});
+        }
+        return false;
+    }
+    // One reply for each parameter, the priority if it changed, SPEAK and the message.
+    std::vector<reply_fn> handlers(parameters.size());
+    buffer.clear();
+    append_parameters();
+    if (priority != _priority) {
+        priority = _priority;
+        buffer += "SET SELF PRIORITY ";
+        buffer += priority;
+        buffer += "\r\n";
+        handlers.emplace_back();
+    }
+    buffer += "SPEAK\r\n";
+    handlers.emplace_back();
+
+    // A line starting with a dot gets a second one, a lone dot ends the message. Like libspeechd, only CRLF ends a line.
+    size_t start = buffer.size();
+    for (char c : text) {
+        if (c == '.' && (buffer.size() == start || (buffer.size() - start >= 2 && buffer.compare(buffer.size() - 2, 2, "\r\n") == 0))) {
+            buffer += '.';
+        }
+        buffer += c;
+    }
+    buffer += "\r\n.\r\n";
+    handlers.push_back(std::move(on_queued));
+    return send_buffer(handlers.size(), handlers.data());
+}
+
+bool SsipClient::command(const std::string& line, reply_fn on_reply) {
+    std::unique_lock<std::mutex> lock(write_mutex);
+    if (!is_connected()) {
+        lock.unlock();
+        if (on_reply) {
+            on_reply(-1, {});
+        }
+        return false;
+    }
+    std::vector<reply_fn> handlers(parameters.size());
+    buffer.clear();
+    append_parameters();
+    buffer += line;
+    buffer += "\r\n";
+    handlers.push_back(std::move(on_reply));
+    return send_buffer(handlers.size(), handlers.data());
+}
+
+void SsipClient::set_parameter(const char* name, int value) {
+    std::lock_guard<std::mutex> lock(write_mutex);
+    for (auto& parameter : parameters) {
+        if (strcmp(parameter.first, name) == 0) {
+            parameter.second = value;
+            return;
+        }
+    }
+    parameters.emplace_back(name, value);
+}
+
+bool SsipClient::flush() {
+    std::lock_guard<std::mutex> lock(write_mutex);
+    if (!is_connected()) {
+        return false;
+    }
+    if (parameters.empty()) {
+        return true;
+    }
+    std::vector<reply_fn> handlers(parameters.size());
+    buffer.clear();
+    append_parameters();
+    return send_buffer(handlers.size(), handlers.data());
+}
+
+int SsipClient::request(const std::string& line, std::vector<std::string>* lines, uint32_t timeout_ms) {
+    return await_reply(send_request(line), lines, timeout_ms);
+}
+
+SsipClient::reply_handle SsipClient::send_request(const std::string& line) {
+    auto reply = std::make_shared<pending_reply>();
+    bool sent = command(line, [reply](int code, const std::vector<std::string>& lines) {
+        {
+            std::lock_guard<std::mutex> lock(reply->mutex);
+            reply->replied = true;
+            reply->code = code;
+            reply->lines = lines;
+        }
+        reply->done.notify_all();
+    });
+    return sent ? reply : nullptr;
+}
+
+int SsipClient::await_reply(const reply_handle& reply, std::vector<std::string>* lines, uint32_t timeout_ms) {
+    if (!reply) {
+        return -1;
+    }
+    std::unique_lock<std::mutex> lock(reply->mutex);
+    if (!reply->done.wait_for(lock, std::chrono::milliseconds(timeout_ms), [&] { return reply->replied; })) {
+        return -1;
+    }
+    if (lines) {
+        *lines = std::move(reply->lines);
+    }
+    return reply->code;
+}
+
+void SsipClient::read_loop() {
+    std::string inbox;
+    std::vector<std::string> lines;
+    int code = 0;
+    char chunk[4096];
+    epoll_event events[2];
+    while (true) {
+        int count = epoll_wait(epoll_fd, events, 2, -1);
+        if (count < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            break;
+        }
+        bool closing = false;
+        bool hangup = false;
+        for (int i = 0; i < count; i++) {
+            if (events[i].data.fd == wake_fd) {
+                closing = true;
+                continue;
+            }
+            // Drain everything available before looking at the hangup, the last replies may come with it.
+            while (true) {
+                ssize_t received = recv(fd, chunk, sizeof(chunk), MSG_DONTWAIT);
+                if (received > 0) {
+                    inbox.append(chunk, static_cast<size_t>(received));
+                    continue;
+                }
+                if (received < 0 && errno == EINTR) {
+                    continue;
+                }
+                hangup = received == 0 || (errno != EAGAIN && errno != EWOULDBLOCK);
+                break;
+            }
+            size_t start = 0;
+            for (size_t end; (end = inbox.find("\r\n", start)) != std::string::npos; start = end + 2) {
+                dispatch_line(inbox.substr(start, end - start), code, lines);
+            }
+            inbox.erase(0, start);
+        }
+        if (closing) {
+            return;
+        }
+        if (hangup) {
+            connected.store(false, std::memory_order_release);
+            fail_waiting();
+            return;
+        }
+    }
+}
+
+// Replies are "CCC-data" lines followed by a final "CCC text" line.
+void SsipClient::dispatch_line(const std::string& line, int& code, std::vector<std::string>& lines) {
+    if (line.size() < 4) {
+        return;
+    }
+    code = atoi(line.substr(0, 3).c_str());
+    if (line[3] == '-') {
+        lines.push_back(line.substr(4));
+        return;
+    }
+    if (code >= 700 && code < 800) {
+        // Events carry the message id, the client id and, for index marks, the mark name.
+        if (on_event && !lines.empty()) {
+            on_event(static_cast<size_t>(strtoull(lines[0].c_str(), nullptr, 10)), code);
+        }
+    }
+    else {
+        reply_fn handler;
+        {
+            std::lock_guard<std::mutex> lock(reply_mutex);
+            if (!waiting.empty()) {
+                handler = std::move(waiting.front());
+                waiting.pop_front();
+            }
+        }
+        if (handler) {
+            handler(code, lines);
+        }
+    }
+    lines.clear();
+}
+
+void SsipClient::fail_waiting() {
+    std::deque<reply_fn> failed;
+    {
+        std::lock_guard<std::mutex> lock(reply_mutex);
+        failed.swap(waiting);
+    }
+    for (auto& handler : failed) {
+        if (handler) {
+            handler(-1, {});
+        }
+    }
+}
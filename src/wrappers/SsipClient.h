@@ -0,0 +1,89 @@
+// In-tree SSIP client talking to speech-dispatcher over its Unix socket, an alternative to libspeechd.
+// Commands are pipelined: callers write and return without waiting for the reply, a reader thread polling the
+// socket with epoll matches replies to commands in the order they were written and delivers 7xx events.
+// Parameter changes are held back and written together with the next SPEAK, so a rate change and the utterance
+// following it cost a single write.
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+
+class SsipClient {
+public:
+    // code is the three digit reply code, or -1 when the connection went down first. lines holds the data lines.
+    using reply_fn = std::function<void(int code, const std::vector<std::string>& lines)>;
+    // An asynchronous notification: message id and event code, 700 (index mark) to 705 (resumed).
+    using event_fn = std::function<void(size_t msg_id, int code)>;
+    // A reply awaited by a round trip, filled in by the reader thread.
+    struct pending_reply {
+        std::mutex mutex;
+        std::condition_variable done;
+        bool replied = false;
+        int code = -1;
+        std::vector<std::string> lines;
+    };
+    using reply_handle = std::shared_ptr<pending_reply>;
+
+    SsipClient();
+    ~SsipClient();
+    SsipClient(const SsipClient&) = delete;
+    SsipClient& operator=(const SsipClient&) = delete;
+
+    // Connects to the socket at path, or to default_path() when it is empty. Events are delivered on the reader thread.
+    bool connect(const std::string& path, const std::string& client_name, event_fn on_event);
+    void close();
+    bool is_connected() const { return connected.load(std::memory_order_acquire); }
+
+    // Pipelined, these return once the command is written. on_reply is called once, on the reader thread, or with -1
+    // right away when the command could not be written.
+    // priority is an SSIP priority name, sent only when it differs from the previous message's.
+    bool speak(std::string_view text, const char* priority, reply_fn on_queued);
+    bool command(const std::string& line, reply_fn on_reply = nullptr);
+    // Held until the next speak() or flush(). A later value for the same parameter replaces the pending one.
+    // name is kept as is, so it must be a literal such as "RATE".
+    void set_parameter(const char* name, int value);
+    bool flush();
+    // Round trip: flushes pending parameters, writes the command and waits for its reply.
+    // Returns the reply code, or -1 if the connection is down or no reply came within the timeout.
+    int request(const std::string& line, std::vector<std::string>* lines, uint32_t timeout_ms);
+    // request() in two halves, so callers can let go of their own locks before waiting: send_request writes the
+    // command and returns null if it could not, await_reply waits for the reply and needs nothing from the client.
+    reply_handle send_request(const std::string& line);
+    static int await_reply(const reply_handle& reply, std::vector<std::string>* lines, uint32_t timeout_ms);
+
+    // SPEECHD_ADDRESS if it names a unix socket, otherwise speech-dispatcher's socket in the user's runtime directory.
+    static std::string default_path();
+
+private:
+    int fd;
+    int wake_fd; // eventfd waking the reader for close().
+    int epoll_fd;
+    std::atomic<bool> connected;
+    std::thread reader;
+    event_fn on_event;
+
+    // Everything written to the socket goes through write_mutex, so replies come back in the order of waiting.
+    std::mutex write_mutex;
+    std::vector<std::pair<const char*, int>> parameters;
+    std::string priority;
+    std::string buffer; // Reused for building writes.
+
+    std::mutex reply_mutex;
+    std::deque<reply_fn> waiting;
+
+    // Requires write_mutex.
+    void append_parameters();
+    bool send_buffer(size_t replies, reply_fn* handlers);
+    void read_loop();
+    void dispatch_line(const std::string& line, int& code, std::vector<std::string>& lines);
+    void fail_waiting();
+};